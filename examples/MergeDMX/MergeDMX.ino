@@ -0,0 +1,57 @@
+/*
+ * Merges DMX from Serial1 and Serial2 onto Serial3. Channels
+ * 1-8 are merged LTP and the rest are merged HTP.
+ *
+ * This example is part of the TeensyDMX library.
+ * (c) 2022 Shawn Silverman
+ */
+
+#include <Merger.h>
+#include <TeensyDMX.h>
+
+namespace teensydmx = ::qindesign::teensydmx;
+
+// The LED pin.
+constexpr uint8_t kLEDPin = LED_BUILTIN;
+
+// Creates the DMX receivers on Serial1 and Serial2.
+teensydmx::Receiver dmxRx1{Serial1};
+teensydmx::Receiver dmxRx2{Serial2};
+
+// Creates the DMX sender on Serial3.
+teensydmx::Sender dmxTx{Serial3};
+
+// Merges both receivers into the sender.
+teensydmx::Merger merger{dmxTx};
+
+// Main program setup.
+void setup() {
+  // Serial initialization, for printing things (optional)
+  // Serial.begin(115200);
+  // while (!Serial && millis() < 4000) {
+  //   // Wait for initialization to complete or a time limit
+  // }
+  // Serial.println("Starting MergeDMX.");
+
+  // Set up any pins
+  pinMode(kLEDPin, OUTPUT);
+
+  // Both sources have the same priority, so both are merged
+  // while they're active
+  merger.add(dmxRx1);
+  merger.add(dmxRx2);
+  merger.setChannelModes(1, 8, teensydmx::Merger::Modes::kLTP);
+
+  dmxRx1.begin();
+  dmxRx2.begin();
+  dmxTx.begin();
+}
+
+// Main program loop.
+void loop() {
+  merger.merge();
+
+  // Show whether anything is being merged
+  digitalWriteFast(kLEDPin,
+                   (merger.isMerged(0) || merger.isMerged(1)) ? HIGH : LOW);
+}
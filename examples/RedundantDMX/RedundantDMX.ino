@@ -0,0 +1,71 @@
+/*
+ * Outputs DMX on Serial3 from a primary input on Serial1, and
+ * fails over to a backup input on Serial2 if the primary stops
+ * sending. The LED is on while the backup is in use.
+ *
+ * This example is part of the TeensyDMX library.
+ * (c) 2022 Shawn Silverman
+ */
+
+#include <RedundantReceiver.h>
+#include <TeensyDMX.h>
+
+namespace teensydmx = ::qindesign::teensydmx;
+
+// The LED pin.
+constexpr uint8_t kLEDPin = LED_BUILTIN;
+
+// Idle timeout for noticing a silent line, in microseconds.
+constexpr uint32_t kIdleTimeout = 100000;
+
+// Creates the primary and backup DMX receivers.
+teensydmx::Receiver dmxRxPrimary{Serial1};
+teensydmx::Receiver dmxRxBackup{Serial2};
+
+// Creates the DMX sender on Serial3.
+teensydmx::Sender dmxTx{Serial3};
+
+// Chooses the live input.
+teensydmx::RedundantReceiver inputs{dmxRxPrimary, dmxRxBackup};
+
+// Buffer for copying the live packet.
+uint8_t packetBuf[teensydmx::kMaxDMXPacketSize];
+
+// Main program setup.
+void setup() {
+  // Serial initialization, for printing things (optional)
+  // Serial.begin(115200);
+  // while (!Serial && millis() < 4000) {
+  //   // Wait for initialization to complete or a time limit
+  // }
+  // Serial.println("Starting RedundantDMX.");
+
+  // Set up any pins
+  pinMode(kLEDPin, OUTPUT);
+
+  // Notice a silent line sooner than the default of one second
+  dmxRxPrimary.setIdleTimeout(kIdleTimeout);
+  dmxRxBackup.setIdleTimeout(kIdleTimeout);
+
+  dmxRxPrimary.begin();
+  dmxRxBackup.begin();
+  dmxTx.begin();
+}
+
+// Main program loop.
+void loop() {
+  inputs.update();
+
+  teensydmx::Receiver *rx = inputs.live();
+  if (rx != nullptr) {
+    int read = rx->readPacket(packetBuf, 0, teensydmx::kMaxDMXPacketSize);
+    if (read > 0 && packetBuf[0] == 0) {
+      dmxTx.setPacketSizeAndData(read, 0, packetBuf, read);
+    }
+  }
+
+  // Show whether the backup is in use
+  bool backup =
+      (inputs.liveInput() == teensydmx::RedundantReceiver::kBackup);
+  digitalWriteFast(kLEDPin, backup ? HIGH : LOW);
+}
@@ -0,0 +1,52 @@
+/*
+ * Repeats DMX from Serial1 onto Serial2 slot by slot, as it
+ * arrives. Output channels 1-4 are taken from input channels
+ * 101-104 and the rest are passed through.
+ *
+ * This example is part of the TeensyDMX library.
+ * (c) 2022 Shawn Silverman
+ */
+
+#include <Repeater.h>
+#include <TeensyDMX.h>
+
+namespace teensydmx = ::qindesign::teensydmx;
+
+// The LED pin.
+constexpr uint8_t kLEDPin = LED_BUILTIN;
+
+// Creates the DMX receiver on Serial1.
+teensydmx::Receiver dmxRx{Serial1};
+
+// Creates the DMX sender on Serial2.
+teensydmx::Sender dmxTx{Serial2};
+
+// Forwards the receiver's slots to the sender.
+teensydmx::Repeater repeater{dmxRx, dmxTx};
+
+// Main program setup.
+void setup() {
+  // Serial initialization, for printing things (optional)
+  // Serial.begin(115200);
+  // while (!Serial && millis() < 4000) {
+  //   // Wait for initialization to complete or a time limit
+  // }
+  // Serial.println("Starting RepeatDMX.");
+
+  // Set up any pins
+  pinMode(kLEDPin, OUTPUT);
+
+  // Patches can only be changed while the repeater is stopped
+  for (int i = 1; i <= 4; i++) {
+    repeater.setPatch(i, 100 + i);
+  }
+
+  dmxRx.begin();
+  repeater.begin();
+}
+
+// Main program loop.
+void loop() {
+  // Show whether anything is being repeated
+  digitalWriteFast(kLEDPin, dmxRx.connected() ? HIGH : LOW);
+}
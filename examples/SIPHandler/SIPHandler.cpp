@@ -1,5 +1,5 @@
 // This file is part of the SIPHandler example in the TeensyDMX library.
-// (c) 2018-2020 Shawn Silverman
+// (c) 2018-2022 Shawn Silverman
 
 #include "SIPHandler.h"
 
@@ -29,7 +29,32 @@ bool checkSIP(const uint8_t *buf, int len) {
   return true;
 }
 
+int SIPHandler::processByte(const uint8_t *buf, int len,
+                            uint8_t *outBuf) {
+  if (len == 1) {
+    sum_ = buf[0];
+  } else {
+    sum_ += buf[len - 1];
+  }
+  sumLen_ = len;
+  return -1;
+}
+
+int SIPHandler::processBytes(const uint8_t *buf, int start, int count,
+                             uint8_t *outBuf, int *len) {
+  sum_ = std::accumulate(&buf[start], &buf[start + count], sum_);
+  sumLen_ = start + count;
+  return -1;
+}
+
 void SIPHandler::receivePacket(const uint8_t *buf, int len) {
+  // Use the running checksum if it covers the whole packet
+  uint16_t sum = sum_;
+  if (sumLen_ != len) {
+    sum = std::accumulate(&buf[0], &buf[len], uint16_t{0});
+  }
+  sumLen_ = 0;
+
   bool copyData = true;
 
   if (buf[0] == startCode()) {  // Process a SIP
@@ -42,6 +67,7 @@ void SIPHandler::receivePacket(const uint8_t *buf, int len) {
       // Copy the packet data, maybe the next SIP will use this?
       std::copy_n(&buf[0], len, &packet_[0]);
       packetSize_ = len;
+      packetSum_ = sum;
       return;
     }
 
@@ -60,8 +86,7 @@ void SIPHandler::receivePacket(const uint8_t *buf, int len) {
     // Check the checksum of the last packet
     uint16_t sipCheck = getUint16(&buf[3]);
     if (packetSize_ > 0) {
-      uint16_t check =
-          ~std::accumulate(&packet_[0], &packet_[packetSize_], uint16_t{0});
+      uint16_t check = ~packetSum_;
       sipData_.checksumValid = (sipCheck == check);
       sipData_.hasLastPacket = true;
     }
@@ -143,6 +168,7 @@ void SIPHandler::receivePacket(const uint8_t *buf, int len) {
   if (copyData) {
     std::copy_n(&buf[0], len, &packet_[0]);
     packetSize_ = len;
+    packetSum_ = sum;
   }
 }
 
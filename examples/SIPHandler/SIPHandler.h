@@ -38,8 +38,11 @@ class SIPHandler final : public teensydmx::Responder {
   // Initialize the object.
   SIPHandler()
       : state_{States::kImmediate},
+        sum_(0),
+        sumLen_(0),
         packet_{0},
         packetSize_(0),
+        packetSum_(0),
         held_(false),
         sipData_{0},
         sipDataValid_(false) {}
@@ -68,6 +71,15 @@ class SIPHandler final : public teensydmx::Responder {
     return true;
   }
 
+  // Adds the byte to the running checksum of the packet being received.
+  // This never responds.
+  int processByte(const uint8_t *buf, int len, uint8_t *outBuf) override;
+
+  // Adds a whole chunk of bytes to the running checksum of the packet
+  // being received. This never responds.
+  int processBytes(const uint8_t *buf, int start, int count,
+                   uint8_t *outBuf, int *len) override;
+
   // A packet was just received by the receiver. This is implemented
   // similarly to Receiver::receivePacket.
   void receivePacket(const uint8_t *buf, int len) override;
@@ -82,9 +94,15 @@ class SIPHandler final : public teensydmx::Responder {
 
   States state_;
 
+  // Running checksum of the packet being received, and how many bytes
+  // it covers
+  uint16_t sum_;
+  int sumLen_;
+
   // Packet data
   volatile uint8_t packet_[teensydmx::kMaxDMXPacketSize];
   volatile int packetSize_;
+  uint16_t packetSum_;  // Sum of the packet data
   volatile bool held_;
 
   // SIP data
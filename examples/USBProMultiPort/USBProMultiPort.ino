@@ -0,0 +1,57 @@
+/*
+ * Acts as a USB Pro widget having three ports, using the
+ * library's protocol engine. Port 0 sends on Serial1 and the
+ * host uses the standard labels for it. Port 1 sends on
+ * Serial2, and port 2 receives on Serial3; the host addresses
+ * these with the extended labels.
+ *
+ * This example is part of the TeensyDMX library.
+ * (c) 2022 Shawn Silverman
+ */
+
+#include <TeensyDMX.h>
+#include <USBProWidget.h>
+
+namespace teensydmx = ::qindesign::teensydmx;
+
+// The LED pin.
+constexpr uint8_t kLEDPin = LED_BUILTIN;
+
+// ESTA manufacturer ID
+// https://tsp.esta.org/tsp/working_groups/CP/mfctrIDs.php
+constexpr uint16_t kManufacturerID = 0x7FF0;  // Prototype use
+
+// DMX ports
+teensydmx::Sender dmxTx1{Serial1};
+teensydmx::Sender dmxTx2{Serial2};
+teensydmx::Receiver dmxRx3{Serial3};
+
+// Speaks the widget protocol over USB serial.
+teensydmx::USBProWidget widget{Serial};
+
+// Main program setup.
+void setup() {
+  Serial.begin(115200);
+
+  // Set up any pins
+  pinMode(kLEDPin, OUTPUT);
+
+  widget.setSerialNumber(0x01020304);
+  widget.setManufacturer(kManufacturerID, "Manufacturer Nom");
+  widget.setDevice(0x0001, "Multi-port widget (TeensyDMX demo)");
+  widget.setPort(0, &dmxTx1, nullptr);
+  widget.setPort(1, &dmxTx2, nullptr);
+  widget.setPort(2, nullptr, &dmxRx3);
+
+  dmxTx1.begin();
+  dmxTx2.begin();
+  dmxRx3.begin();
+}
+
+// Main program loop.
+void loop() {
+  widget.poll();
+
+  // Show whether anything is being received
+  digitalWriteFast(kLEDPin, dmxRx3.connected() ? HIGH : LOW);
+}
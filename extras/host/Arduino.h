@@ -0,0 +1,13 @@
+// Arduino.h is the host stand-in for the Teensy core's main header. It only
+// includes the parts that the library and its host programs use.
+// This file is part of the TeensyDMX library.
+// (c) 2022 Shawn Silverman
+
+#ifndef TEENSYDMX_HOST_ARDUINO_H_
+#define TEENSYDMX_HOST_ARDUINO_H_
+
+#include "HardwareSerial.h"
+#include "IntervalTimer.h"
+#include "core_pins.h"
+
+#endif  // TEENSYDMX_HOST_ARDUINO_H_
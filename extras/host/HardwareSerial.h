@@ -0,0 +1,99 @@
+// HardwareSerial.h is the host stand-in for the Teensy core's serial ports.
+// The ports have no UART behind them; they only exist so that receivers and
+// senders can be created and simulated. `Serial` writes to standard output.
+// This file is part of the TeensyDMX library.
+// (c) 2022 Shawn Silverman
+
+#ifndef TEENSYDMX_HOST_HARDWARESERIAL_H_
+#define TEENSYDMX_HOST_HARDWARESERIAL_H_
+
+// C++ includes
+#include <cstdarg>
+#include <cstdint>
+#include <cstdio>
+
+#define SERIAL_7E1 0x02
+#define SERIAL_7O1 0x03
+#define SERIAL_8N1 0x00
+#define SERIAL_8N2 0x04
+#define SERIAL_8E1 0x06
+#define SERIAL_8O1 0x07
+#define SERIAL_8E2 0x46
+#define SERIAL_8O2 0x47
+
+class HardwareSerial {
+ public:
+  HardwareSerial() = default;
+
+  // There's one object per port
+  HardwareSerial(const HardwareSerial &) = delete;
+  HardwareSerial &operator=(const HardwareSerial &) = delete;
+
+  void begin(uint32_t baud, uint16_t format = 0) {
+  }
+
+  void end() {
+  }
+};
+
+// Standard output, in place of the USB serial port.
+class HostSerial {
+ public:
+  void begin(uint32_t baud) {
+  }
+
+  explicit operator bool() const {
+    return true;
+  }
+
+  int printf(const char *format, ...) {
+    va_list args;
+    va_start(args, format);
+    int n = std::vprintf(format, args);
+    va_end(args);
+    return n;
+  }
+
+  void print(const char *s) {
+    std::fputs(s, stdout);
+  }
+
+  void println(const char *s = "") {
+    std::puts(s);
+  }
+
+  void flush() {
+    std::fflush(stdout);
+  }
+};
+
+namespace qindesign {
+namespace teensydmx {
+namespace host {
+
+// Returns the object for the given port. These are function-local so that
+// every translation unit sees the same objects without needing a source file.
+inline HardwareSerial &serialPort(int index) {
+  static HardwareSerial ports[7];
+  return ports[index];
+}
+
+inline HostSerial &usbSerial() {
+  static HostSerial serial;
+  return serial;
+}
+
+}  // namespace host
+}  // namespace teensydmx
+}  // namespace qindesign
+
+#define Serial  (::qindesign::teensydmx::host::usbSerial())
+#define Serial1 (::qindesign::teensydmx::host::serialPort(0))
+#define Serial2 (::qindesign::teensydmx::host::serialPort(1))
+#define Serial3 (::qindesign::teensydmx::host::serialPort(2))
+#define Serial4 (::qindesign::teensydmx::host::serialPort(3))
+#define Serial5 (::qindesign::teensydmx::host::serialPort(4))
+#define Serial6 (::qindesign::teensydmx::host::serialPort(5))
+#define Serial7 (::qindesign::teensydmx::host::serialPort(6))
+
+#endif  // TEENSYDMX_HOST_HARDWARESERIAL_H_
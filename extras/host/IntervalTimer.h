@@ -0,0 +1,31 @@
+// IntervalTimer.h is the host stand-in for the Teensy core's IntervalTimer.
+// There are no timers on the host, so starting one always fails, the same as
+// when all the hardware timers are in use.
+// This file is part of the TeensyDMX library.
+// (c) 2022 Shawn Silverman
+
+#ifndef TEENSYDMX_HOST_INTERVALTIMER_H_
+#define TEENSYDMX_HOST_INTERVALTIMER_H_
+
+// C++ includes
+#include <cstdint>
+
+class IntervalTimer {
+ public:
+  template <typename period_t>
+  bool begin(void (*funct)(), period_t period) {
+    return false;
+  }
+
+  template <typename period_t>
+  void update(period_t period) {
+  }
+
+  void end() {
+  }
+
+  void priority(uint8_t n) {
+  }
+};
+
+#endif  // TEENSYDMX_HOST_INTERVALTIMER_H_
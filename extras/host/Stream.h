@@ -0,0 +1,43 @@
+// Stream.h is the host stand-in for the Arduino Stream interface, reduced to
+// the parts that the library uses.
+// This file is part of the TeensyDMX library.
+// (c) 2022 Shawn Silverman
+
+#ifndef TEENSYDMX_HOST_STREAM_H_
+#define TEENSYDMX_HOST_STREAM_H_
+
+// C++ includes
+#include <cstddef>
+#include <cstdint>
+
+class Stream {
+ public:
+  virtual ~Stream() = default;
+
+  virtual int available() = 0;
+  virtual int read() = 0;
+  virtual int peek() = 0;
+  virtual size_t write(uint8_t b) = 0;
+
+  virtual size_t write(const uint8_t *buf, size_t size) {
+    size_t n = 0;
+    while (size-- > 0) {
+      n += write(*buf++);
+    }
+    return n;
+  }
+
+  // Reads what's available, up to the given size. There's no timeout.
+  size_t readBytes(uint8_t *buf, size_t size) {
+    size_t n = 0;
+    while (n < size && available() > 0) {
+      buf[n++] = read();
+    }
+    return n;
+  }
+
+  virtual void flush() {
+  }
+};
+
+#endif  // TEENSYDMX_HOST_STREAM_H_
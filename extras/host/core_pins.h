@@ -0,0 +1,93 @@
+// core_pins.h is the host stand-in for the Teensy core's timing and pin
+// functions. Time comes from the host's steady clock and the pin functions do
+// nothing.
+// This file is part of the TeensyDMX library.
+// (c) 2022 Shawn Silverman
+
+#ifndef TEENSYDMX_HOST_CORE_PINS_H_
+#define TEENSYDMX_HOST_CORE_PINS_H_
+
+// C++ includes
+#include <chrono>
+#include <cstdint>
+#include <thread>
+
+#define LOW     0
+#define HIGH    1
+#define CHANGE  4
+#define RISING  2
+#define FALLING 3
+
+#define INPUT        0
+#define OUTPUT       1
+#define INPUT_PULLUP 2
+
+namespace qindesign {
+namespace teensydmx {
+namespace host {
+
+// Returns the time at which the program first asked for the time.
+inline std::chrono::steady_clock::time_point startTime() {
+  static const std::chrono::steady_clock::time_point start =
+      std::chrono::steady_clock::now();
+  return start;
+}
+
+// Returns the time since `startTime()`, in the given units.
+template <typename Duration>
+uint32_t elapsed() {
+  return static_cast<uint32_t>(std::chrono::duration_cast<Duration>(
+      std::chrono::steady_clock::now() - startTime()).count());
+}
+
+}  // namespace host
+}  // namespace teensydmx
+}  // namespace qindesign
+
+inline uint32_t micros() {
+  return ::qindesign::teensydmx::host::elapsed<std::chrono::microseconds>();
+}
+
+inline uint32_t millis() {
+  return ::qindesign::teensydmx::host::elapsed<std::chrono::milliseconds>();
+}
+
+inline void delayMicroseconds(uint32_t us) {
+  uint32_t start = micros();
+  while ((micros() - start) < us) {
+    // Busy-wait, like the real thing
+  }
+}
+
+inline void delay(uint32_t ms) {
+  std::this_thread::sleep_for(std::chrono::milliseconds{ms});
+}
+
+inline void yield() {
+}
+
+inline void pinMode(uint8_t pin, uint8_t mode) {
+}
+
+inline void digitalWrite(uint8_t pin, uint8_t val) {
+}
+
+inline void digitalWriteFast(uint8_t pin, uint8_t val) {
+}
+
+inline uint8_t digitalRead(uint8_t pin) {
+  return HIGH;
+}
+
+inline uint8_t digitalReadFast(uint8_t pin) {
+  return HIGH;
+}
+
+// There are no pin interrupts, so the function is never called.
+inline void attachInterrupt(uint8_t pin, void (*function)(), int mode) {
+}
+
+inline void detachInterrupt(uint8_t pin) {
+}
+
+#endif  // TEENSYDMX_HOST_CORE_PINS_H_
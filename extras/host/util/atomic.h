@@ -0,0 +1,16 @@
+// atomic.h is the host stand-in for the Teensy core's ATOMIC_BLOCK. A host
+// program has no interrupts, so the block just runs its body once.
+// This file is part of the TeensyDMX library.
+// (c) 2022 Shawn Silverman
+
+#ifndef TEENSYDMX_HOST_UTIL_ATOMIC_H_
+#define TEENSYDMX_HOST_UTIL_ATOMIC_H_
+
+#define ATOMIC_RESTORESTATE bool teensydmxAtomicState_ = true
+#define ATOMIC_FORCEON      bool teensydmxAtomicState_ = true
+
+#define ATOMIC_BLOCK(type)                    \
+  for (type; teensydmxAtomicState_;           \
+       teensydmxAtomicState_ = false)
+
+#endif  // TEENSYDMX_HOST_UTIL_ATOMIC_H_
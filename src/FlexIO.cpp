@@ -0,0 +1,162 @@
+// This file is part of the TeensyDMX library.
+// (c) 2022 Shawn Silverman
+
+#if defined(__IMXRT1062__)
+
+#include "FlexIO.h"
+
+#include <core_pins.h>
+#include <imxrt.h>
+#include <util/atomic.h>
+
+namespace qindesign {
+namespace teensydmx {
+namespace flexio {
+
+// The parts of `kClock`
+constexpr uint32_t kPLL3Freq = 480000000;
+constexpr uint32_t kClockPred = 8;
+constexpr uint32_t kClockPodf = 8;
+static_assert(kClock == kPLL3Freq / kClockPred / kClockPodf,
+              "Clock mismatch");
+
+// The Teensy pins that can be used, in channel order, and their FlexIO2 pins.
+struct PinInfo {
+  int pin;
+  int flexIOPin;
+};
+constexpr PinInfo kPins[kChannelCount]{
+    {6, 10}, {7, 17}, {8, 16}, {9, 11}, {10, 0}, {11, 2}, {12, 1}, {13, 3},
+};
+
+// The DMAMUX sources of the shifter pairs that have DMA requests, and the
+// channel that has claimed each one, or -1 if none.
+constexpr int kDMAPairCount = 2;
+constexpr uint8_t kDMASources[kDMAPairCount]{
+    DMAMUX_SOURCE_FLEXIO2_REQUEST0,  // Same as REQUEST1
+    DMAMUX_SOURCE_FLEXIO2_REQUEST2,  // Same as REQUEST3
+};
+static int dmaOwners[kDMAPairCount]{-1, -1};
+
+// The number of started channels, for knowing when to disable the
+// shared interrupt.
+static volatile int activeCount = 0;
+
+int channelForPin(int pin) {
+  for (int i = 0; i < kChannelCount; i++) {
+    if (kPins[i].pin == pin) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+int pinForChannel(int channel) {
+  return kPins[channel].pin;
+}
+
+int flexIOPinForChannel(int channel) {
+  return kPins[channel].flexIOPin;
+}
+
+uint32_t enable() {
+  // Leave the clock alone if something else is already using FlexIO2
+  bool configure = true;
+  if ((CCM_CCGR3 & CCM_CCGR3_FLEXIO2(CCM_CCGR_ON)) != 0) {
+    configure = (IMXRT_FLEXIO2_S.CTRL & FLEXIO_CTRL_FLEXEN) == 0;
+  }
+  if (configure) {
+    // The clock must be gated off while changing it
+    CCM_CCGR3 &= ~CCM_CCGR3_FLEXIO2(CCM_CCGR_ON);
+    CCM_CSCMR2 = (CCM_CSCMR2 & ~CCM_CSCMR2_FLEXIO2_CLK_SEL(3)) |
+                 CCM_CSCMR2_FLEXIO2_CLK_SEL(3);
+    CCM_CS1CDR = (CCM_CS1CDR & ~(CCM_CS1CDR_FLEXIO2_CLK_PRED(7) |
+                                 CCM_CS1CDR_FLEXIO2_CLK_PODF(7))) |
+                 CCM_CS1CDR_FLEXIO2_CLK_PRED(kClockPred - 1) |
+                 CCM_CS1CDR_FLEXIO2_CLK_PODF(kClockPodf - 1);
+    CCM_CCGR3 |= CCM_CCGR3_FLEXIO2(CCM_CCGR_ON);
+    IMXRT_FLEXIO2_S.CTRL = FLEXIO_CTRL_FLEXEN;
+  }
+
+  if ((CCM_CSCMR2 & CCM_CSCMR2_FLEXIO2_CLK_SEL(3)) !=
+      CCM_CSCMR2_FLEXIO2_CLK_SEL(3)) {
+    return 0;
+  }
+  uint32_t pred = ((CCM_CS1CDR >> 9) & 0x07) + 1;
+  uint32_t podf = ((CCM_CS1CDR >> 25) & 0x07) + 1;
+  return kPLL3Freq / (pred * podf);
+}
+
+uint32_t timCmp(uint32_t clock, uint32_t baud, uint32_t bits) {
+  if (clock == 0 || baud == 0) {
+    return 0;
+  }
+  uint32_t div = (clock + baud) / (2 * baud);  // Rounded half-bit divider
+  if (div < 1) {
+    div = 1;
+  } else if (div > 256) {
+    div = 256;
+  }
+  return ((bits * 2 - 1) << 8) | (div - 1);
+}
+
+int claimDMA(int channel) {
+  int pair = channel / 2;
+  if (channel < 0 || kDMAPairCount <= pair) {
+    return -1;
+  }
+  bool claimed = false;
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+    if (dmaOwners[pair] < 0 || dmaOwners[pair] == channel) {
+      dmaOwners[pair] = channel;
+      claimed = true;
+    }
+  }
+  return claimed ? kDMASources[pair] : -1;
+}
+
+void releaseDMA(int channel) {
+  int pair = channel / 2;
+  if (channel < 0 || kDMAPairCount <= pair) {
+    return;
+  }
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+    if (dmaOwners[pair] == channel) {
+      dmaOwners[pair] = -1;
+    }
+  }
+}
+
+void modify(volatile uint32_t &reg, uint32_t set, uint32_t clear) {
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+    reg = (reg & ~clear) | set;
+  }
+}
+
+// Each handler only looks at its own channel's flags.
+static void isr() {
+  flexio2_tx_isr();
+  flexio2_rx_isr();
+}
+
+void attachIRQ() {
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+    attachInterruptVector(IRQ_FLEXIO2, &isr);
+    activeCount++;
+  }
+  NVIC_ENABLE_IRQ(IRQ_FLEXIO2);
+}
+
+void detachIRQ() {
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+    if (activeCount > 0 && --activeCount == 0) {
+      NVIC_DISABLE_IRQ(IRQ_FLEXIO2);
+    }
+  }
+}
+
+}  // namespace flexio
+}  // namespace teensydmx
+}  // namespace qindesign
+
+#endif  // __IMXRT1062__
@@ -0,0 +1,79 @@
+// FlexIO.h declares the FlexIO2 things that the FlexIO send and receive
+// handlers share on the Teensy 4.
+// This file is part of the TeensyDMX library.
+// (c) 2022 Shawn Silverman
+
+#if defined(__IMXRT1062__)
+
+#ifndef TEENSYDMX_FLEXIO_H_
+#define TEENSYDMX_FLEXIO_H_
+
+// C++ includes
+#include <cstdint>
+
+namespace qindesign {
+namespace teensydmx {
+namespace flexio {
+
+// The number of available channels. Channel N uses shifter N and timer N, so
+// each pin can be used either to send or to receive, but not both.
+constexpr int kChannelCount = 8;
+
+// The clock used when this configures FlexIO2: 480MHz PLL3 / 8 / 8 = 7.5MHz.
+// This gives exact 250kbaud and 50kbaud dividers and it still allows BREAK
+// baud rates down to about 14.6kbaud.
+constexpr uint32_t kClock = 480000000 / 8 / 8;
+
+// Returns the channel for the given pin, or -1 if the pin isn't a supported
+// FlexIO2 pin.
+int channelForPin(int pin);
+
+// Returns the Teensy pin for the given channel.
+int pinForChannel(int channel);
+
+// Returns the FlexIO2 pin for the given channel.
+int flexIOPinForChannel(int channel);
+
+// Enables FlexIO2 and returns its clock frequency. If FlexIO2 isn't already
+// running then this first sets its clock. This returns zero if FlexIO2 is
+// already running from a clock source other than PLL3.
+uint32_t enable();
+
+// Returns the dual 8-bit baud/bit timer compare value for shifting the given
+// number of data bits, or zero if the clock is zero. The divider is clamped to
+// what the timer can do.
+uint32_t timCmp(uint32_t clock, uint32_t baud, uint32_t bits);
+
+// Claims the DMA request of the given channel's shifter and returns its DMAMUX
+// source, or -1 if it can't be used. Only shifters 0-3 have DMA requests, and
+// shifters 0 and 1 share one, as do shifters 2 and 3, so only one channel of
+// each pair can use DMA at a time. A successful claim must be matched by a call
+// to `releaseDMA()`.
+int claimDMA(int channel);
+
+// Releases a DMA request claimed with `claimDMA()`.
+void releaseDMA(int channel);
+
+// Sets and clears bits in a register shared by all the channels.
+void modify(volatile uint32_t &reg, uint32_t set, uint32_t clear);
+
+// Attaches the shared FlexIO2 interrupt and enables it. Each call must be
+// matched by a call to `detachIRQ()`.
+void attachIRQ();
+
+// Disables the shared FlexIO2 interrupt when no other channel needs it.
+void detachIRQ();
+
+}  // namespace flexio
+
+// The senders' and receivers' parts of the shared interrupt. These are defined
+// with their instances.
+void flexio2_tx_isr();
+void flexio2_rx_isr();
+
+}  // namespace teensydmx
+}  // namespace qindesign
+
+#endif  // TEENSYDMX_FLEXIO_H_
+
+#endif  // __IMXRT1062__
@@ -0,0 +1,285 @@
+// This file is part of the TeensyDMX library.
+// (c) 2022 Shawn Silverman
+
+#if defined(__IMXRT1062__)
+
+#include "FlexIOReceiveHandler.h"
+
+#include <core_pins.h>
+
+#include "FlexIO.h"
+#include "TeensyDMX.h"
+
+namespace qindesign {
+namespace teensydmx {
+
+extern const uint32_t kSlotsBaud;
+extern const uint32_t kCharTime;  // In microseconds
+
+FlexIOReceiveHandler::FlexIOReceiveHandler(int serialIndex,
+                                           Receiver *receiver,
+                                           int channel)
+    : ReceiveHandler(serialIndex, receiver, kKind),
+      port_(&IMXRT_FLEXIO2_S),
+      channel_(channel),
+      mask_(uint32_t{1} << channel),
+      pin_(flexio::pinForChannel(channel)),
+      flexIOPin_(flexio::flexIOPinForChannel(channel)),
+      dma_{nullptr} {}
+
+void FlexIOReceiveHandler::start() {
+  uint32_t timCmp = flexio::timCmp(flexio::enable(), kSlotsBaud, 8);
+  flexio::attachIRQ();
+  if (timCmp == 0) {
+    // FlexIO2 isn't usable
+    return;
+  }
+
+  // Receive mode, checking for a zero start bit and a one stop bit. The data
+  // is shifted in on the falling edge of the shift clock, in the middle of
+  // each bit.
+  port_->SHIFTCFG[channel_] =
+      FLEXIO_SHIFTCFG_SSTOP(3) | FLEXIO_SHIFTCFG_SSTART(2);
+  port_->SHIFTCTL[channel_] =
+      FLEXIO_SHIFTCTL_TIMSEL(channel_) | FLEXIO_SHIFTCTL_TIMPOL |
+      FLEXIO_SHIFTCTL_PINSEL(flexIOPin_) | FLEXIO_SHIFTCTL_SMOD(1);
+
+  // The timer is enabled by the falling edge of each start bit, since the pin
+  // is active low, and it's disabled after the stop bit. The pin's rising
+  // edges resynchronize it.
+  port_->TIMCMP[channel_] = timCmp;
+  port_->TIMCFG[channel_] =
+      FLEXIO_TIMCFG_TIMOUT(2) | FLEXIO_TIMCFG_TIMRST(4) |
+      FLEXIO_TIMCFG_TIMDIS(2) | FLEXIO_TIMCFG_TIMENA(4) |
+      FLEXIO_TIMCFG_TSTOP(2) | FLEXIO_TIMCFG_TSTART;
+  port_->TIMCTL[channel_] =
+      FLEXIO_TIMCTL_PINSEL(flexIOPin_) | FLEXIO_TIMCTL_PINPOL |
+      FLEXIO_TIMCTL_TIMOD(1);
+
+  // Allocate the DMA channel if the shifter's DMA request is free. Memory
+  // outside of DTCM is cached, so buffers there must be aligned to whole cache
+  // lines for DMA to be used.
+  uintptr_t bufAddr = reinterpret_cast<uintptr_t>(receiver_->buf1_);
+  if (receiver_->dmaEnabled_ && dma_ == nullptr &&
+      (bufAddr < 0x20200000u || (bufAddr & 31) == 0)) {
+    int source = flexio::claimDMA(channel_);
+    if (source >= 0) {
+      dma_ = std::make_unique<DMAChannel>();
+      if (dma_->channel >= DMA_NUM_CHANNELS) {
+        // No channels are available, so use interrupts
+        dma_ = nullptr;
+        flexio::releaseDMA(channel_);
+      } else {
+        // Reads are 8 bits wide, from the low byte of the byte-swapped buffer
+        dma_->source(*reinterpret_cast<volatile uint8_t *>(
+            &port_->SHIFTBUFBYS[channel_]));
+        dma_->triggerAtHardwareEvent(source);
+        dma_->disableOnCompletion();
+      }
+    }
+  }
+  flexio::modify(port_->SHIFTSDEN, 0, mask_);
+
+  // Discard anything left over and then watch for slots and errors
+  (void)port_->SHIFTBUFBYS[channel_];
+  port_->SHIFTERR = mask_;
+  flexio::modify(port_->SHIFTSIEN, mask_, 0);
+  flexio::modify(port_->SHIFTEIEN, mask_, 0);
+
+  // Hand the pin to FlexIO2, with the same pull-up as a serial RX pin
+  *(portControlRegister(pin_)) =
+      IOMUXC_PAD_DSE(7) | IOMUXC_PAD_PKE | IOMUXC_PAD_PUE | IOMUXC_PAD_PUS(3) |
+      IOMUXC_PAD_HYS;
+  *(portConfigRegister(pin_)) = 4;  // ALT4
+}
+
+void FlexIOReceiveHandler::end() const {
+  stopDMA();
+  if (dma_ != nullptr) {
+    dma_ = nullptr;
+    flexio::releaseDMA(channel_);
+  }
+  flexio::modify(port_->SHIFTSIEN, 0, mask_);
+  flexio::modify(port_->SHIFTEIEN, 0, mask_);
+  port_->SHIFTCTL[channel_] = 0;
+  port_->TIMCTL[channel_] = 0;
+  *(portConfigRegister(pin_)) = 5;  // GPIO
+  flexio::detachIRQ();
+}
+
+void FlexIOReceiveHandler::setTXEnabled(bool flag) const {
+  // There's no TX
+}
+
+void FlexIOReceiveHandler::setILT(bool flag) const {
+  // There's no IDLE detection
+}
+
+void FlexIOReceiveHandler::setRXWatermarkHigh(bool flag) const {
+  // The shifter holds only one slot
+}
+
+void FlexIOReceiveHandler::setIRQState(bool flag) const {
+  if (flag) {
+    NVIC_ENABLE_IRQ(IRQ_FLEXIO2);
+  } else {
+    NVIC_DISABLE_IRQ(IRQ_FLEXIO2);
+  }
+}
+
+int FlexIOReceiveHandler::priority() const {
+  return NVIC_GET_PRIORITY(IRQ_FLEXIO2);
+}
+
+void FlexIOReceiveHandler::startDMA() const {
+  if (dma_ == nullptr || !receiver_->isBulkReceiveAllowed()) {
+    return;
+  }
+
+  int index = receiver_->activeBufIndex_;
+  uint8_t *dst = &receiver_->activeBuf_[index];
+  int len = kMaxDMXPacketSize - index;
+  // Memory outside of DTCM is cached. Write back and discard the buffer's lines
+  // so that none are dirty while the DMA fills them; any read back in the
+  // meantime are discarded again in `stopDMA()`.
+  if (reinterpret_cast<uintptr_t>(dst) >= 0x20200000u) {
+    arm_dcache_flush_delete(dst, len);
+  }
+  dma_->destinationBuffer(dst, len);
+  dma_->clearComplete();
+  dma_->enable();
+
+  // A full shifter now makes a DMA request; errors still interrupt
+  flexio::modify(port_->SHIFTSIEN, 0, mask_);
+  flexio::modify(port_->SHIFTSDEN, mask_, 0);
+}
+
+int FlexIOReceiveHandler::stopDMA() const {
+  if (dma_ == nullptr || (port_->SHIFTSDEN & mask_) == 0) {
+    return 0;
+  }
+
+  flexio::modify(port_->SHIFTSDEN, 0, mask_);
+  dma_->disable();
+  while ((dma_->TCD->CSR & DMA_TCD_CSR_ACTIVE) != 0) {
+    // Wait for any in-progress transfer
+  }
+  flexio::modify(port_->SHIFTSIEN, mask_, 0);
+
+  int count;
+  if (dma_->complete()) {
+    dma_->clearComplete();
+    count = dma_->TCD->BITER;
+  } else {
+    count = dma_->TCD->BITER - dma_->TCD->CITER;
+  }
+
+  // Don't let the CPU see stale cached copies of the received slots
+  uint8_t *dst = &receiver_->activeBuf_[receiver_->activeBufIndex_];
+  if (count > 0 && reinterpret_cast<uintptr_t>(dst) >= 0x20200000u) {
+    arm_dcache_delete(dst, count);
+  }
+  return count;
+}
+
+void FlexIOReceiveHandler::irqHandler() const {
+  // The interrupt is shared by all the channels, so only look at this one.
+  // Errors interrupt even while DMA is reading the slots.
+  if ((port_->SHIFTEIEN & mask_) == 0) {
+    return;
+  }
+  bool error = (port_->SHIFTERR & mask_) != 0;
+  if (!error && (port_->SHIFTSIEN & port_->SHIFTSTAT & mask_) == 0) {
+    return;
+  }
+
+  TEENSYDMX_PROFILE(kReceiveIRQ);
+
+  uint32_t eventTime = micros();
+
+  // A missing stop bit likely indicates a BREAK. A value of zero indicates a
+  // true BREAK and not some other framing error.
+  if (error) {
+    port_->SHIFTERR = mask_;
+
+    // Account for anything received using DMA. If the shifter is now empty
+    // then the DMA also took the BREAK slot.
+    int dmaCount = stopDMA();
+    if (dmaCount > 0) {
+      if ((port_->SHIFTSTAT & mask_) == 0) {
+        dmaCount--;
+        int index = receiver_->activeBufIndex_ + dmaCount;
+        uint8_t b = receiver_->activeBuf_[index];
+        receiver_->receiveBulk(dmaCount, eventTime - kCharTime);
+        if (b == 0) {
+          receiver_->receivePotentialBreak(eventTime);
+        } else {
+          receiver_->receiveBadBreak();
+        }
+        return;
+      }
+      receiver_->receiveBulk(dmaCount, eventTime - kCharTime);
+    }
+
+    if (port_->SHIFTBUFBYS[channel_] == 0) {
+      receiver_->receivePotentialBreak(eventTime);
+    } else {
+      receiver_->receiveBadBreak();
+    }
+    return;
+  }
+
+  // The slot is shifted in from the top, so it's in the low byte of the
+  // byte-swapped buffer. Reading it clears the status flag.
+  receiver_->receiveByte(port_->SHIFTBUFBYS[channel_], eventTime);
+
+  // Without IDLE detection, watch for the end of the packet after every slot.
+  // With DMA, this is only after the start code, and `flushBulk()` watches for
+  // the rest.
+  if (receiver_->state_ == Receiver::RecvStates::kData) {
+    receiver_->receiveIdle(eventTime);
+    startDMA();
+  }
+}
+
+bool FlexIOReceiveHandler::flushBulk() const {
+  int dmaCount = stopDMA();
+  if (dmaCount <= 0) {
+    return false;
+  }
+
+  // There's no record of when the slots arrived, so assume they followed the
+  // last known slot without any gaps
+  uint32_t eventTime = micros();
+  uint32_t eopTime = receiver_->lastSlotEndTime_ + kCharTime*dmaCount;
+  if (static_cast<int32_t>(eventTime - eopTime) < 0) {
+    eopTime = eventTime;
+  }
+  receiver_->receiveBulk(dmaCount, eopTime);
+
+  // Either the packet has ended or the idle timer starts again
+  if (receiver_->state_ == Receiver::RecvStates::kData) {
+    receiver_->receiveIdle(eventTime);
+    startDMA();
+  }
+  return true;
+}
+
+void FlexIOReceiveHandler::txStartBreak() const {
+}
+
+void FlexIOReceiveHandler::txStartMAB() const {
+}
+
+void FlexIOReceiveHandler::txStartData() const {
+  // There's no TX, so the response is dropped
+  receiver_->responseComplete();
+}
+
+void FlexIOReceiveHandler::txStop() const {
+}
+
+}  // namespace teensydmx
+}  // namespace qindesign
+
+#endif  // __IMXRT1062__
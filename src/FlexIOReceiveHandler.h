@@ -0,0 +1,82 @@
+// This file is part of the TeensyDMX library.
+// (c) 2022 Shawn Silverman
+
+#if defined(__IMXRT1062__)
+
+#ifndef TEENSYDMX_FLEXIORECEIVEHANDLER_H_
+#define TEENSYDMX_FLEXIORECEIVEHANDLER_H_
+
+// C++ includes
+#include <cstdint>
+#include <memory>
+
+#include <DMAChannel.h>
+#include <imxrt.h>
+
+#include "ReceiveHandler.h"
+
+namespace qindesign {
+namespace teensydmx {
+
+// Receives DMX on a FlexIO2 pin on the Teensy 4. Each channel uses its own
+// shifter and timer, the same ones a FlexIO sender on that pin would use. All
+// the channels share the FlexIO2 interrupt. See FlexIO.h.
+//
+// The timer starts on each start bit and the shifter checks the start and stop
+// bits. A BREAK is a missing stop bit with all-zero data, the same as with
+// a UART.
+//
+// FlexIO has no IDLE detection, so the idle timer is started after each slot
+// instead. With DMA, the slots after the start code are read by the DMA and
+// they're accounted for at the next BREAK, or when the idle timer expires.
+// There's also no TX, so responders can't send responses; anything they return
+// is dropped.
+class FlexIOReceiveHandler final : public ReceiveHandler {
+ public:
+  static constexpr Kind kKind = Kind::kFlexIO;
+
+  FlexIOReceiveHandler(int serialIndex, Receiver *receiver, int channel);
+
+  ~FlexIOReceiveHandler() override = default;
+
+  void start() override;
+  void end() const override;
+  void setTXEnabled(bool flag) const override;
+  void setILT(bool flag) const override;
+  void setRXWatermarkHigh(bool flag) const override;
+  void setIRQState(bool flag) const override;
+  int priority() const override;
+  void irqHandler() const override;
+  bool flushBulk() const override;
+  void txStartBreak() const override;
+  void txStartMAB() const override;
+  void txStartData() const override;
+  void txStop() const override;
+
+ private:
+  // Starts reading the rest of the packet's slots directly into the active
+  // buffer, if the receiver allows it. This disables the slot interrupt; errors
+  // still interrupt.
+  void startDMA() const;
+
+  // Stops any DMA transfer and re-enables the slot interrupt. This returns the
+  // number of slots that were transferred, zero if DMA wasn't active.
+  int stopDMA() const;
+
+  IMXRT_FLEXIO_t *port_;
+  int channel_;      // Shifter and timer index
+  uint32_t mask_;    // Shifter and timer flag bit
+  int pin_;          // Teensy pin
+  int flexIOPin_;    // FlexIO pin
+
+  // DMA, allocated in start() if the receiver wants it and the shifter's DMA
+  // request is available
+  mutable std::unique_ptr<DMAChannel> dma_;
+};
+
+}  // namespace teensydmx
+}  // namespace qindesign
+
+#endif  // TEENSYDMX_FLEXIORECEIVEHANDLER_H_
+
+#endif  // __IMXRT1062__
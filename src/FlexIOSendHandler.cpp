@@ -0,0 +1,416 @@
+// This file is part of the TeensyDMX library.
+// (c) 2022 Shawn Silverman
+
+#if defined(__IMXRT1062__)
+
+#include "FlexIOSendHandler.h"
+
+#include <core_pins.h>
+
+#include "FlexIO.h"
+#include "SenderGroup.h"
+#include "TeensyDMX.h"
+
+namespace qindesign {
+namespace teensydmx {
+
+extern const uint32_t kSlotsBaud;
+extern const uint32_t kBitTime;  // In microseconds
+
+// Data bits that are set in each slot word. The first is the slot's first stop
+// bit and the second is an extra MARK bit for a slot that's followed by a
+// pause. The shifter adds the final stop bit.
+constexpr uint32_t kSlotStopBits = 0x100;
+constexpr uint32_t kLastSlotStopBits = 0x300;
+
+// The most MARK bits that fit in a slot word after the start code or slot
+// data and its first stop bit. Longer inter-slot times use a timer.
+constexpr uint32_t kMaxGapBits = 32 - 9;
+
+FlexIOSendHandler::FlexIOSendHandler(int serialIndex,
+                                     Sender *sender,
+                                     int channel)
+    : SendHandler(serialIndex, sender, kKind),
+      port_(&IMXRT_FLEXIO2_S),
+      channel_(channel),
+      mask_(uint32_t{1} << channel),
+      pin_(flexio::pinForChannel(channel)),
+      flexIOPin_(flexio::flexIOPinForChannel(channel)),
+      slotTimCmp_(0),
+      lastSlotTimCmp_(0),
+      breakTimCmp_(0),
+      breakWord_(0),
+      gapTime_(0),
+      dataTimCmp_(0),
+      dataStopBits_(kSlotStopBits),
+      timerGap_(false),
+      completing_(false) {}
+
+void FlexIOSendHandler::start() {
+  // The BREAK parameters depend on the clock, so they're always recalculated
+  breakSerialParamsChanged_ = false;
+
+  uint32_t clock = flexio::enable();
+  slotTimCmp_ = flexio::timCmp(clock, kSlotsBaud, 9);
+  lastSlotTimCmp_ = flexio::timCmp(clock, kSlotsBaud, 10);
+  updateGap(sender_->interSlotTime_);
+
+  // The serial BREAK is one word: the BREAK bits after the start bit, and then
+  // all the MAB bits, followed by the shifter's stop bit
+  uint32_t breakBits;
+  uint32_t mabBits;
+  if (!sender_->breakSerialBits(&breakBits, &mabBits)) {
+    breakBits = 9;
+    mabBits = 1;
+  }
+  breakTimCmp_ =
+      flexio::timCmp(clock, sender_->breakBaud_, breakBits - 1 + mabBits);
+  breakWord_ = ((uint32_t{1} << mabBits) - 1) << (breakBits - 1);
+
+  setInactive();
+  completing_ = false;
+
+  // Transmit mode with a zero start bit and a one stop bit
+  port_->SHIFTCFG[channel_] =
+      FLEXIO_SHIFTCFG_SSTOP(3) | FLEXIO_SHIFTCFG_SSTART(2);
+  port_->SHIFTCTL[channel_] =
+      FLEXIO_SHIFTCTL_TIMSEL(channel_) | FLEXIO_SHIFTCTL_PINCFG(3) |
+      FLEXIO_SHIFTCTL_PINSEL(flexIOPin_) | FLEXIO_SHIFTCTL_SMOD(2);
+
+  // The timer runs while the shifter has data and it adds the stop bit
+  port_->TIMCMP[channel_] = dataTimCmp_;
+  port_->TIMCFG[channel_] =
+      FLEXIO_TIMCFG_TIMDIS(2) | FLEXIO_TIMCFG_TIMENA(2) |
+      FLEXIO_TIMCFG_TSTOP(2) | FLEXIO_TIMCFG_TSTART;
+  port_->TIMCTL[channel_] =
+      FLEXIO_TIMCTL_TRGSEL(4 * channel_ + 1) | FLEXIO_TIMCTL_TRGPOL |
+      FLEXIO_TIMCTL_TRGSRC | FLEXIO_TIMCTL_TIMOD(1);
+
+  // Hand the pin to FlexIO2 now that the shifter is driving a MARK
+  *(portControlRegister(pin_)) =
+      IOMUXC_PAD_SRE | IOMUXC_PAD_DSE(3) | IOMUXC_PAD_SPEED(3);
+  *(portConfigRegister(pin_)) = 4;  // ALT4
+
+  flexio::attachIRQ();
+}
+
+void FlexIOSendHandler::end() const {
+  setInactive();
+  completing_ = false;
+  port_->SHIFTCTL[channel_] = 0;
+  port_->TIMCTL[channel_] = 0;
+  *(portConfigRegister(pin_)) = 5;  // GPIO
+
+  flexio::detachIRQ();
+}
+
+void FlexIOSendHandler::setActive() const {
+  if (slotTimCmp_ == 0) {
+    // FlexIO2 isn't usable
+    return;
+  }
+  completing_ = false;
+  flexio::modify(port_->TIMIEN, 0, mask_);
+  flexio::modify(port_->SHIFTSIEN, mask_, 0);
+}
+
+void FlexIOSendHandler::setInactive() const {
+  flexio::modify(port_->SHIFTSIEN, 0, mask_);
+  flexio::modify(port_->TIMIEN, 0, mask_);
+}
+
+// There's no "transmission complete" flag, so this is done in two steps.
+// First, wait for the shift buffer to empty, meaning the last word is in the
+// shifter, and then wait for the timer to finish shifting it out.
+//
+// This assumes that the interrupt is serviced within one character time of the
+// last word being loaded, otherwise the end of the packet would be missed.
+void FlexIOSendHandler::setCompleting() const {
+  completing_ = true;
+  flexio::modify(port_->TIMIEN, 0, mask_);
+  flexio::modify(port_->SHIFTSIEN, mask_, 0);
+}
+
+void FlexIOSendHandler::setIRQState(bool flag) const {
+  if (flag) {
+    NVIC_ENABLE_IRQ(IRQ_FLEXIO2);
+  } else {
+    NVIC_DISABLE_IRQ(IRQ_FLEXIO2);
+  }
+}
+
+int FlexIOSendHandler::priority() const {
+  return NVIC_GET_PRIORITY(IRQ_FLEXIO2);
+}
+
+void FlexIOSendHandler::breakTimerCallback() const {
+  TEENSYDMX_PROFILE(kBreakTimer);
+
+  if (sender_->state_ == Sender::XmitStates::kBreak) {
+    startMAB();
+    sender_->mabStarted(micros());
+    sender_->state_ = Sender::XmitStates::kMAB;
+    if (sender_->intervalTimer_.restart(sender_->adjustedMABTime_)) {
+      return;
+    }
+    // See LPUARTSendHandler::breakTimerCallback() for why a failed restart
+    // isn't replaced with a delay
+    sender_->stats_.mabTimerFailures++;
+  }
+  sender_->intervalTimer_.end();
+  sender_->slotsStarted(micros());
+  sender_->state_ = Sender::XmitStates::kData;
+  setActive();
+}
+
+void FlexIOSendHandler::breakTimerPreCallback() const {
+  // Invert the line as close as possible to the timer start
+  startBreak();
+  setInactive();
+  sender_->breakStarted(micros(), true);
+}
+
+void FlexIOSendHandler::startBreak() const {
+  port_->SHIFTCTL[channel_] |= FLEXIO_SHIFTCTL_PINPOL;
+}
+
+void FlexIOSendHandler::startMAB() const {
+  port_->SHIFTCTL[channel_] &= ~FLEXIO_SHIFTCTL_PINPOL;
+  port_->TIMCMP[channel_] = dataTimCmp_;
+}
+
+void FlexIOSendHandler::sendSerialBreak() const {
+  port_->TIMCMP[channel_] = breakTimCmp_;
+  port_->SHIFTBUF[channel_] = breakWord_;
+  setCompleting();
+  sender_->breakStarted(micros(), false);
+}
+
+uint32_t FlexIOSendHandler::actualBaud(uint32_t baud) const {
+  // This assumes the clock that this configures; the clock isn't known until
+  // FlexIO2 is enabled
+  if (baud == 0) {
+    return 0;
+  }
+  uint32_t div = (flexio::timCmp(flexio::kClock, baud, 1) & 0xff) + 1;
+  return flexio::kClock / (2 * div);
+}
+
+void FlexIOSendHandler::updateGap(uint32_t t) const {
+  gapTime_ = t;
+  uint32_t bits = (t + kBitTime - 1) / kBitTime;
+  timerGap_ = (bits > kMaxGapBits);
+  if (timerGap_ || slotTimCmp_ == 0) {
+    bits = 0;
+  }
+
+  // Each of the extra MARK bits is shifted out as a one after the slot's first
+  // stop bit, and the timer shifts two more half-bit periods for each bit
+  dataTimCmp_ = slotTimCmp_ + ((2 * bits) << 8);
+  dataStopBits_ = ((uint32_t{1} << (bits + 1)) - 1) << 8;
+}
+
+void FlexIOSendHandler::interSlotTimerCallback() const {
+  TEENSYDMX_PROFILE(kInterSlotTimer);
+
+  sender_->intervalTimer_.end();
+  sender_->state_ = Sender::XmitStates::kData;
+  setActive();
+}
+
+void FlexIOSendHandler::rateTimerCallback() const {
+  TEENSYDMX_PROFILE(kRateTimer);
+
+  sender_->intervalTimer_.end();
+  setActive();
+}
+
+void FlexIOSendHandler::irqHandler() const {
+  TEENSYDMX_PROFILE(kSendIRQ);
+
+  // The interrupt is shared by all the channels, so only look at this one
+  bool shiftEnabled = (port_->SHIFTSIEN & mask_) != 0;
+  bool timEnabled = (port_->TIMIEN & mask_) != 0;
+
+  // If the shift buffer is empty
+  if (shiftEnabled && (port_->SHIFTSTAT & mask_) != 0) {
+    if (completing_) {
+      // The last word is in the shifter, so now wait for the timer
+      completing_ = false;
+      flexio::modify(port_->SHIFTSIEN, 0, mask_);
+      port_->TIMSTAT = mask_;
+      flexio::modify(port_->TIMIEN, mask_, 0);
+      return;
+    }
+
+    switch (sender_->state_) {
+      case Sender::XmitStates::kBreak:
+#ifndef TEENSYDMX_USE_PERIODICTIMER
+        if (sender_->breakUseTimer_ &&
+            sender_->intervalTimer_.begin(
+                callback<&FlexIOSendHandler::breakTimerCallback>(),
+                sender_->adjustedBreakTime_)) {
+          breakTimerPreCallback();
+#else
+        if (sender_->breakUseTimer_ &&
+            sender_->intervalTimer_.begin(
+                callback<&FlexIOSendHandler::breakTimerCallback>(),
+                sender_->breakTime_,
+                callback<&FlexIOSendHandler::breakTimerPreCallback>())) {
+#endif  // !TEENSYDMX_USE_PERIODICTIMER
+        } else {
+          // Not using a timer or starting it failed;
+          // revert to the original way
+          if (sender_->breakUseTimer_) {
+            sender_->stats_.breakTimerFailures++;
+          }
+          sendSerialBreak();
+        }
+        break;
+
+      case Sender::XmitStates::kMAB:  // Shouldn't be needed
+        sender_->state_ = Sender::XmitStates::kData;
+        setActive();
+        break;
+
+      case Sender::XmitStates::kData: {
+        int index = sender_->inactiveBufIndex_;
+        const int size = sender_->inactivePacketSize_;
+        if (index >= size) {
+          // Nothing is being shifted out, so there's nothing to wait for
+          if (sender_->completePacket()) {
+            setActive();
+          } else {
+            setInactive();
+          }
+          break;
+        }
+        uint32_t b = sender_->inactiveBuf_[index++];
+        sender_->inactiveBufIndex_ = index;
+
+        // A changed inter-slot time applies from the next word. The timer only
+        // reloads its bit count when the next word starts.
+        uint32_t t = sender_->interSlotTime_;
+        if (t != gapTime_) {
+          updateGap(t);
+          port_->TIMCMP[channel_] = dataTimCmp_;
+        }
+
+        if (index >= size || timerGap_) {
+          // Finish the stop bits before the pause or the next BREAK
+          port_->TIMCMP[channel_] = lastSlotTimCmp_;
+          port_->SHIFTBUF[channel_] = b | kLastSlotStopBits;
+          if (index < size) {
+            sender_->state_ = Sender::XmitStates::kInterSlot;
+          }
+          setCompleting();
+        } else {
+          // Any inter-slot MARK is part of the word
+          port_->SHIFTBUF[channel_] = b | dataStopBits_;
+        }
+        break;
+      }
+
+      case Sender::XmitStates::kIdle: {
+        // Pause management
+        if (sender_->paused_) {
+          setInactive();
+          if (sender_->group_ != nullptr) {
+            sender_->group_->senderIdle();
+          }
+          return;
+        }
+        if (sender_->resumeCounter_ > 0) {
+          if (--sender_->resumeCounter_ == 0) {
+            sender_->paused_ = true;
+          }
+        }
+
+        sender_->transmitting_ = true;
+        sender_->state_ = Sender::XmitStates::kBreak;
+
+        // A group starts the BREAK when all its senders are ready
+        if (sender_->group_ != nullptr) {
+          setInactive();
+          sender_->groupWaiting_ = true;
+          sender_->group_->senderIdle();
+          return;
+        }
+
+        // Delay so that we can achieve the specified refresh rate
+        // including the MBB
+        uint32_t timeSinceBreak = micros() - sender_->breakStartTime_;
+        if (sender_->breakToBreakTime_ == UINT32_MAX) {
+          // Infinite BREAK to BREAK time
+          setInactive();
+          return;
+        }
+        uint32_t delay = sender_->adjustedMBBTime_;
+        if (timeSinceBreak + delay < sender_->breakToBreakTime_) {
+          delay = sender_->breakToBreakTime_ - timeSinceBreak;
+        }
+        if (delay > 0) {
+          setInactive();
+          if (sender_->intervalTimer_.begin(
+                  callback<&FlexIOSendHandler::rateTimerCallback>(),
+                  delay)) {
+            return;
+          }
+          sender_->stats_.rateTimerFailures++;
+        }
+        // Starting the timer failed or no delay is necessary
+        setActive();
+        break;
+      }
+
+      default:
+        break;
+    }
+  }
+
+  // If the last word has been shifted out
+  if (timEnabled && (port_->TIMSTAT & mask_) != 0) {
+    port_->TIMSTAT = mask_;
+    switch (sender_->state_) {
+      case Sender::XmitStates::kBreak:
+      case Sender::XmitStates::kMAB:  // Shouldn't be needed
+        sender_->slotsStarted(micros());
+        sender_->state_ = Sender::XmitStates::kData;
+        port_->TIMCMP[channel_] = dataTimCmp_;
+        break;
+
+      case Sender::XmitStates::kData:
+        if (!sender_->completePacket()) {
+          // Wait for a repeater to receive more slots; the next one isn't
+          // the last
+          port_->TIMCMP[channel_] = dataTimCmp_;
+          setInactive();
+          return;
+        }
+        break;
+
+      case Sender::XmitStates::kInterSlot:
+        setInactive();
+        if (sender_->intervalTimer_.begin(
+                callback<&FlexIOSendHandler::interSlotTimerCallback>(),
+                sender_->adjustedInterSlotTime_)) {
+          return;
+        }
+        sender_->stats_.interSlotTimerFailures++;
+        sender_->state_ = Sender::XmitStates::kData;
+        break;
+
+      case Sender::XmitStates::kIdle:
+        break;
+
+      default:
+        break;
+    }
+    setActive();
+  }
+}
+
+}  // namespace teensydmx
+}  // namespace qindesign
+
+#endif  // __IMXRT1062__
@@ -0,0 +1,103 @@
+// This file is part of the TeensyDMX library.
+// (c) 2022 Shawn Silverman
+
+#if defined(__IMXRT1062__)
+
+#ifndef TEENSYDMX_FLEXIOSENDHANDLER_H_
+#define TEENSYDMX_FLEXIOSENDHANDLER_H_
+
+// C++ includes
+#include <cstdint>
+
+#include <imxrt.h>
+
+#include "SendHandler.h"
+#include "util/Delegate.h"
+
+namespace qindesign {
+namespace teensydmx {
+
+// Sends DMX on a FlexIO2 pin on the Teensy 4. Each channel uses its own
+// shifter and timer, so all of them can run at the same time. All the channels,
+// including any FlexIO receivers, share the FlexIO2 interrupt. See FlexIO.h.
+//
+// The slots are shifted out as 9 data bits, the last of which is a one, plus
+// the stop bit, to make 8N2. The last slot of a packet is shifted out with one
+// more MARK bit so that the final stop bit is complete before the next BREAK
+// can start.
+//
+// Inter-slot MARK time, rounded up to whole bit times, is shifted out as extra
+// ones in each slot word, up to 23 bits (92us). This keeps the gaps exact
+// without any timer or extra interrupts. Only longer times use the timer
+// between slots.
+class FlexIOSendHandler final : public SendHandler {
+ public:
+  static constexpr Kind kKind = Kind::kFlexIO;
+
+  FlexIOSendHandler(int serialIndex, Sender *sender, int channel);
+
+  ~FlexIOSendHandler() override = default;
+
+  void start() override;
+  void end() const override;
+  void setActive() const override;
+  void setIRQState(bool flag) const override;
+  int priority() const override;
+  void irqHandler() const override;
+  void startBreak() const override;
+  void startMAB() const override;
+  void sendSerialBreak() const override;
+  uint32_t actualBaud(uint32_t baud) const override;
+
+ private:
+  // Set the interrupt states
+  void setInactive() const;
+  void setCompleting() const;
+
+  // Returns a timer callback that calls the given member function.
+  template <void (FlexIOSendHandler::*Method)() const>
+  util::Delegate callback() const {
+    return util::Delegate::fromMethod<FlexIOSendHandler, Method>(this);
+  }
+
+  // Timer handling
+  void breakTimerCallback() const;      // When the timer triggers
+  void breakTimerPreCallback() const;   // Just before the timer starts
+  void interSlotTimerCallback() const;  // When the timer triggers
+
+  // Computes how slot words carry the given inter-slot time, in microseconds.
+  void updateGap(uint32_t t) const;
+  void rateTimerCallback() const;       // After the MBB delay
+
+  IMXRT_FLEXIO_t *port_;
+  int channel_;      // Shifter and timer index
+  uint32_t mask_;    // Shifter and timer flag bit
+  int pin_;          // Teensy pin
+  int flexIOPin_;    // FlexIO pin
+
+  // Timer compare values. Zero means the FlexIO clock is unusable.
+  uint32_t slotTimCmp_;
+  uint32_t lastSlotTimCmp_;
+  uint32_t breakTimCmp_;
+
+  // The serial BREAK, as one word of zeros followed by ones
+  uint32_t breakWord_;
+
+  // Slot words for the current inter-slot time. `timerGap_` is set if the time
+  // needs the timer, in which case the words have no extra MARK bits.
+  mutable uint32_t gapTime_;
+  mutable uint32_t dataTimCmp_;
+  mutable uint32_t dataStopBits_;
+  mutable bool timerGap_;
+
+  // Indicates that the driver is waiting for the last word to be loaded into
+  // the shifter before waiting for the timer to finish it.
+  mutable volatile bool completing_;
+};
+
+}  // namespace teensydmx
+}  // namespace qindesign
+
+#endif  // TEENSYDMX_FLEXIOSENDHANDLER_H_
+
+#endif  // __IMXRT1062__
@@ -19,7 +19,7 @@ extern const uint32_t kSlotsFormat;
 extern const uint32_t kCharTime;  // In microseconds
 
 void LPUARTReceiveHandler::start() {
-  receiver_->uart_.begin(kSlotsBaud, kSlotsFormat);
+  receiver_->uart_->begin(kSlotsBaud, kSlotsFormat);
 
 #if defined(__IMXRT1062__) || defined(__IMXRT1052__)
   // Calculate the FIFO size now that the peripheral has been enabled and we can
@@ -33,8 +33,39 @@ void LPUARTReceiveHandler::start() {
       txFIFOSize_ = 1 << (bits + 1);
     }
 
+    // Do the same for the RX FIFO size
+    bits = port_->FIFO & 0x07;  // RXFIFOSIZE
+    if (bits == 0) {
+      rxFIFOSize_ = 1;
+    } else {
+      rxFIFOSize_ = 1 << (bits + 1);
+    }
+
     txFIFOSizeSet_ = true;
   }
+  rxWatermark_ = (port_->WATER >> 16) & 0x03;  // RXWATER
+
+  // Allocate or release the DMA channel. Memory outside of DTCM is cached, so
+  // buffers there must be aligned to whole cache lines for DMA to be used.
+  uintptr_t bufAddr = reinterpret_cast<uintptr_t>(receiver_->buf1_);
+  if (receiver_->dmaEnabled_ &&
+      (bufAddr < 0x20200000u || (bufAddr & 31) == 0)) {
+    if (dma_ == nullptr) {
+      dma_ = std::make_unique<DMAChannel>();
+      if (dma_->channel >= DMA_NUM_CHANNELS) {
+        // No channels are available, so use interrupts
+        dma_ = nullptr;
+      } else {
+        // Reads are 8 bits wide, from the low byte of DATA
+        dma_->source(*reinterpret_cast<volatile uint8_t *>(&port_->DATA));
+        dma_->triggerAtHardwareEvent(dmaSource_);
+        dma_->disableOnCompletion();
+      }
+    }
+  } else {
+    dma_ = nullptr;
+  }
+  port_->BAUD &= ~LPUART_BAUD_RDMAE;
 #endif  // __IMXRT1062__ || __IMXRT1052__
 
   // Enable receive and interrupt on frame error
@@ -53,7 +84,10 @@ void LPUARTReceiveHandler::start() {
 #undef LPUART_CTRL_RX_ENABLE
 
 void LPUARTReceiveHandler::end() const {
-  receiver_->uart_.end();
+#if defined(__IMXRT1062__) || defined(__IMXRT1052__)
+  stopDMA();
+#endif  // __IMXRT1062__ || __IMXRT1052__
+  receiver_->uart_->end();
 }
 
 void LPUARTReceiveHandler::setTXEnabled(bool flag) const {
@@ -72,6 +106,20 @@ void LPUARTReceiveHandler::setILT(bool flag) const {
   }
 }
 
+void LPUARTReceiveHandler::setRXWatermarkHigh(bool flag) const {
+#if defined(__IMXRT1062__) || defined(__IMXRT1052__)
+  // RDRF is set when there are more slots than RXWATER. Leave room for one
+  // more slot so that there's time to respond to the interrupt before the
+  // FIFO overflows.
+  if (rxFIFOSize_ <= 2) {
+    return;
+  }
+  uint32_t water = flag ? rxFIFOSize_ - 2 : rxWatermark_;
+  port_->WATER = (port_->WATER & ~LPUART_WATER_RXWATER(0x03)) |
+                 LPUART_WATER_RXWATER(water);
+#endif  // __IMXRT1062__ || __IMXRT1052__
+}
+
 void LPUARTReceiveHandler::setIRQState(bool flag) const {
   if (flag) {
     NVIC_ENABLE_IRQ(irq_);
@@ -84,11 +132,99 @@ int LPUARTReceiveHandler::priority() const {
   return NVIC_GET_PRIORITY(irq_);
 }
 
+#if defined(__IMXRT1062__) || defined(__IMXRT1052__)
+void LPUARTReceiveHandler::startDMA() const {
+  if (dma_ == nullptr || !receiver_->isBulkReceiveAllowed()) {
+    return;
+  }
+
+  int index = receiver_->activeBufIndex_;
+  uint8_t *dst = &receiver_->activeBuf_[index];
+  int len = kMaxDMXPacketSize - index;
+  // Memory outside of DTCM is cached. Write back and discard the buffer's lines
+  // so that none are dirty while the DMA fills them; any read back in the
+  // meantime are discarded again in `stopDMA()`.
+  if (reinterpret_cast<uintptr_t>(dst) >= 0x20200000u) {
+    arm_dcache_flush_delete(dst, len);
+  }
+  dma_->destinationBuffer(dst, len);
+  dma_->clearComplete();
+  dma_->enable();
+
+  // RDRF now generates DMA requests; IDLE and framing errors still interrupt
+  port_->CTRL &= ~LPUART_CTRL_RIE;
+  port_->BAUD |= LPUART_BAUD_RDMAE;
+}
+
+int LPUARTReceiveHandler::stopDMA() const {
+  if (dma_ == nullptr || (port_->BAUD & LPUART_BAUD_RDMAE) == 0) {
+    return 0;
+  }
+
+  port_->BAUD &= ~LPUART_BAUD_RDMAE;
+  dma_->disable();
+  while ((dma_->TCD->CSR & DMA_TCD_CSR_ACTIVE) != 0) {
+    // Wait for any in-progress transfer
+  }
+  port_->CTRL |= LPUART_CTRL_RIE;
+
+  int count;
+  if (dma_->complete()) {
+    dma_->clearComplete();
+    count = dma_->TCD->BITER;
+  } else {
+    count = dma_->TCD->BITER - dma_->TCD->CITER;
+  }
+
+  // Don't let the CPU see stale cached copies of the received slots
+  uint8_t *dst = &receiver_->activeBuf_[receiver_->activeBufIndex_];
+  if (count > 0 && reinterpret_cast<uintptr_t>(dst) >= 0x20200000u) {
+    arm_dcache_delete(dst, count);
+  }
+  return count;
+}
+#endif  // __IMXRT1062__ || __IMXRT1052__
+
+void LPUARTReceiveHandler::txIRQHandler(uint32_t status) const {
+  uint32_t control = port_->CTRL;
+
+  // If the transmit buffer is empty
+  if ((control & LPUART_CTRL_TIE) != 0 && (status & LPUART_STAT_TDRE) != 0) {
+    const uint8_t *b = receiver_->responderOutBuf_;
+    int index = receiver_->responseIndex_;
+    int len = receiver_->responseLen_;
+    port_->DATA = b[index++];
+
+#if defined(__IMXRT1062__) || defined(__IMXRT1052__)
+    // Fill the FIFO
+    while (index < len &&
+           ((port_->WATER >> 8) & 0x07) < txFIFOSize_) {  // TXCOUNT
+      port_->DATA = b[index++];
+    }
+#endif  // __IMXRT1062__ || __IMXRT1052__
+
+    receiver_->responseIndex_ = index;
+    if (index >= len) {
+      // Wait until transmission complete
+      port_->CTRL = (control & ~LPUART_CTRL_TIE) | LPUART_CTRL_TCIE;
+    }
+  } else if ((control & LPUART_CTRL_TCIE) != 0 &&
+             (status & LPUART_STAT_TC) != 0) {
+    port_->CTRL = control & ~LPUART_CTRL_TCIE;
+    receiver_->responseComplete();
+  }
+}
+
 void LPUARTReceiveHandler::irqHandler() const {
+  TEENSYDMX_PROFILE(kReceiveIRQ);
+
   uint32_t status = port_->STAT;
 
   uint32_t eventTime = micros();
 
+  // Any response data
+  txIRQHandler(status);
+
   // A framing error likely indicates a BREAK, but it could also mean that there
   // were too few stop bits
   if ((status & LPUART_STAT_FE) != 0) {
@@ -100,14 +236,35 @@ void LPUARTReceiveHandler::irqHandler() const {
     port_->STAT |= (LPUART_STAT_FE | LPUART_STAT_IDLE);
 
 #if defined(__IMXRT1062__) || (__IMXRT1052__)
-    // Flush anything in the buffer
+    // Account for anything received using DMA. If the FIFO is now empty then
+    // the DMA also took the BREAK character.
+    int dmaCount = stopDMA();
     uint8_t avail = (port_->WATER >> 24) & 0x07;  // RXCOUNT
+    if (dmaCount > 0) {
+      if (avail == 0) {
+        dmaCount--;
+        int index = receiver_->activeBufIndex_ + dmaCount;
+        uint8_t b = receiver_->activeBuf_[index];
+        receiver_->receiveBulk(dmaCount, eventTime - kCharTime);
+        if (b == 0) {
+          receiver_->receivePotentialBreak(eventTime);
+        } else {
+          receiver_->receiveBadBreak();
+        }
+        return;
+      }
+      receiver_->receiveBulk(dmaCount, eventTime - kCharTime*avail);
+    }
+
+    // Flush anything in the buffer
     if (avail > 1) {
       // Read everything but the last byte
-      uint32_t timestamp = eventTime - kCharTime*avail;
-      while (--avail > 0) {
-        receiver_->receiveByte(port_->DATA, timestamp += kCharTime);
+      uint8_t data[8];  // RXCOUNT is 3 bits
+      int count = avail - 1;
+      for (int i = 0; i < count; i++) {
+        data[i] = port_->DATA;
       }
+      receiver_->receiveBytes(data, count, eventTime - kCharTime);
     }
 #endif  // __IMXRT1062__ || __IMXRT1052__
 
@@ -123,26 +280,40 @@ void LPUARTReceiveHandler::irqHandler() const {
 #if defined(__IMXRT1062__) || defined(__IMXRT1052__)
   // If the receive buffer is full or there's an idle condition
   if ((status & (LPUART_STAT_RDRF | LPUART_STAT_IDLE)) != 0) {
+    bool idle = ((status & LPUART_STAT_IDLE) != 0);
+    int dmaCount = stopDMA();
     uint8_t avail = (port_->WATER >> 24) & 0x07;  // RXCOUNT
+    uint32_t timestamp = eventTime - kCharTime*avail;
+    if (avail < ((port_->WATER >> 16) & 0x03)) {  // RXWATER
+      timestamp -= kCharTime;
+    }
+    if (dmaCount > 0) {
+      // These slots came before anything still in the FIFO
+      receiver_->receiveBulk(dmaCount, timestamp);
+    }
     if (avail == 0) {
       receiver_->receiveIdle(eventTime);
-      if ((status & LPUART_STAT_IDLE) != 0) {
+      if (idle) {
         port_->STAT |= LPUART_STAT_IDLE;  // Clear the flag
       }
     } else {
-      bool idle = ((status & LPUART_STAT_IDLE) != 0);
-      uint32_t timestamp = eventTime - kCharTime*avail;
-      if (avail < ((port_->WATER >> 16) & 0x03)) {  // RXWATER
-        timestamp -= kCharTime;
-      }
-      while (avail-- > 0) {
-        receiver_->receiveByte(port_->DATA, timestamp += kCharTime);
+      // Read the whole FIFO so that it can be processed as one batch
+      uint8_t data[8];  // RXCOUNT is 3 bits
+      for (int i = 0; i < avail; i++) {
+        data[i] = port_->DATA;
       }
+      receiver_->receiveBytes(data, avail, timestamp + kCharTime*avail);
       if (idle) {  // Also capture any IDLE event
         receiver_->receiveIdle(eventTime);
         port_->STAT |= LPUART_STAT_IDLE;  // Clear the flag
       }
     }
+
+    // Don't use DMA after an IDLE because the idle timer is now running and
+    // it wouldn't see the DMA slots
+    if (!idle) {
+      startDMA();
+    }
   }
 #else  // No FIFO
   // If the receive buffer is full
@@ -155,49 +326,20 @@ void LPUARTReceiveHandler::irqHandler() const {
 #endif  // __IMXRT1062__ || __IMXRT1052__
 }
 
-void LPUARTReceiveHandler::txData(const uint8_t *b, int len) const {
-  if (len <= 0) {
-    return;
-  }
-
-  while (len > 0) {
-    while ((port_->STAT & LPUART_STAT_TDRE) == 0) {
-      // Wait until we can transmit
-    }
-    port_->DATA = *(b++);
-    len--;
-
-#if defined(__IMXRT1062__) || defined(__IMXRT1052__)
-    // Send the FIFO
-    while (len > 0 && ((port_->WATER >> 8) & 0x07) < txFIFOSize_) {  // TXCOUNT
-      port_->DATA = *(b++);
-      len--;
-    }
-#endif  // __IMXRT1062__ || __IMXRT1052__
-  }
-
-  while ((port_->STAT & LPUART_STAT_TC) == 0) {
-    // Wait until transmission complete
-  }
+void LPUARTReceiveHandler::txStartBreak() const {
+  port_->CTRL |= LPUART_CTRL_TXINV;
 }
 
-void LPUARTReceiveHandler::txBreak(uint32_t breakTime, uint32_t mabTime) const {
-#if defined(__IMXRT1062__) || defined(__IMXRT1052__)
-  while (((port_->WATER >> 8) & 0x07) > 0) {  // TXCOUNT
-    // Wait for the FIFO to drain
-  }
-#endif  // __IMXRT1062__ || __IMXRT1052__
+void LPUARTReceiveHandler::txStartMAB() const {
+  port_->CTRL &= ~LPUART_CTRL_TXINV;
+}
 
-  while ((port_->STAT & LPUART_STAT_TC) == 0) {
-    // Wait until we can transmit
-  }
+void LPUARTReceiveHandler::txStartData() const {
+  port_->CTRL = (port_->CTRL | LPUART_CTRL_TIE) & ~LPUART_CTRL_TCIE;
+}
 
-  if (breakTime > 0) {
-    port_->CTRL |= LPUART_CTRL_TXINV;
-    delayMicroseconds(breakTime);
-    port_->CTRL &= ~LPUART_CTRL_TXINV;
-  }
-  delayMicroseconds(mabTime);
+void LPUARTReceiveHandler::txStop() const {
+  port_->CTRL &= ~(LPUART_CTRL_TIE | LPUART_CTRL_TCIE | LPUART_CTRL_TXINV);
 }
 
 }  // namespace teensydmx
@@ -10,6 +10,9 @@
 #include <cstdint>
 
 #if defined(__IMXRT1062__) || defined(__IMXRT1052__)
+#include <memory>
+
+#include <DMAChannel.h>
 #include <imxrt.h>
 using PortType = IMXRT_LPUART_t;
 #elif defined(__MK66FX1M0__)
@@ -25,19 +28,34 @@ namespace teensydmx {
 
 class LPUARTReceiveHandler final : public ReceiveHandler {
  public:
+  static constexpr Kind kKind = Kind::kLPUART;
+
   LPUARTReceiveHandler(int serialIndex,
                        Receiver *receiver,
                        PortType *port,
                        IRQ_NUMBER_t irq,
+#if defined(__IMXRT1062__) || defined(__IMXRT1052__)
+                       void (*irqHandler)(),
+                       uint8_t dmaSource)
+#else
                        void (*irqHandler)())
-      : ReceiveHandler(serialIndex, receiver),
+#endif  // __IMXRT1062__ || __IMXRT1052__
+      : ReceiveHandler(serialIndex, receiver, kKind),
         port_(port),
 #if defined(__IMXRT1062__) || defined(__IMXRT1052__)
         txFIFOSizeSet_(false),
         txFIFOSize_(1),
+        rxFIFOSize_(1),
+        rxWatermark_(0),
 #endif  // __IMXRT1062__ || __IMXRT1052__
         irq_(irq),
+#if defined(__IMXRT1062__) || defined(__IMXRT1052__)
+        irqHandler_(irqHandler),
+        dmaSource_(dmaSource),
+        dma_{nullptr} {}
+#else
         irqHandler_(irqHandler) {}
+#endif  // __IMXRT1062__ || __IMXRT1052__
 
   ~LPUARTReceiveHandler() override = default;
 
@@ -45,20 +63,45 @@ class LPUARTReceiveHandler final : public ReceiveHandler {
   void end() const override;
   void setTXEnabled(bool flag) const override;
   void setILT(bool flag) const override;
+  void setRXWatermarkHigh(bool flag) const override;
   void setIRQState(bool flag) const override;
   int priority() const override;
   void irqHandler() const override;
-  void txData(const uint8_t *b, int len) const override;
-  void txBreak(uint32_t breakTime, uint32_t mabTime) const override;
+  void txStartBreak() const override;
+  void txStartMAB() const override;
+  void txStartData() const override;
+  void txStop() const override;
 
  private:
+  // Handles the TX interrupts for sending a response, given the status
+  // register value.
+  void txIRQHandler(uint32_t status) const;
+
+#if defined(__IMXRT1062__) || defined(__IMXRT1052__)
+  // Starts receiving the rest of the packet's slots directly into the active
+  // buffer, if the receiver allows it. This disables the RX data interrupt.
+  void startDMA() const;
+
+  // Stops any DMA transfer and re-enables the RX data interrupt. This returns
+  // the number of slots that were transferred, zero if DMA wasn't active.
+  int stopDMA() const;
+#endif  // __IMXRT1062__ || __IMXRT1052__
+
   PortType *port_;
 #if defined(__IMXRT1062__) || defined(__IMXRT1052__)
   bool txFIFOSizeSet_;
   uint32_t txFIFOSize_;
+  uint32_t rxFIFOSize_;
+  uint32_t rxWatermark_;  // The RXWATER set when the UART was started
 #endif  // __IMXRT1062__ || __IMXRT1052__
   IRQ_NUMBER_t irq_;
   void (*const irqHandler_)();
+
+#if defined(__IMXRT1062__) || defined(__IMXRT1052__)
+  // DMA, allocated in start() if the receiver wants it
+  uint8_t dmaSource_;
+  std::unique_ptr<DMAChannel> dma_;
+#endif  // __IMXRT1062__ || __IMXRT1052__
 };
 
 }  // namespace teensydmx
@@ -7,6 +7,8 @@
 
 #include <core_pins.h>
 
+#include "SenderGroup.h"
+
 namespace qindesign {
 namespace teensydmx {
 
@@ -19,18 +21,22 @@ namespace teensydmx {
 extern const uint32_t kSlotsBaud;
 extern const uint32_t kSlotsFormat;
 
+// Writing this to DATA queues an idle character: FRETSC and T9 set, with the
+// rest of the data bits zero (T9 clear would queue a break character instead)
+constexpr uint32_t kIdleChar = (uint32_t{1} << 13) | (uint32_t{1} << 9);
+
 void LPUARTSendHandler::start() {
   if (breakSerialParamsChanged_) {
-    sender_->uart_.begin(sender_->breakBaud_, sender_->breakFormat_);
+    sender_->uart_->begin(sender_->breakBaud_, sender_->breakFormat_);
     breakSerialParams_.getFrom(port_);
     breakSerialParamsChanged_ = false;
   }
   if (!slotsSerialParamsSet_) {
-    sender_->uart_.begin(kSlotsBaud, kSlotsFormat);
+    sender_->uart_->begin(kSlotsBaud, kSlotsFormat);
     slotsSerialParams_.getFrom(port_);
     slotsSerialParamsSet_ = true;
   } else {
-    sender_->uart_.begin(kSlotsBaud, kSlotsFormat);
+    sender_->uart_->begin(kSlotsBaud, kSlotsFormat);
   }
 
 #if defined(__IMXRT1062__) || defined(__IMXRT1052__)
@@ -49,11 +55,35 @@ void LPUARTSendHandler::start() {
   }
 #endif  // __IMXRT1062__ || __IMXRT1052__
 
+  // Allocate or release the DMA channel
+  if (sender_->dmaEnabled_) {
+    if (dma_ == nullptr) {
+      dma_ = std::make_unique<DMAChannel>();
+      if (dma_->channel >= DMA_NUM_CHANNELS) {
+        // No channels are available, so use interrupts
+        dma_ = nullptr;
+      } else {
+        // Writes are 8 bits wide, to the low byte of DATA
+        dma_->destination(*reinterpret_cast<volatile uint8_t *>(&port_->DATA));
+        dma_->triggerAtHardwareEvent(dmaSource_);
+        dma_->disableOnCompletion();
+      }
+    }
+  } else {
+    dma_ = nullptr;
+  }
+  port_->BAUD &= ~LPUART_BAUD_TDMAE;
+  idlePending_ = false;
+
   attachInterruptVector(irq_, irqHandler_);
 }
 
 void LPUARTSendHandler::end() const {
-  sender_->uart_.end();
+  if (dma_ != nullptr) {
+    port_->BAUD &= ~LPUART_BAUD_TDMAE;
+    dma_->disable();
+  }
+  sender_->uart_->end();
 }
 
 void LPUARTSendHandler::setActive() const {
@@ -71,6 +101,31 @@ void LPUARTSendHandler::setCompleting() const {
       (port_->CTRL | (LPUART_CTRL_TE | LPUART_CTRL_TCIE)) & ~LPUART_CTRL_TIE;
 }
 
+bool LPUARTSendHandler::startDMA() const {
+  int index = sender_->inactiveBufIndex_;
+  int len = sender_->inactivePacketSize_ - index;
+  if (len <= 0) {
+    return false;
+  }
+
+  const volatile uint8_t *src = &sender_->inactiveBuf_[index];
+#if defined(__IMXRT1062__) || defined(__IMXRT1052__)
+  // Memory outside of DTCM is cached
+  if (reinterpret_cast<uintptr_t>(src) >= 0x20200000u) {
+    arm_dcache_flush(const_cast<uint8_t *>(src), len);
+  }
+#endif  // __IMXRT1062__ || __IMXRT1052__
+  dma_->sourceBuffer(src, len);
+  dma_->clearComplete();
+  sender_->inactiveBufIndex_ = sender_->inactivePacketSize_;
+
+  // TDRE now generates DMA requests; the only interrupt is TC at the end
+  setCompleting();
+  dma_->enable();
+  port_->BAUD |= LPUART_BAUD_TDMAE;
+  return true;
+}
+
 void LPUARTSendHandler::setIRQState(bool flag) const {
   if (flag) {
     NVIC_ENABLE_IRQ(irq_);
@@ -84,8 +139,11 @@ int LPUARTSendHandler::priority() const {
 }
 
 void LPUARTSendHandler::breakTimerCallback() const {
+  TEENSYDMX_PROFILE(kBreakTimer);
+
   if (sender_->state_ == Sender::XmitStates::kBreak) {
-    port_->CTRL &= ~LPUART_CTRL_TXINV;
+    startMAB();
+    sender_->mabStarted(micros());
     sender_->state_ = Sender::XmitStates::kMAB;
     if (sender_->intervalTimer_.restart(sender_->adjustedMABTime_)) {
       return;
@@ -97,31 +155,89 @@ void LPUARTSendHandler::breakTimerCallback() const {
     // We shouldn't delay as an alternative because that might
     // mean we delay too long, however the MAB is most likely to
     // be too short in this case
+    sender_->stats_.mabTimerFailures++;
   }
   sender_->intervalTimer_.end();
+  sender_->slotsStarted(micros());
   sender_->state_ = Sender::XmitStates::kData;
   setActive();
 }
 
 void LPUARTSendHandler::breakTimerPreCallback() const {
   // Invert the line as close as possible to the timer start
-  port_->CTRL |= LPUART_CTRL_TXINV;
+  startBreak();
   setInactive();
-  sender_->breakStartTime_ = micros();
+  sender_->breakStarted(micros(), true);
+}
+
+void LPUARTSendHandler::startBreak() const {
+  port_->CTRL |= LPUART_CTRL_TXINV;
+}
+
+void LPUARTSendHandler::startMAB() const {
+  port_->CTRL &= ~LPUART_CTRL_TXINV;
+}
+
+void LPUARTSendHandler::sendSerialBreak() const {
+  breakSerialParams_.apply(port_);
+  port_->DATA = 0;
+  setCompleting();
+  sender_->breakStarted(micros(), false);
+}
+
+uint32_t LPUARTSendHandler::actualBaud(uint32_t baud) const {
+  if (baud == 0) {
+    return 0;
+  }
+
+#if defined(__IMXRT1062__) || defined(__IMXRT1052__)
+  // This matches the search in the core's `HardwareSerial::begin()`: the
+  // oversampling ratio and divisor with the least error, preferring the
+  // higher ratio
+  constexpr uint32_t kClock = 24000000;
+  uint32_t bestDiv = 1;
+  uint32_t bestOSR = 4;
+  uint32_t bestErr = UINT32_MAX;
+  for (uint32_t osr = 4; osr <= 32; osr++) {
+    uint32_t div = (kClock + (osr * baud >> 1)) / (osr * baud);
+    if (div < 1) {
+      div = 1;
+    } else if (div > 8191) {
+      div = 8191;
+    }
+    uint32_t actual = kClock / (osr * div);
+    uint32_t err = (actual > baud) ? actual - baud : baud - actual;
+    if (err <= bestErr) {
+      bestErr = err;
+      bestDiv = div;
+      bestOSR = osr;
+    }
+  }
+  return kClock / (bestOSR * bestDiv);
+#else
+  // The Teensy 3.6 LPUART0 divisor isn't modelled
+  return baud;
+#endif  // __IMXRT1062__ || __IMXRT1052__
 }
 
 void LPUARTSendHandler::interSlotTimerCallback() const {
+  TEENSYDMX_PROFILE(kInterSlotTimer);
+
   sender_->intervalTimer_.end();
   sender_->state_ = Sender::XmitStates::kData;
   setActive();
 }
 
 void LPUARTSendHandler::rateTimerCallback() const {
+  TEENSYDMX_PROFILE(kRateTimer);
+
   sender_->intervalTimer_.end();
   setActive();
 }
 
 void LPUARTSendHandler::irqHandler() const {
+  TEENSYDMX_PROFILE(kSendIRQ);
+
   uint32_t status = port_->STAT;
   uint32_t control = port_->CTRL;
 
@@ -132,23 +248,23 @@ void LPUARTSendHandler::irqHandler() const {
 #ifndef TEENSYDMX_USE_PERIODICTIMER
         if (sender_->breakUseTimer_ &&
             sender_->intervalTimer_.begin(
-                [this]() { breakTimerCallback(); },
+                callback<&LPUARTSendHandler::breakTimerCallback>(),
                 sender_->adjustedBreakTime_)) {
           breakTimerPreCallback();
 #else
         if (sender_->breakUseTimer_ &&
             sender_->intervalTimer_.begin(
-                [this]() { breakTimerCallback(); },
+                callback<&LPUARTSendHandler::breakTimerCallback>(),
                 sender_->breakTime_,
-                [this]() { breakTimerPreCallback(); })) {
+                callback<&LPUARTSendHandler::breakTimerPreCallback>())) {
 #endif  // !TEENSYDMX_USE_PERIODICTIMER
         } else {
           // Not using a timer or starting it failed;
           // revert to the original way
-          breakSerialParams_.apply(port_);
-          port_->DATA = 0;
-          setCompleting();
-          sender_->breakStartTime_ = micros();
+          if (sender_->breakUseTimer_) {
+            sender_->stats_.breakTimerFailures++;
+          }
+          sendSerialBreak();
         }
         break;
 
@@ -158,15 +274,46 @@ void LPUARTSendHandler::irqHandler() const {
         break;
 
       case Sender::XmitStates::kData:
+        if (dma_ != nullptr && sender_->interSlotTime_ == 0 && startDMA()) {
+          sender_->frameDMA_ = true;
+          break;
+        }
 #if defined(__IMXRT1062__) || defined(__IMXRT1052__)
         if (sender_->interSlotTime_ == 0) {
+          // The packet state can't change under the ISR, so read it once
+          // and not for every slot
+          const volatile uint8_t *buf = sender_->inactiveBuf_;
+          int index = sender_->inactiveBufIndex_;
+          const int size = sender_->inactivePacketSize_;
           do {
-            if (sender_->inactiveBufIndex_ >= sender_->inactivePacketSize_) {
+            if (index >= size) {
               setCompleting();
               break;
             }
-            port_->DATA = sender_->inactiveBuf_[sender_->inactiveBufIndex_++];
+            port_->DATA = buf[index++];
+          } while (((port_->WATER >> 8) & 0x07) < fifoSize_);  // TXCOUNT
+          sender_->inactiveBufIndex_ = index;
+        } else if (sender_->useInterSlotIdleChars()) {
+          // Idle characters go through the FIFO like slots, so keep it full,
+          // with an idle character ahead of each slot after the start code
+          const volatile uint8_t *buf = sender_->inactiveBuf_;
+          int index = sender_->inactiveBufIndex_;
+          const int size = sender_->inactivePacketSize_;
+          bool idle = idlePending_;
+          do {
+            if (idle) {
+              port_->DATA = kIdleChar;
+              idle = false;
+            } else if (index >= size) {
+              setCompleting();
+              break;
+            } else {
+              port_->DATA = buf[index++];
+              idle = (index < size);
+            }
           } while (((port_->WATER >> 8) & 0x07) < fifoSize_);  // TXCOUNT
+          idlePending_ = idle;
+          sender_->inactiveBufIndex_ = index;
         } else {
           // Don't use the FIFO
           if (sender_->inactiveBufIndex_ < sender_->inactivePacketSize_) {
@@ -178,10 +325,16 @@ void LPUARTSendHandler::irqHandler() const {
           setCompleting();
         }
 #else  // No FIFO
-        if (sender_->inactiveBufIndex_ < sender_->inactivePacketSize_) {
+        if (idlePending_) {
+          // The idle character ahead of the slot
+          port_->DATA = kIdleChar;
+          idlePending_ = false;
+        } else if (sender_->inactiveBufIndex_ < sender_->inactivePacketSize_) {
           port_->DATA = sender_->inactiveBuf_[sender_->inactiveBufIndex_++];
           if (sender_->inactiveBufIndex_ >= sender_->inactivePacketSize_) {
             setCompleting();
+          } else if (sender_->useInterSlotIdleChars()) {
+            idlePending_ = true;
           } else if (sender_->interSlotTime_ != 0) {
             sender_->state_ = Sender::XmitStates::kInterSlot;
             setCompleting();
@@ -196,6 +349,9 @@ void LPUARTSendHandler::irqHandler() const {
         // Pause management
         if (sender_->paused_) {
           setInactive();
+          if (sender_->group_ != nullptr) {
+            sender_->group_->senderIdle();
+          }
           return;
         }
         if (sender_->resumeCounter_ > 0) {
@@ -207,6 +363,14 @@ void LPUARTSendHandler::irqHandler() const {
         sender_->transmitting_ = true;
         sender_->state_ = Sender::XmitStates::kBreak;
 
+        // A group starts the BREAK when all its senders are ready
+        if (sender_->group_ != nullptr) {
+          setInactive();
+          sender_->groupWaiting_ = true;
+          sender_->group_->senderIdle();
+          return;
+        }
+
         // Delay so that we can achieve the specified refresh rate
         // including the MBB
         uint32_t timeSinceBreak = micros() - sender_->breakStartTime_;
@@ -222,10 +386,11 @@ void LPUARTSendHandler::irqHandler() const {
         if (delay > 0) {
           setInactive();
           if (sender_->intervalTimer_.begin(
-                  [this]() { rateTimerCallback(); },
+                  callback<&LPUARTSendHandler::rateTimerCallback>(),
                   delay)) {
             return;
           }
+          sender_->stats_.rateTimerFailures++;
         }
         // Starting the timer failed or no delay is necessary
         setActive();
@@ -241,6 +406,7 @@ void LPUARTSendHandler::irqHandler() const {
   if ((control & LPUART_CTRL_TCIE) != 0 && (status & LPUART_STAT_TC) != 0) {
     switch (sender_->state_) {
       case Sender::XmitStates::kBreak:
+        sender_->slotsStarted(micros());
         sender_->state_ = Sender::XmitStates::kData;
         slotsSerialParams_.apply(port_);
         break;
@@ -251,16 +417,30 @@ void LPUARTSendHandler::irqHandler() const {
         break;
 
       case Sender::XmitStates::kData:
-        sender_->completePacket();
+        if ((port_->BAUD & LPUART_BAUD_TDMAE) != 0) {
+          // TC may have been stale when the transfer started, so wait until
+          // the DMA is done and the last slot has actually been sent
+          if (!dma_->complete() || (port_->STAT & LPUART_STAT_TC) == 0) {
+            return;
+          }
+          port_->BAUD &= ~LPUART_BAUD_TDMAE;
+          dma_->clearComplete();
+        }
+        if (!sender_->completePacket()) {
+          // Wait for a repeater to receive more slots
+          setInactive();
+          return;
+        }
         break;
 
       case Sender::XmitStates::kInterSlot:
         setInactive();
         if (sender_->intervalTimer_.begin(
-                [this]() { interSlotTimerCallback(); },
+                callback<&LPUARTSendHandler::interSlotTimerCallback>(),
                 sender_->adjustedInterSlotTime_)) {
           return;
         }
+        sender_->stats_.interSlotTimerFailures++;
         sender_->state_ = Sender::XmitStates::kData;
         break;
 
@@ -8,6 +8,9 @@
 
 // C++ includes
 #include <cstdint>
+#include <memory>
+
+#include <DMAChannel.h>
 
 #if defined(__IMXRT1062__) || defined(__IMXRT1052__)
 #include <imxrt.h>
@@ -19,18 +22,22 @@ using PortType = KINETISK_LPUART_t;
 
 #include "SendHandler.h"
 #include "TeensyDMX.h"
+#include "util/Delegate.h"
 
 namespace qindesign {
 namespace teensydmx {
 
 class LPUARTSendHandler final : public SendHandler {
  public:
+  static constexpr Kind kKind = Kind::kLPUART;
+
   LPUARTSendHandler(int serialIndex,
                     Sender *sender,
                     PortType *port,
                     IRQ_NUMBER_t irq,
-                    void (*irqHandler)())
-      : SendHandler(serialIndex, sender),
+                    void (*irqHandler)(),
+                    uint8_t dmaSource)
+      : SendHandler(serialIndex, sender, kKind),
         port_(port),
 #if defined(__IMXRT1062__) || defined(__IMXRT1052__)
         fifoSizeSet_(false),
@@ -38,6 +45,9 @@ class LPUARTSendHandler final : public SendHandler {
 #endif  // __IMXRT1062__ || __IMXRT1052__
         irq_(irq),
         irqHandler_(irqHandler),
+        dmaSource_(dmaSource),
+        dma_{nullptr},
+        idlePending_(false),
         slotsSerialParamsSet_(false) {}
 
   ~LPUARTSendHandler() override = default;
@@ -48,6 +58,10 @@ class LPUARTSendHandler final : public SendHandler {
   void setIRQState(bool flag) const override;
   int priority() const override;
   void irqHandler() const override;
+  void startBreak() const override;
+  void startMAB() const override;
+  void sendSerialBreak() const override;
+  uint32_t actualBaud(uint32_t baud) const override;
 
  private:
   // Stored LPUART parameters for quickly setting the baud rate between BREAK
@@ -74,6 +88,16 @@ class LPUARTSendHandler final : public SendHandler {
   void setInactive() const;
   void setCompleting() const;
 
+  // Starts sending the rest of the packet using DMA and puts the UART into
+  // "COMPLETING" mode. This returns whether the transfer was started.
+  bool startDMA() const;
+
+  // Returns a timer callback that calls the given member function.
+  template <void (LPUARTSendHandler::*Method)() const>
+  util::Delegate callback() const {
+    return util::Delegate::fromMethod<LPUARTSendHandler, Method>(this);
+  }
+
   // Timer handling
   void breakTimerCallback() const;      // When the timer triggers
   void breakTimerPreCallback() const;   // Just before the timer starts
@@ -88,6 +112,13 @@ class LPUARTSendHandler final : public SendHandler {
   IRQ_NUMBER_t irq_;
   void (*irqHandler_)();
 
+  // DMA, allocated in start() if the sender wants it
+  uint8_t dmaSource_;
+  std::unique_ptr<DMAChannel> dma_;
+
+  // Whether an idle character is to be sent before the next slot
+  mutable bool idlePending_;
+
   bool slotsSerialParamsSet_;
   SerialParams breakSerialParams_;
   SerialParams slotsSerialParams_;
@@ -0,0 +1,254 @@
+// This file is part of the TeensyDMX library.
+// (c) 2022 Shawn Silverman
+
+#include "Merger.h"
+
+// C++ includes
+#include <algorithm>
+#include <cstring>
+
+#include <core_pins.h>
+
+namespace qindesign {
+namespace teensydmx {
+
+#if defined(__ARM_FEATURE_DSP)
+// Returns the bytewise maximum of two words. USUB8 sets a GE flag for each
+// byte where `a` >= `b`, and SEL uses the flags to pick each byte.
+static inline uint32_t max4(uint32_t a, uint32_t b) {
+  uint32_t r;
+  __asm__("usub8 %0, %1, %2\n\t"
+          "sel %0, %1, %2"
+          : "=&r"(r)
+          : "r"(a), "r"(b)
+          : "cc");
+  return r;
+}
+#endif  // __ARM_FEATURE_DSP
+
+// Sets each byte of `out` to the larger of itself and the same byte in `in`.
+// Chips with the DSP extension do four bytes at a time.
+static void mergeHTP(uint8_t *out, const uint8_t *in, int len) {
+  int i = 0;
+#if defined(__ARM_FEATURE_DSP)
+  for (; i + 4 <= len; i += 4) {
+    uint32_t a;
+    uint32_t b;
+    std::memcpy(&a, &out[i], 4);
+    std::memcpy(&b, &in[i], 4);
+    a = max4(a, b);
+    std::memcpy(&out[i], &a, 4);
+  }
+#endif  // __ARM_FEATURE_DSP
+  for (; i < len; i++) {
+    out[i] = std::max(out[i], in[i]);
+  }
+}
+
+Merger::Merger(Sender &sender)
+    : sender_(sender),
+      sources_{},
+      count_(0),
+      ltpMask_{0} {
+  std::fill_n(&owners_[0], kMaxDMXPacketSize, -1);
+}
+
+Merger::~Merger() {
+  for (int i = 0; i < count_; i++) {
+    sources_[i].receiver->unclaimFrames(this);
+  }
+}
+
+bool Merger::add(Receiver &r, uint8_t priority, uint32_t timeout) {
+  if (count_ >= kMaxSources) {
+    return false;
+  }
+  for (int i = 0; i < count_; i++) {
+    if (sources_[i].receiver == &r) {
+      return false;
+    }
+  }
+
+  if (!r.claimFrames(this)) {
+    return false;
+  }
+
+  Source &s = sources_[count_++];
+  s = Source{};
+  s.receiver = &r;
+  s.priority = priority;
+  s.timeout = timeout;
+  return true;
+}
+
+bool Merger::setPriority(int source, uint8_t priority) {
+  if (source < 0 || count_ <= source) {
+    return false;
+  }
+  sources_[source].priority = priority;
+  return true;
+}
+
+bool Merger::setTimeout(int source, uint32_t timeout) {
+  if (source < 0 || count_ <= source) {
+    return false;
+  }
+  sources_[source].timeout = timeout;
+  return true;
+}
+
+bool Merger::isMerged(int source) const {
+  if (source < 0 || count_ <= source) {
+    return false;
+  }
+  return sources_[source].merged;
+}
+
+void Merger::setChannelModes(int startChannel, int len, Modes mode) {
+  int end = std::min(startChannel + len, kMaxDMXPacketSize);
+  for (int c = std::max(startChannel, 1); c < end; c++) {
+    if (mode == Modes::kLTP) {
+      ltpMask_[c/32] |= uint32_t{1} << (c%32);
+    } else {
+      ltpMask_[c/32] &= ~(uint32_t{1} << (c%32));
+    }
+  }
+}
+
+Merger::Modes Merger::channelMode(int channel) const {
+  if (channel < 1 || kMaxDMXPacketSize <= channel) {
+    return Modes::kHTP;
+  }
+  if ((ltpMask_[channel/32] & (uint32_t{1} << (channel%32))) != 0) {
+    return Modes::kLTP;
+  }
+  return Modes::kHTP;
+}
+
+void Merger::updateOwners(const int *order, int n) {
+  uint32_t changes[Receiver::kChangeWords];
+  for (int k = 0; k < n; k++) {
+    Source &s = sources_[order[k]];
+
+    // Always drain the changes, but only DMX data takes channels
+    if (!s.receiver->readChangesFor(this, changes)) {
+      continue;
+    }
+    if (s.view.size <= 0 || s.view.data[0] != 0) {
+      continue;
+    }
+    for (int w = 0; w < Receiver::kChangeWords; w++) {
+      uint32_t bits = changes[w] & ltpMask_[w];
+      while (bits != 0) {
+        owners_[32*w + __builtin_ctz(bits)] = order[k];
+        bits &= bits - 1;
+      }
+    }
+  }
+}
+
+bool Merger::merge() {
+  uint32_t now = millis();
+
+  // Acquire every source's latest packet and note which ones are new, in
+  // packet order
+  int newOrder[kMaxSources]{};
+  int newCount = 0;
+  int maxPriority = -1;
+  for (int i = 0; i < count_; i++) {
+    Source &s = sources_[i];
+    s.merged = false;
+    if (s.receiver->acquireFrameFor(this, s.view)) {
+      s.lastFrameTime = now;
+      int j = newCount++;
+      while (j > 0 &&
+             static_cast<int32_t>(
+                 s.view.stats.frameTimestamp -
+                 sources_[newOrder[j - 1]].view.stats.frameTimestamp) < 0) {
+        newOrder[j] = newOrder[j - 1];
+        j--;
+      }
+      newOrder[j] = i;
+    }
+
+    if (!s.receiver->connected() || s.view.generation == 0 ||
+        now - s.lastFrameTime >= s.timeout) {
+      continue;
+    }
+    s.merged = true;
+    maxPriority = std::max(maxPriority, static_cast<int>(s.priority));
+  }
+
+  updateOwners(newOrder, newCount);
+
+  // Only merge the highest-priority sources, and only if they all have
+  // DMX data
+  int size = 0;
+  bool write = (maxPriority >= 0);
+  for (int i = 0; i < count_; i++) {
+    Source &s = sources_[i];
+    if (!s.merged) {
+      continue;
+    }
+    if (s.priority != maxPriority) {
+      s.merged = false;
+      continue;
+    }
+    if (s.view.size <= 0 || s.view.data[0] != 0) {
+      write = false;
+    }
+    size = std::max(size, s.view.size);
+  }
+
+  if (write) {
+    Sender::WriteAccess access{sender_, true};
+    //{
+      // Nothing else reads this buffer while we have access to it
+      uint8_t *out = const_cast<uint8_t *>(access.buf());
+
+      std::fill_n(&out[0], size, 0);
+      for (int i = 0; i < count_; i++) {
+        const Source &s = sources_[i];
+        if (s.merged) {
+          mergeHTP(out, s.view.data, s.view.size);
+        }
+      }
+
+      // LTP channels take the value from the source that last changed them.
+      // Only the words below `size` are looked at, and only the last of those
+      // can have channels past the end.
+      for (int w = 0; w < Receiver::kChangeWords && 32*w < size; w++) {
+        uint32_t bits = ltpMask_[w];
+        while (bits != 0) {
+          int c = 32*w + __builtin_ctz(bits);
+          bits &= bits - 1;
+          if (c >= size) {
+            break;
+          }
+          int o = owners_[c];
+          if (o >= 0 && sources_[o].merged && c < sources_[o].view.size) {
+            out[c] = sources_[o].view.data[c];
+          }
+        }
+      }
+
+      out[0] = 0;
+      access.setPacketSize(size);
+      sender_.markChannels(0, out, size);
+    //}
+  }
+
+  for (int i = 0; i < count_; i++) {
+    sources_[i].receiver->releaseFrameFor(this);
+  }
+
+  if (!write) {
+    for (int i = 0; i < count_; i++) {
+      sources_[i].merged = false;
+    }
+  }
+  return write;
+}
+
+}  // namespace teensydmx
+}  // namespace qindesign
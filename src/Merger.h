@@ -0,0 +1,151 @@
+// This file is part of the TeensyDMX library.
+// (c) 2022 Shawn Silverman
+
+// Merger.h defines a way to merge the packets from several receivers into the
+// packets sent by one sender.
+
+#ifndef TEENSYDMX_MERGER_H_
+#define TEENSYDMX_MERGER_H_
+
+// C++ includes
+#include <cstdint>
+
+#include "TeensyDMX.h"
+
+namespace qindesign {
+namespace teensydmx {
+
+// Merges the latest packets from several receivers, the sources, and writes
+// the result into a sender's buffer. Each channel is merged either with
+// highest-takes-precedence (HTP), where the largest value wins, or with
+// latest-takes-precedence (LTP), where the source that most recently changed
+// the channel wins. The start code is always zero.
+//
+// Only the active sources that have the highest priority are merged. A source
+// is active when its receiver is connected (see `Receiver::connected()`) and it
+// has received a packet within its timeout. Packets having a non-zero start
+// code aren't merged; while a source's latest packet has one, `merge()` leaves
+// the output alone.
+//
+// The merge reads the sources' packets in place using `Receiver::acquireFrame`
+// and it writes straight into the sender's buffer, or into its staging buffer
+// if a frame is open. It doesn't copy the packets anywhere else.
+//
+// LTP uses each receiver's change tracking, so adding a source enables it. A
+// receiver can only have one frame view and one reader of its changes, so a
+// source is used only by this merger until the merger is destroyed. Until
+// then, the receiver's `acquireFrame`, `releaseFrame`, and `readChanges` don't
+// do anything for the application. If the source that last changed an LTP
+// channel is no longer merged, then that channel falls back to HTP.
+class Merger final {
+ public:
+  // The maximum number of sources.
+  static constexpr int kMaxSources = 4;
+
+  // The default source priority. Higher values take precedence.
+  static constexpr uint8_t kDefaultPriority = 100;
+
+  // The default source timeout, in milliseconds.
+  static constexpr uint32_t kDefaultTimeout = 1000;
+
+  // How a channel is merged.
+  enum class Modes {
+    kHTP,  // Highest takes precedence
+    kLTP,  // Latest takes precedence
+  };
+
+  // Creates a new merger that writes to the given sender. All channels are
+  // initially HTP.
+  explicit Merger(Sender &sender);
+
+  // Destructs the merger and gives the sources' frame views and change
+  // tracking back to the application. The change tracking is disabled.
+  ~Merger();
+
+  // The state refers to the sender and receivers, so it can't be copied
+  // or moved
+  Merger(const Merger &) = delete;
+  Merger &operator=(const Merger &) = delete;
+
+  // Adds a source having the given priority and timeout, in milliseconds, and
+  // enables its change tracking. This returns `false` if the merger is full, if
+  // the receiver has already been added, or if the receiver is used by
+  // something else: another `Merger`, a `USBProWidget`, or the application, if
+  // it's holding a frame view or has enabled change tracking. Otherwise, this
+  // returns `true`.
+  //
+  // Sources are numbered in the order they're added, starting from zero.
+  bool add(Receiver &r,
+           uint8_t priority = kDefaultPriority,
+           uint32_t timeout = kDefaultTimeout);
+
+  // Returns the number of sources.
+  int size() const {
+    return count_;
+  }
+
+  // Sets a source's priority. This returns `false` if the source doesn't exist.
+  bool setPriority(int source, uint8_t priority);
+
+  // Sets a source's timeout, in milliseconds. This returns `false` if the
+  // source doesn't exist.
+  bool setTimeout(int source, uint32_t timeout);
+
+  // Returns whether a source was merged in the last call to `merge()`. This
+  // returns `false` if the source doesn't exist.
+  bool isMerged(int source) const;
+
+  // Sets the merge mode for a range of channels. Channels outside the range
+  // 1-512 are ignored.
+  void setChannelModes(int startChannel, int len, Modes mode);
+
+  // Sets the merge mode for one channel. See `setChannelModes`.
+  void setChannelMode(int channel, Modes mode) {
+    setChannelModes(channel, 1, mode);
+  }
+
+  // Returns a channel's merge mode. This returns `Modes::kHTP` for channels
+  // outside the range 1-512.
+  Modes channelMode(int channel) const;
+
+  // Merges the latest packets and writes the result to the sender. The packet
+  // size is the largest size of the merged packets. A source that's too short
+  // for a channel doesn't contribute to it.
+  //
+  // This returns whether the output was written. It's not written if no source
+  // is active or if an active source's latest packet has a non-zero start
+  // code. Call this from the main loop, for example after any source receives
+  // a packet.
+  bool merge();
+
+ private:
+  // Per-source state.
+  struct Source {
+    Receiver *receiver = nullptr;
+    uint8_t priority = kDefaultPriority;
+    uint32_t timeout = kDefaultTimeout;
+    Receiver::FrameView view;
+    uint32_t lastFrameTime = 0;  // When the last new packet was seen, in ms
+    bool merged = false;
+  };
+
+  // Updates which source last changed each LTP channel, using the sources that
+  // have a new packet, oldest packet first. `order` holds the indexes of
+  // those sources.
+  void updateOwners(const int *order, int n);
+
+  Sender &sender_;
+  Source sources_[kMaxSources];
+  int count_;
+
+  // LTP channels have their bit set
+  uint32_t ltpMask_[Receiver::kChangeWords];
+
+  // The source that last changed each channel, or -1 if none
+  int8_t owners_[kMaxDMXPacketSize];
+};
+
+}  // namespace teensydmx
+}  // namespace qindesign
+
+#endif  // TEENSYDMX_MERGER_H_
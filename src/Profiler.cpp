@@ -0,0 +1,64 @@
+// This file is part of the TeensyDMX library.
+// (c) 2022 Shawn Silverman
+
+#include "Profiler.h"
+
+#ifdef TEENSYDMX_ENABLE_PROFILING
+
+#include <util/atomic.h>
+
+namespace qindesign {
+namespace teensydmx {
+
+// Measurements, indexed by ProfilePoints.
+static ProfileStats stats[static_cast<int>(ProfilePoints::kCount)];
+
+// Enables the cycle counter at startup. The Teensy 4 already does this, but
+// the Teensy 3 doesn't.
+static class CycleCounterInit final {
+ public:
+  CycleCounterInit() {
+    ARM_DEMCR |= ARM_DEMCR_TRCENA;
+    ARM_DWT_CTRL |= ARM_DWT_CTRL_CYCCNTENA;
+  }
+} cycleCounterInit;
+
+ProfileStats profileStats(ProfilePoints point) {
+  ProfileStats s;
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+    s = stats[static_cast<int>(point)];
+  }
+  return s;
+}
+
+void resetProfileStats() {
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+    for (ProfileStats &s : stats) {
+      s = ProfileStats{};
+    }
+  }
+}
+
+namespace util {
+
+void profileRecord(ProfilePoints point, uint32_t cycles) {
+  // Different ISRs may have different priorities, so don't let them interrupt
+  // each other here
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+    ProfileStats &s = stats[static_cast<int>(point)];
+    if (s.count == 0 || cycles < s.minCycles) {
+      s.minCycles = cycles;
+    }
+    if (s.count == 0 || cycles > s.maxCycles) {
+      s.maxCycles = cycles;
+    }
+    s.totalCycles += cycles;
+    s.count++;
+  }
+}
+
+}  // namespace util
+}  // namespace teensydmx
+}  // namespace qindesign
+
+#endif  // TEENSYDMX_ENABLE_PROFILING
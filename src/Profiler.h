@@ -0,0 +1,124 @@
+// This file is part of the TeensyDMX library.
+// (c) 2022 Shawn Silverman
+
+// Profiler.h defines optional instrumentation that measures, in CPU cycles, how
+// long the library's interrupt routines and interrupt locks take. It uses the
+// DWT cycle counter and is only compiled in when the global
+// `TEENSYDMX_ENABLE_PROFILING` macro is defined when building. Otherwise, the
+// `TEENSYDMX_PROFILE` macro expands to nothing and there's no cost.
+
+#ifndef TEENSYDMX_PROFILER_H_
+#define TEENSYDMX_PROFILER_H_
+
+#ifdef TEENSYDMX_ENABLE_PROFILING
+
+#if defined(KINETISL)
+#error "Profiling needs the DWT cycle counter, which the Teensy LC doesn't have"
+#endif  // KINETISL
+
+// C++ includes
+#include <cstdint>
+
+#include <core_pins.h>
+
+namespace qindesign {
+namespace teensydmx {
+
+// The things that are profiled.
+enum class ProfilePoints {
+  kReceiveIRQ,             // Receive handler irqHandler()
+  kSendIRQ,                // Send handler irqHandler()
+  kBreakTimer,             // Sender and SenderGroup BREAK/MAB timer callbacks
+  kRateTimer,              // Sender and SenderGroup rate timer callbacks
+  kInterSlotTimer,         // Sender inter-slot timer callback
+  kIdleTimer,              // Receiver idle timer callback
+  kReceiveCompletePacket,  // Receiver::completePacket()
+  kSendCompletePacket,     // Sender::completePacket()
+  kReceiverLock,           // Time spent with Receiver's UART IRQs disabled
+  kSenderLock,             // Time spent with Sender's UART IRQs disabled
+  kCount,                  // The number of points
+};
+
+// Measurements for one profiled point, in CPU cycles. To convert to time,
+// divide by `F_CPU_ACTUAL` on the Teensy 4 or `F_CPU` otherwise. The min. and
+// max. are only valid if the count is non-zero.
+class ProfileStats final {
+ public:
+  // Initializes everything to zero.
+  constexpr ProfileStats()
+      : count(0),
+        minCycles(0),
+        maxCycles(0),
+        totalCycles(0) {}
+
+  ~ProfileStats() = default;
+
+  // Support common use of this object
+  ProfileStats(const ProfileStats &) = default;
+  ProfileStats(ProfileStats &&) = default;
+  ProfileStats &operator=(const ProfileStats &) = default;
+  ProfileStats &operator=(ProfileStats &&) = default;
+
+  // Returns the mean number of cycles, or zero if there are no measurements.
+  uint32_t meanCycles() const {
+    return (count == 0) ? 0 : totalCycles / count;
+  }
+
+  uint32_t count;        // Number of measurements
+  uint32_t minCycles;
+  uint32_t maxCycles;
+  uint64_t totalCycles;  // Sum of all the measurements
+};
+
+// Returns the measurements for the given point, across all receivers
+// and senders.
+ProfileStats profileStats(ProfilePoints point);
+
+// Clears all the measurements.
+void resetProfileStats();
+
+namespace util {
+
+// Adds one measurement for the given point. This may be called from an ISR.
+void profileRecord(ProfilePoints point, uint32_t cycles);
+
+// Measures the time between its construction and destruction. Nothing is
+// recorded if `enabled` is `false`.
+class ProfileScope final {
+ public:
+  explicit ProfileScope(ProfilePoints point, bool enabled = true)
+      : point_(point),
+        enabled_(enabled),
+        start_(ARM_DWT_CYCCNT) {}
+
+  ~ProfileScope() {
+    if (enabled_) {
+      profileRecord(point_, ARM_DWT_CYCCNT - start_);
+    }
+  }
+
+  ProfileScope(const ProfileScope &) = delete;
+  ProfileScope &operator=(const ProfileScope &) = delete;
+
+ private:
+  const ProfilePoints point_;
+  const bool enabled_;
+  const uint32_t start_;
+};
+
+}  // namespace util
+}  // namespace teensydmx
+}  // namespace qindesign
+
+// Measures the rest of the enclosing scope as the given `ProfilePoints` value.
+#define TEENSYDMX_PROFILE(point)                          \
+  ::qindesign::teensydmx::util::ProfileScope profileScope{ \
+      ::qindesign::teensydmx::ProfilePoints::point}
+
+#else
+
+#define TEENSYDMX_PROFILE(point)
+
+#endif  // TEENSYDMX_ENABLE_PROFILING
+
+#endif  // TEENSYDMX_PROFILER_H_
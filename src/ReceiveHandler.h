@@ -16,8 +16,22 @@ class Receiver;
 // Defines this interface.
 class ReceiveHandler {
  public:
+  // The concrete handler types. The ISRs check this before calling a port's
+  // handler directly, without dynamic dispatch.
+  enum class Kind {
+    kUART,
+    kLPUART,
+    kFlexIO,
+    kOther,  // Not driven by the port's interrupt, for example a simulator's
+  };
+
   virtual ~ReceiveHandler() = default;
 
+  // Returns this handler's type.
+  Kind kind() const {
+    return kind_;
+  }
+
   // Starts the UART. This calls `begin` with the slots baud rate and format,
   // and then activates the interrupts, sets the Idle Line Type Select to "Idle
   // starts after start bit", and attaches the interrupt routines.
@@ -34,6 +48,12 @@ class ReceiveHandler {
   // starts after start bit" and `true` for "Idle starts after stop bit".
   virtual void setILT(bool flag) const = 0;
 
+  // Sets the RX FIFO watermark. If `flag` is `true` then the watermark is
+  // raised to near the FIFO depth so that several slots are received per
+  // interrupt. Otherwise, the watermark is restored to what it was when the
+  // UART was started. This does nothing if the RX FIFO is too small.
+  virtual void setRXWatermarkHigh(bool flag) const = 0;
+
   // Enables or disables the UART IRQ(s).
   virtual void setIRQState(bool flag) const = 0;
 
@@ -43,17 +63,37 @@ class ReceiveHandler {
   // Handles interrupts.
   virtual void irqHandler() const = 0;
 
-  // Sends synchronous data.
-  virtual void txData(const uint8_t *b, int len) const = 0;
+  // Accounts for any slots that were received without an interrupt, for
+  // example with DMA, when the receiver's idle timer expires. This returns
+  // whether there were any, in which case the handler has also taken care of
+  // the packet end and the idle timer. The default does nothing and
+  // returns `false`.
+  virtual bool flushBulk() const {
+    return false;
+  }
+
+  // Starts a response BREAK by inverting the TX line.
+  virtual void txStartBreak() const = 0;
+
+  // Starts a response MAB by un-inverting the TX line.
+  virtual void txStartMAB() const = 0;
+
+  // Starts sending the receiver's response data using the TX interrupts. The
+  // receiver's `responseComplete()` is called from the ISR after the last byte
+  // has been sent.
+  virtual void txStartData() const = 0;
 
-  // Sends a synchronous BREAK and MAB.
-  virtual void txBreak(uint32_t breakTime, uint32_t mabTime) const = 0;
+  // Stops sending any response. This disables the TX interrupts and
+  // un-inverts the TX line.
+  virtual void txStop() const = 0;
 
  protected:
-  ReceiveHandler(int serialIndex, Receiver *receiver)
-      : serialIndex_(serialIndex),
+  ReceiveHandler(int serialIndex, Receiver *receiver, Kind kind = Kind::kOther)
+      : kind_(kind),
+        serialIndex_(serialIndex),
         receiver_(receiver) {}
 
+  const Kind kind_;
   const int serialIndex_;
   Receiver *receiver_;
 };
@@ -6,11 +6,14 @@
 // C++ includes
 #include <algorithm>
 #include <atomic>
+#include <cerrno>
+#include <cstring>
 #include <utility>
 
 #include <core_pins.h>
 #include <util/atomic.h>
 
+#include "Repeater.h"
 #include "Responder.h"
 
 namespace qindesign {
@@ -89,11 +92,20 @@ void lpuart5_rx_isr();
 
 // Used by the RX ISRs.
 #if defined(__IMXRT1052__) || defined(ARDUINO_TEENSY41)
-static Receiver *volatile rxInstances[8]{nullptr};
+constexpr int kSerialInstanceCount = 8;
 #else
-static Receiver *volatile rxInstances[7]{nullptr};
+constexpr int kSerialInstanceCount = 7;
 #endif  // __IMXRT1052__ || ARDUINO_TEENSY41
 
+#if defined(__IMXRT1062__)
+// FlexIO receivers are indexed after the serial ports
+constexpr int kFlexIOIndexStart = kSerialInstanceCount;
+constexpr int kFlexIOIndexEnd = kFlexIOIndexStart + flexio::kChannelCount;
+static Receiver *volatile rxInstances[kFlexIOIndexEnd]{nullptr};
+#else
+static Receiver *volatile rxInstances[kSerialInstanceCount]{nullptr};
+#endif  // __IMXRT1062__
+
 // Forward declarations of RX watch pin ISRs
 void rxPinFellSerial0_isr();
 void rxPinRoseSerial0_isr();
@@ -161,30 +173,93 @@ static void (*rxPinRoseISRs[7])() {
 #endif  // __IMXRT1052__ || ARDUINO_TEENSY41
 
 Receiver::Receiver(HardwareSerial &uart)
-    : TeensyDMX(uart),
+    : Receiver(&uart, serialIndex(uart), nullptr) {}
+
+Receiver::Receiver(HardwareSerial &uart, Storage &storage)
+    : Receiver(&uart, serialIndex(uart), &storage) {}
+
+#if defined(__IMXRT1062__)
+// Returns the instance index for the given FlexIO pin, or -1 if the pin isn't
+// supported.
+static int flexIOIndex(const FlexIOPin &pin) {
+  int channel = flexio::channelForPin(pin.pin);
+  if (channel < 0) {
+    return -1;
+  }
+  return kFlexIOIndexStart + channel;
+}
+
+Receiver::Receiver(const FlexIOPin &pin)
+    : Receiver(nullptr, flexIOIndex(pin), nullptr) {}
+
+Receiver::Receiver(const FlexIOPin &pin, Storage &storage)
+    : Receiver(nullptr, flexIOIndex(pin), &storage) {}
+#endif  // __IMXRT1062__
+
+Receiver::Receiver(HardwareSerial *uart, int index, Storage *storage)
+    : TeensyDMX(uart, index),
       txEnabled_(true),
       began_(false),
       state_{RecvStates::kIdle},
       keepShortPackets_(false),
-      buf1_{0},
-      buf2_{0},
-      activeBuf_(buf1_),
-      inactiveBuf_(buf2_),
+      dmaEnabled_(false),
+      changeTracking_(false),
+      coalescingMode_{CoalescingModes::kLatency},
+      buf1_(nullptr),
+      buf2_(nullptr),
+      buf3_(nullptr),
+      activeBuf_(nullptr),
+      inactiveBuf_(nullptr),
       activeBufIndex_(0),
       packetSize_(0),
+      bufGenerations_{0},
+      frameGeneration_(0),
+      pinnedBuf_(nullptr),
+      frameUser_(nullptr),
+      changes_{0},
       lastBreakStartTime_(0),
       breakStartTime_(0),
       lastSlotEndTime_(0),
       connected_(false),
+      packetTimeout_(kDefaultPacketTimeout),
+      idleTimeout_(kDefaultIdleTimeout),
       connectChangeFunc_{nullptr},
+      packetFunc_{nullptr},
+      historySize_(0),
+      historyHead_(0),
+      historyTail_(0),
+      responderStartCodes_{0},
+      responders_{nullptr},
       responderCount_(0),
+      frameResponder_(nullptr),
+      responderOutBuf_(nullptr),
       responderOutBufLen_(0),
+      responderOutBufStorage_(nullptr),
+      responderOutBufStorageSize_(0),
+      repeater_(nullptr),
+      responseState_{ResponseStates::kIdle},
+      responseBreak_(false),
+      responsePreDataDelay_(0),
+      responseBreakTime_(0),
+      responseMABTime_(0),
+      responseLen_(0),
+      responseIndex_(0),
       setTXNotRXFunc_(nullptr),
       rxWatchPin_(-1),
       seenMABStart_(false),
       seenMABEnd_(false),
       mabStartTime_(0),
       mabEndTime_(0) {
+  if (storage == nullptr) {
+    storage = reinterpret_cast<Storage *>(alignStorage(storageBlock_));
+  }
+  std::fill_n(&storage->bufs[0][0], sizeof(storage->bufs), 0);
+  buf1_ = storage->bufs[0];
+  buf2_ = storage->bufs[1];
+  buf3_ = storage->bufs[2];
+  activeBuf_ = buf1_;
+  inactiveBuf_ = buf2_;
+
   switch(serialIndex_) {
 #if defined(HAS_KINETISK_UART0)
     case 0:
@@ -200,7 +275,8 @@ Receiver::Receiver(HardwareSerial &uart)
 #elif defined(IMXRT_LPUART6)
     case 0:
       receiveHandler_ = std::make_unique<LPUARTReceiveHandler>(
-          serialIndex_, this, &IMXRT_LPUART6, IRQ_LPUART6, &lpuart6_rx_isr);
+          serialIndex_, this, &IMXRT_LPUART6, IRQ_LPUART6, &lpuart6_rx_isr,
+          DMAMUX_SOURCE_LPUART6_RX);
       break;
 #endif  // HAS_KINETISK_UART0 || HAS_KINETISL_UART0 || IMXRT_LPUART6
 
@@ -218,7 +294,8 @@ Receiver::Receiver(HardwareSerial &uart)
 #elif defined(IMXRT_LPUART4)
     case 1:
       receiveHandler_ = std::make_unique<LPUARTReceiveHandler>(
-          serialIndex_, this, &IMXRT_LPUART4, IRQ_LPUART4, &lpuart4_rx_isr);
+          serialIndex_, this, &IMXRT_LPUART4, IRQ_LPUART4, &lpuart4_rx_isr,
+          DMAMUX_SOURCE_LPUART4_RX);
       break;
 #endif  // HAS_KINETISK_UART1 || HAS_KINETISL_UART1 || IMXRT_LPUART4
 
@@ -236,7 +313,8 @@ Receiver::Receiver(HardwareSerial &uart)
 #elif defined(IMXRT_LPUART2)
     case 2:
       receiveHandler_ = std::make_unique<LPUARTReceiveHandler>(
-          serialIndex_, this, &IMXRT_LPUART2, IRQ_LPUART2, &lpuart2_rx_isr);
+          serialIndex_, this, &IMXRT_LPUART2, IRQ_LPUART2, &lpuart2_rx_isr,
+          DMAMUX_SOURCE_LPUART2_RX);
       break;
 #endif  // HAS_KINETISK_UART2 || HAS_KINETISL_UART2 || IMXRT_LPUART2
 
@@ -249,7 +327,8 @@ Receiver::Receiver(HardwareSerial &uart)
 #elif defined(IMXRT_LPUART3)
     case 3:
       receiveHandler_ = std::make_unique<LPUARTReceiveHandler>(
-          serialIndex_, this, &IMXRT_LPUART3, IRQ_LPUART3, &lpuart3_rx_isr);
+          serialIndex_, this, &IMXRT_LPUART3, IRQ_LPUART3, &lpuart3_rx_isr,
+          DMAMUX_SOURCE_LPUART3_RX);
       break;
 #endif  // HAS_KINETISK_UART3 || IMXRT_LPUART3
 
@@ -262,7 +341,8 @@ Receiver::Receiver(HardwareSerial &uart)
 #elif defined(IMXRT_LPUART8)
     case 4:
       receiveHandler_ = std::make_unique<LPUARTReceiveHandler>(
-          serialIndex_, this, &IMXRT_LPUART8, IRQ_LPUART8, &lpuart8_rx_isr);
+          serialIndex_, this, &IMXRT_LPUART8, IRQ_LPUART8, &lpuart8_rx_isr,
+          DMAMUX_SOURCE_LPUART8_RX);
       break;
 #endif  // HAS_KINETISK_UART4 || IMXRT_LPUART8
 
@@ -280,14 +360,16 @@ Receiver::Receiver(HardwareSerial &uart)
 #elif defined(IMXRT_LPUART1)
     case 5:
       receiveHandler_ = std::make_unique<LPUARTReceiveHandler>(
-          serialIndex_, this, &IMXRT_LPUART1, IRQ_LPUART1, &lpuart1_rx_isr);
+          serialIndex_, this, &IMXRT_LPUART1, IRQ_LPUART1, &lpuart1_rx_isr,
+          DMAMUX_SOURCE_LPUART1_RX);
       break;
 #endif  // HAS_KINETISK_UART5 || HAS_KINETISK_LPUART0 || IMXRT_LPUART1
 
 #if defined(IMXRT_LPUART7)
     case 6:
       receiveHandler_ = std::make_unique<LPUARTReceiveHandler>(
-          serialIndex_, this, &IMXRT_LPUART7, IRQ_LPUART7, &lpuart7_rx_isr);
+          serialIndex_, this, &IMXRT_LPUART7, IRQ_LPUART7, &lpuart7_rx_isr,
+          DMAMUX_SOURCE_LPUART7_RX);
       break;
 #endif  // IMXRT_LPUART7
 
@@ -295,11 +377,18 @@ Receiver::Receiver(HardwareSerial &uart)
     (defined(__IMXRT1052__) || defined(ARDUINO_TEENSY41))
     case 7:
       receiveHandler_ = std::make_unique<LPUARTReceiveHandler>(
-          serialIndex_, this, &IMXRT_LPUART5, IRQ_LPUART5, &lpuart5_rx_isr);
+          serialIndex_, this, &IMXRT_LPUART5, IRQ_LPUART5, &lpuart5_rx_isr,
+          DMAMUX_SOURCE_LPUART5_RX);
       break;
 #endif  // IMXRT_LPUART5 && (__IMXRT1052__ || ARDUINO_TEENSY41)
 
     default:
+#if defined(__IMXRT1062__)
+      if (kFlexIOIndexStart <= serialIndex_ && serialIndex_ < kFlexIOIndexEnd) {
+        receiveHandler_ = std::make_unique<FlexIOReceiveHandler>(
+            serialIndex_, this, serialIndex_ - kFlexIOIndexStart);
+      }
+#endif  // __IMXRT1062__
       break;
   }
 }
@@ -318,9 +407,71 @@ void Receiver::setTXEnabled(bool flag) {
     return;
   }
 
+  if (!flag) {
+    abortResponse();
+  }
   receiveHandler_->setTXEnabled(flag);
 }
 
+void Receiver::setDMAEnabled(bool flag) {
+  if (dmaEnabled_ == flag) {
+    return;
+  }
+  dmaEnabled_ = flag;
+
+  // The DMA channel is allocated or released when starting
+  if (began_) {
+    end();
+    begin();
+  }
+}
+
+void Receiver::setCoalescingMode(CoalescingModes mode) {
+  Lock lock{*this};
+  //{
+    coalescingMode_ = mode;
+    if (began_ && mode == CoalescingModes::kLatency) {
+      receiveHandler_->setRXWatermarkHigh(false);
+    }
+  //}
+}
+
+void Receiver::setChangeTrackingEnabled(bool flag) {
+  Lock lock{*this};
+  //{
+    if (frameUser_ != nullptr) {
+      return;
+    }
+    if (flag && !changeTracking_) {
+      std::fill_n(&changes_[0], kChangeWords, uint32_t{0});
+    }
+    changeTracking_ = flag;
+  //}
+}
+
+bool Receiver::readChanges(uint32_t *bits) {
+  return readChangesFor(nullptr, bits);
+}
+
+bool Receiver::readChangesFor(const void *user, uint32_t *bits) {
+  if (frameUser_ != user) {
+    std::fill_n(&bits[0], kChangeWords, uint32_t{0});
+    return false;
+  }
+
+  uint32_t any = 0;
+  Lock lock{*this};
+  //{
+    std::atomic_signal_fence(std::memory_order_acquire);
+    for (int i = 0; i < kChangeWords; i++) {
+      bits[i] = changes_[i];
+      any |= changes_[i];
+      changes_[i] = 0;
+    }
+  //}
+  return any != 0;
+}
+
 void Receiver::begin() {
   if (began_) {
     return;
@@ -337,6 +488,10 @@ void Receiver::begin() {
   lastBreakStartTime_ = 0;
   packetStats_ = PacketStats{};
   errorStats_ = ErrorStats{};
+  if (timingStats_ != nullptr) {
+    timingStats_->reset();
+  }
+  historyTail_ = historyHead_;
 
   // Set up the instance for the ISRs
   Receiver *r = rxInstances[serialIndex_];
@@ -347,11 +502,13 @@ void Receiver::begin() {
 
   state_ = RecvStates::kIdle;
   activeBufIndex_ = 0;
+  responseState_ = ResponseStates::kIdle;
   setConnected(false);
 
   receiveHandler_->start();
   intervalTimer_.setPriority(receiveHandler_->priority());
-  // Also set the interval timer priority to match the UART priority
+  responseTimer_.setPriority(receiveHandler_->priority());
+  // Also set the timer priorities to match the UART priority
 
   // Enable receive
   setTXNotRX(false);
@@ -370,8 +527,17 @@ void Receiver::end() {
   // Remove any chance that our RX ISRs start after end() is called,
   // so disable the IRQs first
 
+  abortResponse();
   receiveHandler_->end();
 
+  // A repeater can't wait for the rest of the packet
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+    Repeater *repeater = repeater_;
+    if (repeater != nullptr) {
+      repeater->receiveEnd(activeBuf_, activeBufIndex_);
+    }
+  }
+
   // Remove the reference from the instances,
   // but only if we're the ones who added it
   if (rxInstances[serialIndex_] == this) {
@@ -461,6 +627,76 @@ uint16_t Receiver::get16Bit(int channel, bool *rangeError) const {
   return v;
 }
 
+bool Receiver::claimFrames(const void *user) {
+  Lock lock{*this};
+  //{
+    if (frameUser_ != nullptr) {
+      return frameUser_ == user;
+    }
+    if (pinnedBuf_ != nullptr || changeTracking_) {
+      return false;
+    }
+    frameUser_ = user;
+    std::fill_n(&changes_[0], kChangeWords, uint32_t{0});
+    changeTracking_ = true;
+  //}
+  return true;
+}
+
+void Receiver::unclaimFrames(const void *user) {
+  if (user == nullptr || frameUser_ != user) {
+    return;
+  }
+  releaseFrameFor(user);
+
+  Lock lock{*this};
+  //{
+    changeTracking_ = false;
+    frameUser_ = nullptr;
+  //}
+}
+
+bool Receiver::acquireFrame(FrameView &view) {
+  return acquireFrameFor(nullptr, view);
+}
+
+bool Receiver::acquireFrameFor(const void *user, FrameView &view) {
+  if (frameUser_ != user) {
+    return false;
+  }
+
+  // Pin the latest buffer, making sure it didn't change before the pin was
+  // placed, otherwise the ISR may have chosen it as the active buffer
+  const uint8_t *buf;
+  do {
+    buf = inactiveBuf_;
+    pinnedBuf_ = buf;
+    std::atomic_signal_fence(std::memory_order_seq_cst);
+  } while (buf != inactiveBuf_);
+  std::atomic_signal_fence(std::memory_order_acquire);
+
+  // The ISR won't touch the pinned buffer's data or stats
+  int index = bufIndex(buf);
+  uint32_t lastGeneration = view.generation;
+  view.data = buf;
+  view.stats = bufStats_[index];
+  view.size = view.stats.size;
+  view.generation = bufGenerations_[index];
+  return view.generation != lastGeneration;
+}
+
+void Receiver::releaseFrame() {
+  releaseFrameFor(nullptr);
+}
+
+void Receiver::releaseFrameFor(const void *user) {
+  if (frameUser_ != user) {
+    return;
+  }
+  std::atomic_signal_fence(std::memory_order_release);
+  pinnedBuf_ = nullptr;
+}
+
 Receiver::PacketStats Receiver::packetStats() const {
   Lock lock{*this};
   std::atomic_signal_fence(std::memory_order_acquire);
@@ -479,69 +715,289 @@ Receiver::ErrorStats Receiver::errorStats() const {
   return errorStats_;
 }
 
-Responder *Receiver::setResponder(uint8_t startCode, Responder *r) {
-  // For a null responder, delete any current one for this start code
-  if (r == nullptr) {
-    Lock lock{*this};
+void Receiver::Histogram::add(uint32_t t) {
+  int bin = 0;
+  if (t >= binStart && binWidth > 0) {
+    bin = std::min((t - binStart) / binWidth, uint32_t{kBinCount - 1});
+  }
+  bins[bin]++;
+  if (count == 0 || t < min) {
+    min = t;
+  }
+  if (count == 0 || t > max) {
+    max = t;
+  }
+  count++;
+}
 
-    if (responders_ == nullptr) {
-      return nullptr;
+void Receiver::Histogram::reset() {
+  std::fill_n(&bins[0], kBinCount, uint32_t{0});
+  count = 0;
+  min = 0;
+  max = 0;
+}
+
+void Receiver::TimingStats::reset() {
+  breakTime.reset();
+  mabTime.reset();
+  breakToBreakTime.reset();
+  packetTime.reset();
+}
+
+bool Receiver::setTimingStatsEnabled(bool flag) {
+  if (flag == (timingStats_ != nullptr)) {
+    return true;
+  }
+
+  Lock lock{*this};
+  //{
+    if (!flag) {
+      timingStats_ = nullptr;
+      return true;
     }
+    timingStats_.reset(new TimingStats{});
+    // Allocation may have failed on small systems
+    return timingStats_ != nullptr;
+  //}
+}
+
+Receiver::TimingStats Receiver::timingStats() const {
+  Lock lock{*this};
+  std::atomic_signal_fence(std::memory_order_acquire);
+  if (timingStats_ == nullptr) {
+    return TimingStats{};
+  }
+  return *timingStats_;
+}
 
-    // Replace any previous responder
-    Responder *old = responders_[startCode];
-    if (old != nullptr) {
-      responderCount_--;
+void Receiver::resetTimingStats() {
+  Lock lock{*this};
+  //{
+    if (timingStats_ != nullptr) {
+      timingStats_->reset();
     }
+  //}
+}
 
-    // When no more responders, delete all the buffers
-    if (responderCount_ == 0) {
-      responderOutBuf_ = nullptr;
-      responders_ = nullptr;
+bool Receiver::setPacketHistorySize(int size) {
+  // Round up to a power of two
+  int n = 0;
+  if (size > 0) {
+    n = 1;
+    while (n < size && n < kMaxPacketHistorySize) {
+      n <<= 1;
     }
+  }
+  if (n == historySize_) {
+    return true;
+  }
 
-    return old;
+  Lock lock{*this};
+  //{
+    historySize_ = 0;
+    history_ = nullptr;
+    historyTail_ = historyHead_;
+    if (n == 0) {
+      return true;
+    }
+    history_.reset(new PacketStats[n]);
+    // Allocation may have failed on small systems
+    if (history_ == nullptr) {
+      return false;
+    }
+    historySize_ = n;
+  //}
+  return true;
+}
+
+int Receiver::readPacketHistory(PacketStats *stats, int len) {
+  uint32_t size = historySize_;
+  if (len <= 0 || size == 0) {
+    return 0;
+  }
+
+  uint32_t head = historyHead_;
+  std::atomic_signal_fence(std::memory_order_acquire);
+  uint32_t tail = historyTail_;
+  if (head - tail > size) {
+    // Some entries were overwritten before they could be read
+    tail = head - size;
+  }
+  uint32_t n = std::min(head - tail, static_cast<uint32_t>(len));
+  for (uint32_t i = 0; i < n; i++) {
+    stats[i] = history_[(tail + i) & (size - 1)];
+  }
+  historyTail_ = tail + n;
+
+  // Skip any entries that were overwritten while they were being copied; the
+  // ISR can interrupt us but not the other way around
+  std::atomic_signal_fence(std::memory_order_acquire);
+  uint32_t lost = historyHead_ - tail;
+  if (lost <= size) {
+    return n;
+  }
+  lost -= size;
+  if (lost >= n) {
+    return 0;
+  }
+  std::copy(&stats[lost], &stats[n], &stats[0]);
+  return n - lost;
+}
+
+void Receiver::recordStats(const PacketStats &stats) {
+  TimingStats *ts = timingStats_.get();
+  if (ts != nullptr) {
+    // The BREAK and MAB times are only measured with an RX watch pin
+    if (stats.breakTime > 0) {
+      ts->breakTime.add(stats.breakTime);
+      ts->mabTime.add(stats.mabTime);
+    }
+    if (stats.breakToBreakTime > 0) {
+      ts->breakToBreakTime.add(stats.breakToBreakTime);
+    }
+    ts->packetTime.add(stats.packetTime);
   }
 
+  int size = historySize_;
+  if (size > 0) {
+    uint32_t head = historyHead_;
+    history_[head & (size - 1)] = stats;
+    std::atomic_signal_fence(std::memory_order_release);
+    historyHead_ = head + 1;
+  }
+}
+
+Responder *Receiver::setResponder(uint8_t startCode, Responder *r) {
   Lock lock{*this};
 
-  // Allocate this first because it's done once. The output buffer may get
-  // reallocated, and so letting that be the last thing deleted avoids
-  // potential fragmentation.
-  if (responders_ == nullptr) {
-    responders_.reset(new Responder *[256]);
-    // Allocation may have failed on small systems
-    if (responders_ == nullptr) {
+  // Find the start code's place in the sorted table
+  int index = 0;
+  while (index < responderCount_ && responderStartCodes_[index] < startCode) {
+    index++;
+  }
+  bool found = (index < responderCount_ &&
+                responderStartCodes_[index] == startCode);
+  Responder *old = found ? responders_[index] : nullptr;
+
+  // For a null responder, delete any current one for this start code
+  if (r == nullptr) {
+    if (!found) {
       return nullptr;
     }
+    std::copy(&responderStartCodes_[index + 1],
+              &responderStartCodes_[responderCount_],
+              &responderStartCodes_[index]);
+    std::copy(&responders_[index + 1], &responders_[responderCount_],
+              &responders_[index]);
+    responderCount_--;
+
+    // When no more responders, delete the output buffer
+    if (responderCount_ == 0) {
+      abortResponse();
+      releaseResponderOutBuf();
+    }
+
+    updateFrameResponder();
+    return old;
+  }
+
+  if (!found && responderCount_ >= kMaxResponders) {
+    errno = ENOMEM;
+    return nullptr;
   }
 
   // Initialize the output buffer
   int outBufSize = r->outputBufferSize();
   if (responderOutBuf_ == nullptr || responderOutBufLen_ < outBufSize) {
-    responderOutBuf_.reset(new uint8_t[outBufSize]);
-    // Allocation may have failed on small systems
+    abortResponse();  // Any response is being sent from the old buffer
+    if (responderOutBufStorage_ != nullptr) {
+      if (responderOutBufStorageSize_ >= outBufSize) {
+        responderOutBuf_ = responderOutBufStorage_;
+        responderOutBufLen_ = responderOutBufStorageSize_;
+      } else {
+        responderOutBuf_ = nullptr;
+      }
+    } else {
+      responderOutBufBlock_.reset(new uint8_t[outBufSize]);
+      responderOutBuf_ = responderOutBufBlock_.get();
+      responderOutBufLen_ = outBufSize;
+    }
+    // Allocation may have failed on small systems, or the supplied buffer
+    // may be too small
     if (responderOutBuf_ == nullptr) {
-      responderOutBufLen_ = 0;
-      responders_ = nullptr;
+      releaseResponderOutBuf();
       responderCount_ = 0;
+      updateFrameResponder();
       return nullptr;
     }
-    responderOutBufLen_ = outBufSize;
   }
 
   // If a responder is already set then the output buffer should be the
   // correct size
-  Responder *old = responders_[startCode];
-  responders_[startCode] = r;
-  if (old == nullptr) {
+  if (!found) {
+    std::copy_backward(&responderStartCodes_[index],
+                       &responderStartCodes_[responderCount_],
+                       &responderStartCodes_[responderCount_ + 1]);
+    std::copy_backward(&responders_[index], &responders_[responderCount_],
+                       &responders_[responderCount_ + 1]);
+    responderStartCodes_[index] = startCode;
     responderCount_++;
   }
+  responders_[index] = r;
 
+  updateFrameResponder();
   return old;
 }
 
+void Receiver::releaseResponderOutBuf() {
+  responderOutBuf_ = nullptr;
+  responderOutBufLen_ = 0;
+  responderOutBufBlock_ = nullptr;
+}
+
+Responder *Receiver::findResponder(uint8_t startCode) const {
+  for (int i = 0; i < responderCount_; i++) {
+    if (responderStartCodes_[i] >= startCode) {
+      return (responderStartCodes_[i] == startCode) ? responders_[i] : nullptr;
+    }
+  }
+  return nullptr;
+}
+
+void Receiver::updateFrameResponder() {
+  // A packet is in progress until it's completed, even during the next BREAK
+  if (activeBufIndex_ > 0) {
+    frameResponder_ = findResponder(activeBuf_[0]);
+  } else {
+    frameResponder_ = nullptr;
+  }
+}
+
+bool Receiver::setResponderOutputBuffer(uint8_t *buf, int size) {
+  if (size < 0) {
+    return false;
+  }
+
+  Lock lock{*this};
+  //{
+    if (responderCount_ > 0) {
+      return false;
+    }
+    responderOutBufStorage_ = buf;
+    responderOutBufStorageSize_ = (buf == nullptr) ? 0 : size;
+  //}
+  return true;
+}
+
 void Receiver::completePacket(RecvStates newState) {
+  TEENSYDMX_PROFILE(kReceiveCompletePacket);
+
+  // Let any repeater finish the packet before the buffers change
+  Repeater *repeater = repeater_;
+  if (repeater != nullptr) {
+    repeater->receiveEnd(activeBuf_, activeBufIndex_);
+  }
+
   uint32_t t = millis();
   state_ = newState;  // Should only be kIdle or kDataIdle
 
@@ -571,13 +1027,18 @@ void Receiver::completePacket(RecvStates newState) {
     packetStats_.isShort = false;
   }
 
-  // Swap the buffers
-  if (activeBuf_ == buf1_) {
+  // Make the active buffer the latest packet and choose a new active buffer
+  // that's neither the latest packet nor the one pinned by a frame view
+  const uint8_t *pinned = pinnedBuf_;
+  const uint8_t *prev = inactiveBuf_;
+  uint8_t *completed = activeBuf_;
+  inactiveBuf_ = completed;
+  if (buf1_ != completed && buf1_ != pinned) {
+    activeBuf_ = buf1_;
+  } else if (buf2_ != completed && buf2_ != pinned) {
     activeBuf_ = buf2_;
-    inactiveBuf_ = buf1_;
   } else {
-    activeBuf_ = buf1_;
-    inactiveBuf_ = buf2_;
+    activeBuf_ = buf3_;
   }
 
   incPacketCount();
@@ -593,22 +1054,81 @@ void Receiver::completePacket(RecvStates newState) {
   packetStats_.mabTime = packetStats_.nextMABTime;
 
   // Let the responder, if any, process the packet
-  if (responders_ != nullptr) {
-    Responder *r = responders_[inactiveBuf_[0]];
-    if (r != nullptr) {
-      r->receivePacket(inactiveBuf_, packetSize_);
-      if (r->eatPacket()) {
-        packetStats_.extraSize = packetStats_.size = packetSize_ = 0;
-      }
+  Responder *r = frameResponder_;
+  if (r != nullptr) {
+    r->receivePacket(inactiveBuf_, packetSize_);
+    if (r->eatPacket()) {
+      packetStats_.extraSize = packetStats_.size = packetSize_ = 0;
     }
   }
+
+  // The previous packet is still intact because it wasn't chosen as the new
+  // active buffer
+  if (changeTracking_ && packetSize_ > 0) {
+    addChanges(completed, packetSize_, prev, bufStats_[bufIndex(prev)].size);
+  }
+
+  // Frame view state for the completed buffer
+  int index = bufIndex(completed);
+  bufStats_[index] = packetStats_;
+  bufGenerations_[index] = ++frameGeneration_;
+  recordStats(packetStats_);
   std::atomic_signal_fence(std::memory_order_release);
 
   activeBufIndex_ = 0;
+
+  // Notify any listener
+  if (packetSize_ > 0) {
+    void (*f)(Receiver *r, const uint8_t *buf, const PacketStats &stats) =
+        packetFunc_;
+    if (f != nullptr) {
+      f(this, completed, bufStats_[index]);
+    }
+  }
+}
+
+void Receiver::addChanges(const uint8_t *buf, int size,
+                          const uint8_t *prevBuf, int prevSize) {
+  int common = std::min(size, prevSize);
+  int i = 0;
+
+  // Compare a word at a time, and only look at the bytes of words that differ
+  for (; i + 4 <= common; i += 4) {
+    uint32_t a;
+    uint32_t b;
+    std::memcpy(&a, &buf[i], 4);
+    std::memcpy(&b, &prevBuf[i], 4);
+    if (a == b) {
+      continue;
+    }
+    for (int j = i; j < i + 4; j++) {
+      if (buf[j] != prevBuf[j]) {
+        changes_[j >> 5] |= uint32_t{1} << (j & 0x1f);
+      }
+    }
+  }
+  for (; i < common; i++) {
+    if (buf[i] != prevBuf[i]) {
+      changes_[i >> 5] |= uint32_t{1} << (i & 0x1f);
+    }
+  }
+
+  // Channels in only one of the packets
+  int end = std::max(size, prevSize);
+  for (; i < end; i++) {
+    changes_[i >> 5] |= uint32_t{1} << (i & 0x1f);
+  }
 }
 
 void Receiver::idleTimerCallback() {
+  TEENSYDMX_PROFILE(kIdleTimer);
+
   intervalTimer_.end();
+
+  // The line wasn't idle if the handler still had slots to account for
+  if (receiveHandler_->flushBulk()) {
+    return;
+  }
   completePacket(RecvStates::kIdle);
   setConnected(false);
 }
@@ -643,8 +1163,8 @@ void Receiver::receiveIdle(uint32_t eventTime) {
       break;
 
     case RecvStates::kData:
-      if ((eventTime - breakStartTime_) > kMaxDMXPacketTime ||
-          (eventTime - lastSlotEndTime_) >= kMaxDMXIdleTime) {
+      if ((eventTime - breakStartTime_) > packetTimeout_ ||
+          (eventTime - lastSlotEndTime_) >= idleTimeout_) {
         // We'll consider this as a packet end and not as a timeout
         // errorStats_.packetTimeoutCount++;
         completePacket(RecvStates::kIdle);
@@ -662,8 +1182,9 @@ void Receiver::receiveIdle(uint32_t eventTime) {
   }
 
   // Start a timer watching for disconnection/packet end
-  intervalTimer_.begin([this]() { idleTimerCallback(); },
-                       kMaxDMXIdleTime - kCharTime);
+  intervalTimer_.begin(
+      util::Delegate::fromMethod<Receiver, &Receiver::idleTimerCallback>(this),
+      idleTimeout_ - kCharTime);
 }
 
 void Receiver::receivePotentialBreak(uint32_t eventTime) {
@@ -678,6 +1199,11 @@ void Receiver::receivePotentialBreak(uint32_t eventTime) {
 
   state_ = RecvStates::kBreak;
 
+  // Look for the start code as soon as it arrives
+  if (coalescingMode_ == CoalescingModes::kThroughput) {
+    receiveHandler_->setRXWatermarkHigh(false);
+  }
+
   // At this point, we don't know whether to keep or discard any collected
   // data because the BREAK may be invalid. In other words, don't make any
   // framing error or short packet decisions until we know the nature of
@@ -743,7 +1269,7 @@ void Receiver::receiveByte(uint8_t b, uint32_t eopTime) {
           mabTime = eopTime - kCharTime - mabStartTime_;
         }
         breakTime = mabStartTime_ - breakStartTime_;
-        if (mabTime >= kMaxDMXIdleTime) {
+        if (mabTime >= idleTimeout_) {
           completePacket(RecvStates::kIdle);
           setConnected(false);
           return;
@@ -775,7 +1301,7 @@ void Receiver::receiveByte(uint8_t b, uint32_t eopTime) {
           errorStats_.shortPacketCount++;
           // Discard the data
           activeBufIndex_ = 0;
-        } else if (dt > kMaxDMXPacketTime) {
+        } else if (dt > packetTimeout_) {
           // NOTE: Zero-length packets will also trigger a timeout
           errorStats_.packetTimeoutCount++;
           // Keep the data
@@ -799,6 +1325,22 @@ void Receiver::receiveByte(uint8_t b, uint32_t eopTime) {
       lastBreakStartTime_ = breakStartTime_;
       setConnected(true);
       state_ = RecvStates::kData;
+
+      // Look up the responder once for the whole packet
+      frameResponder_ = findResponder(b);
+
+      // The BREAK is valid, so a repeater can start its output now
+      Repeater *repeater = repeater_;
+      if (repeater != nullptr) {
+        repeater->receiveStart();
+      }
+
+      // Coalesce the rest of the slots, unless a responder or repeater needs
+      // to see them as soon as possible
+      if (coalescingMode_ == CoalescingModes::kThroughput &&
+          repeater == nullptr && frameResponder_ == nullptr) {
+        receiveHandler_->setRXWatermarkHigh(true);
+      }
       break;
     }
 
@@ -822,7 +1364,7 @@ void Receiver::receiveByte(uint8_t b, uint32_t eopTime) {
       //    somewhere, and this seems like a good point, and
       // 2. A responder hasn't eaten the packet. If a responder doesn't eat
       //    the packet then the packet size won't have been set to zero.
-      if (eopTime - breakStartTime_ <= kMaxDMXPacketTime &&
+      if (eopTime - breakStartTime_ <= packetTimeout_ &&
           packetStats_.size > 0) {
         // If a responder cut the packet off early, then the processed
         // packet size may be < 513, so use the sum and not just the
@@ -849,7 +1391,7 @@ void Receiver::receiveByte(uint8_t b, uint32_t eopTime) {
   // Check the timing and if we are out of range then complete any bytes
   // until, but not including, this one
   lastSlotEndTime_ = eopTime;
-  if ((eopTime - breakStartTime_) > kMaxDMXPacketTime) {
+  if ((eopTime - breakStartTime_) > packetTimeout_) {
     errorStats_.packetTimeoutCount++;
     std::atomic_signal_fence(std::memory_order_release);
     completePacket(RecvStates::kIdle);
@@ -866,11 +1408,13 @@ void Receiver::receiveByte(uint8_t b, uint32_t eopTime) {
   if (activeBufIndex_ == kMaxDMXPacketSize) {
     packetFull = true;
   }
+  repeatSlots();
 
-  // See if a responder needs to process the byte and respond
+  // See if a responder needs to process the byte and respond. This is skipped
+  // while a response is being sent because its output buffer is in use.
   Responder *r = nullptr;
-  if (responders_ != nullptr) {
-    r = responders_[activeBuf_[0]];
+  if (responseState_ == ResponseStates::kIdle) {
+    r = frameResponder_;
   }
   if (r == nullptr) {
     if (packetFull) {
@@ -881,7 +1425,7 @@ void Receiver::receiveByte(uint8_t b, uint32_t eopTime) {
 
   // Let the responder process the data
   int respLen =
-      r->processByte(activeBuf_, activeBufIndex_, responderOutBuf_.get());
+      r->processByte(activeBuf_, activeBufIndex_, responderOutBuf_);
   if (respLen <= 0) {
     if (packetFull) {
       // If the responder isn't done by now, it's too late for this packet
@@ -892,39 +1436,245 @@ void Receiver::receiveByte(uint8_t b, uint32_t eopTime) {
   }
   completePacket(RecvStates::kDataIdle);  // This is probably the best option,
                                           // even though there may be more bytes
-  if (!txEnabled_) {
+  if (!txEnabled_ || !began_) {
     return;
   }
 
   // Do the response
-  if (r->isSendBreakForLastPacket()) {
-    uint32_t delay = r->preBreakDelay();
-    uint32_t dt = micros() - eopTime;
-    if (dt < delay) {
-      delayMicroseconds(delay - dt);
+  startResponse(*r, respLen, eopTime);
+}
+
+void Receiver::startResponse(const Responder &r, int len, uint32_t eopTime) {
+  responseBreak_ = r.isSendBreakForLastPacket();
+  responsePreDataDelay_ = r.preDataDelay();
+  responseBreakTime_ = r.breakTime();
+  responseMABTime_ = r.mabTime();
+  responseLen_ = len;
+  responseIndex_ = 0;
+  responseState_ = ResponseStates::kTurnaround;
+
+  // The turnaround delay is relative to the end of the last received byte
+  uint32_t delay = responseBreak_ ? r.preBreakDelay() : r.preNoBreakDelay();
+  uint32_t dt = micros() - eopTime;
+  if (!waitForResponse((dt < delay) ? delay - dt : 0)) {
+    continueResponse();
+  }
+}
+
+void Receiver::continueResponse() {
+  while (true) {
+    uint32_t delay;
+    switch (responseState_) {
+      case ResponseStates::kTurnaround:
+        setTXNotRX(true);
+        responseState_ = ResponseStates::kPreData;
+        delay = responsePreDataDelay_;
+        break;
+
+      case ResponseStates::kPreData:
+        if (!responseBreak_) {
+          // Go straight to the data
+          responseState_ = ResponseStates::kMAB;
+          continue;
+        }
+        if (responseBreakTime_ > 0) {
+          receiveHandler_->txStartBreak();
+        }
+        responseState_ = ResponseStates::kBreak;
+        delay = responseBreakTime_;
+        break;
+
+      case ResponseStates::kBreak:
+        receiveHandler_->txStartMAB();
+        responseState_ = ResponseStates::kMAB;
+        delay = responseMABTime_;
+        break;
+
+      case ResponseStates::kMAB:
+        responseTimer_.end();
+        responseState_ = ResponseStates::kData;
+        receiveHandler_->txStartData();
+        return;
+
+      default:
+        // Shouldn't happen
+        responseTimer_.end();
+        return;
     }
 
-    setTXNotRX(true);
-    delay = r->preDataDelay();
-    if (delay > 0) {
-      delayMicroseconds(delay);
+    if (waitForResponse(delay)) {
+      return;
     }
-    receiveHandler_->txBreak(r->breakTime(), r->mabTime());
-  } else {
-    uint32_t delay = r->preNoBreakDelay();
-    uint32_t dt = micros() - eopTime;
-    if (dt < delay) {
-      delayMicroseconds(delay - dt);
+  }
+}
+
+bool Receiver::waitForResponse(uint32_t delay) {
+  if (delay == 0) {
+    return false;
+  }
+  if (responseTimer_.begin(
+          util::Delegate::fromMethod<Receiver, &Receiver::continueResponse>(
+              this),
+          delay)) {
+    return true;
+  }
+
+  // Starting the timer failed, so revert to the original way
+  delayMicroseconds(delay);
+  return false;
+}
+
+void Receiver::responseComplete() {
+  responseState_ = ResponseStates::kIdle;
+  setTXNotRX(false);
+}
+
+void Receiver::abortResponse() {
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+    responseTimer_.end();
+    if (responseState_ != ResponseStates::kIdle) {
+      receiveHandler_->txStop();
+      responseState_ = ResponseStates::kIdle;
+      setTXNotRX(false);
     }
+  }
+}
+
+void Receiver::receiveBytes(const uint8_t *b, int count, uint32_t eopTime) {
+  if (count <= 0) {
+    return;
+  }
 
-    setTXNotRX(true);
-    delay = r->preDataDelay();
-    if (delay > 0) {
-      delayMicroseconds(delay);
+  // Track the end time of each byte
+  uint32_t t = eopTime - kCharTime*(count - 1);
+  int i = 0;
+  while (i < count) {
+    int n = receiveBatch(&b[i], count - i, t);
+    if (n <= 0) {
+      receiveByte(b[i], t);
+      n = 1;
     }
+    i += n;
+    t += kCharTime*n;
+  }
+}
+
+int Receiver::receiveBatch(const uint8_t *b, int count, uint32_t eopTime) {
+  if (count < 2 || state_ != RecvStates::kData) {
+    return 0;
+  }
+  int start = activeBufIndex_;
+  if (start <= 0 || kMaxDMXPacketSize <= start) {
+    return 0;
+  }
+
+  // Leave anything unusual to single-byte processing. If the first byte isn't
+  // too early then none of the others are, because the character time is
+  // longer than the minimum.
+  count = std::min(count, kMaxDMXPacketSize - start);
+  uint32_t lastTime = eopTime + kCharTime*(count - 1);
+  if ((eopTime - breakStartTime_ <
+       kMinBreakTime + kMinMABTime + kCharTimeLow*(start + 1)) ||
+      (lastTime - breakStartTime_ > packetTimeout_)) {
+    return 0;
+  }
+
+  intervalTimer_.end();
+  std::copy_n(&b[0], count, &activeBuf_[start]);
+  activeBufIndex_ = start + count;
+  lastSlotEndTime_ = lastTime;
+  std::atomic_signal_fence(std::memory_order_release);
+  repeatSlots();
+
+  // See if a responder needs to process the bytes, with the same conditions
+  // as in `receiveByte`
+  Responder *r = nullptr;
+  if (responseState_ == ResponseStates::kIdle) {
+    r = frameResponder_;
+  }
+  if (r == nullptr) {
+    if (activeBufIndex_ == kMaxDMXPacketSize) {
+      completePacket(RecvStates::kDataIdle);
+    }
+    return count;
+  }
+
+  // Let the responder process the data
+  int len = activeBufIndex_;
+  int respLen = r->processBytes(activeBuf_, start, count,
+                                responderOutBuf_, &len);
+  if (respLen <= 0) {
+    if (activeBufIndex_ == kMaxDMXPacketSize) {
+      completePacket(RecvStates::kDataIdle);
+    }
+    return count;
+  }
+
+  // Anything after the response became ready is received as extra bytes
+  len = std::min(std::max(len, start + 1), activeBufIndex_);
+  int used = len - start;
+  activeBufIndex_ = len;
+  lastSlotEndTime_ = eopTime + kCharTime*(used - 1);
+  completePacket(RecvStates::kDataIdle);
+  if (txEnabled_ && began_) {
+    startResponse(*r, respLen, lastSlotEndTime_);
+  }
+  return used;
+}
+
+bool Receiver::isBulkReceiveAllowed() const {
+  if (state_ != RecvStates::kData ||
+      activeBufIndex_ <= 0 || kMaxDMXPacketSize <= activeBufIndex_) {
+    return false;
+  }
+  return frameResponder_ == nullptr;
+}
+
+void Receiver::receiveBulk(int count, uint32_t eopTime) {
+  if (count <= 0 || state_ != RecvStates::kData) {
+    return;
+  }
+  intervalTimer_.end();
+
+  // Same checks as for a single slot, but using the last slot in the block
+  uint32_t charTime = kCharTimeLow*(activeBufIndex_ + count);
+  if (eopTime - breakStartTime_ < kMinBreakTime + kMinMABTime + charTime) {
+    // Too early, discard any data
+    receiveBadBreak();
+    return;
+  }
+
+  lastSlotEndTime_ = eopTime;
+  uint32_t packetTime = eopTime - breakStartTime_;
+  uint32_t timeout = packetTimeout_;
+  if (packetTime > timeout) {
+    // Keep only the slots that ended in time
+    int late = (packetTime - timeout + kCharTime - 1) / kCharTime;
+    if (late < count) {
+      activeBufIndex_ += count - late;
+    }
+    errorStats_.packetTimeoutCount++;
+    std::atomic_signal_fence(std::memory_order_release);
+    completePacket(RecvStates::kIdle);
+    setConnected(false);
+    return;
+  }
+
+  activeBufIndex_ += count;
+  std::atomic_signal_fence(std::memory_order_release);
+  if (activeBufIndex_ >= kMaxDMXPacketSize) {
+    activeBufIndex_ = kMaxDMXPacketSize;
+    completePacket(RecvStates::kDataIdle);
+  } else {
+    repeatSlots();
+  }
+}
+
+void Receiver::repeatSlots() {
+  Repeater *repeater = repeater_;
+  if (repeater != nullptr) {
+    repeater->receiveSlots(activeBuf_, activeBufIndex_);
   }
-  receiveHandler_->txData(responderOutBuf_.get(), respLen);
-  setTXNotRX(false);
 }
 
 void Receiver::setConnected(bool flag) {
@@ -948,13 +1698,23 @@ void Receiver::setIRQState(bool flag) const {
   receiveHandler_->setIRQState(flag);
 }
 
+void Receiver::setPacketTimeout(uint32_t timeout) {
+  packetTimeout_ = std::max(timeout, uint32_t{kMinDMXPacketTime});
+}
+
+void Receiver::setIdleTimeout(uint32_t timeout) {
+  // The idle timer runs for one character time less than this
+  idleTimeout_ = std::max(timeout, 2*kCharTime);
+}
+
 // ---------------------------------------------------------------------------
 //  RX pin interrupt and ISRs
 // ---------------------------------------------------------------------------
 
 void Receiver::setRXWatchPin(int pin) {
   ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
-    if (pin < 0) {
+    // There are only watch pin ISRs for the serial ports
+    if (pin < 0 || serialIndex_ >= kSerialInstanceCount) {
       if (rxWatchPin_ >= 0) {
         detachInterrupt(rxWatchPin_);
       }
@@ -1106,6 +1866,19 @@ void rxPinRoseSerial7_isr() {
 }
 #endif  // __IMXRT1052__ || ARDUINO_TEENSY41
 
+// The ISRs below call the port's handler directly, without the virtual
+// dispatch, after checking that it's the final class the port uses. A
+// `ReceiverSimulator` replaces the handler with one that the port doesn't
+// drive, so then the interrupt is ignored. The Kinetis UART ISRs also pass
+// their `UARTPort`, so that the handler's registers and FIFO depths are
+// compile-time constants.
+template <typename Handler, typename... Port>
+static inline void callIRQHandler(const ReceiveHandler *h, Port... port) {
+  if (h->kind() == Handler::kKind) {
+    static_cast<const Handler *>(h)->irqHandler(port...);
+  }
+}
+
 // ---------------------------------------------------------------------------
 //  UART0 RX ISR
 // ---------------------------------------------------------------------------
@@ -1115,7 +1888,8 @@ void rxPinRoseSerial7_isr() {
 void uart0_rx_isr() {
   Receiver *r = rxInstances[0];
   if (r != nullptr) {
-    r->receiveHandler_->irqHandler();
+    callIRQHandler<UARTReceiveHandler>(r->receiveHandler_.get(),
+                                       UARTPort<0>{});
   }
 }
 
@@ -1130,7 +1904,8 @@ void uart0_rx_isr() {
 void uart1_rx_isr() {
   Receiver *r = rxInstances[1];
   if (r != nullptr) {
-    r->receiveHandler_->irqHandler();
+    callIRQHandler<UARTReceiveHandler>(r->receiveHandler_.get(),
+                                       UARTPort<1>{});
   }
 }
 
@@ -1145,7 +1920,8 @@ void uart1_rx_isr() {
 void uart2_rx_isr() {
   Receiver *r = rxInstances[2];
   if (r != nullptr) {
-    r->receiveHandler_->irqHandler();
+    callIRQHandler<UARTReceiveHandler>(r->receiveHandler_.get(),
+                                       UARTPort<2>{});
   }
 }
 
@@ -1160,7 +1936,8 @@ void uart2_rx_isr() {
 void uart3_rx_isr() {
   Receiver *r = rxInstances[3];
   if (r != nullptr) {
-    r->receiveHandler_->irqHandler();
+    callIRQHandler<UARTReceiveHandler>(r->receiveHandler_.get(),
+                                       UARTPort<3>{});
   }
 }
 
@@ -1175,7 +1952,8 @@ void uart3_rx_isr() {
 void uart4_rx_isr() {
   Receiver *r = rxInstances[4];
   if (r != nullptr) {
-    r->receiveHandler_->irqHandler();
+    callIRQHandler<UARTReceiveHandler>(r->receiveHandler_.get(),
+                                       UARTPort<4>{});
   }
 }
 
@@ -1190,7 +1968,8 @@ void uart4_rx_isr() {
 void uart5_rx_isr() {
   Receiver *r = rxInstances[5];
   if (r != nullptr) {
-    r->receiveHandler_->irqHandler();
+    callIRQHandler<UARTReceiveHandler>(r->receiveHandler_.get(),
+                                       UARTPort<5>{});
   }
 }
 
@@ -1205,7 +1984,7 @@ void uart5_rx_isr() {
 void lpuart0_rx_isr() {
   Receiver *r = rxInstances[5];
   if (r != nullptr) {
-    r->receiveHandler_->irqHandler();
+    callIRQHandler<LPUARTReceiveHandler>(r->receiveHandler_.get());
   }
 }
 
@@ -1220,7 +1999,7 @@ void lpuart0_rx_isr() {
 void lpuart6_rx_isr() {
   Receiver *r = rxInstances[0];
   if (r != nullptr) {
-    r->receiveHandler_->irqHandler();
+    callIRQHandler<LPUARTReceiveHandler>(r->receiveHandler_.get());
   }
 }
 
@@ -1235,7 +2014,7 @@ void lpuart6_rx_isr() {
 void lpuart4_rx_isr() {
   Receiver *r = rxInstances[1];
   if (r != nullptr) {
-    r->receiveHandler_->irqHandler();
+    callIRQHandler<LPUARTReceiveHandler>(r->receiveHandler_.get());
   }
 }
 
@@ -1250,7 +2029,7 @@ void lpuart4_rx_isr() {
 void lpuart2_rx_isr() {
   Receiver *r = rxInstances[2];
   if (r != nullptr) {
-    r->receiveHandler_->irqHandler();
+    callIRQHandler<LPUARTReceiveHandler>(r->receiveHandler_.get());
   }
 }
 
@@ -1265,7 +2044,7 @@ void lpuart2_rx_isr() {
 void lpuart3_rx_isr() {
   Receiver *r = rxInstances[3];
   if (r != nullptr) {
-    r->receiveHandler_->irqHandler();
+    callIRQHandler<LPUARTReceiveHandler>(r->receiveHandler_.get());
   }
 }
 
@@ -1280,7 +2059,7 @@ void lpuart3_rx_isr() {
 void lpuart8_rx_isr() {
   Receiver *r = rxInstances[4];
   if (r != nullptr) {
-    r->receiveHandler_->irqHandler();
+    callIRQHandler<LPUARTReceiveHandler>(r->receiveHandler_.get());
   }
 }
 
@@ -1295,7 +2074,7 @@ void lpuart8_rx_isr() {
 void lpuart1_rx_isr() {
   Receiver *r = rxInstances[5];
   if (r != nullptr) {
-    r->receiveHandler_->irqHandler();
+    callIRQHandler<LPUARTReceiveHandler>(r->receiveHandler_.get());
   }
 }
 
@@ -1310,7 +2089,7 @@ void lpuart1_rx_isr() {
 void lpuart7_rx_isr() {
   Receiver *r = rxInstances[6];
   if (r != nullptr) {
-    r->receiveHandler_->irqHandler();
+    callIRQHandler<LPUARTReceiveHandler>(r->receiveHandler_.get());
   }
 }
 
@@ -1326,11 +2105,30 @@ void lpuart7_rx_isr() {
 void lpuart5_rx_isr() {
   Receiver *r = rxInstances[7];
   if (r != nullptr) {
-    r->receiveHandler_->irqHandler();
+    callIRQHandler<LPUARTReceiveHandler>(r->receiveHandler_.get());
   }
 }
 
 #endif  // IMXRT_LPUART5 && (__IMXRT1052__ || ARDUINO_TEENSY41)
 
+// ---------------------------------------------------------------------------
+//  FlexIO2 RX ISR (FlexIO receivers on Teensy 4)
+// ---------------------------------------------------------------------------
+
+#if defined(__IMXRT1062__)
+
+// All the FlexIO senders and receivers share this interrupt, and each handler
+// only looks at its own flags. See FlexIO.cpp.
+void flexio2_rx_isr() {
+  for (int i = kFlexIOIndexStart; i < kFlexIOIndexEnd; i++) {
+    Receiver *r = rxInstances[i];
+    if (r != nullptr) {
+      callIRQHandler<FlexIOReceiveHandler>(r->receiveHandler_.get());
+    }
+  }
+}
+
+#endif  // __IMXRT1062__
+
 }  // namespace teensydmx
 }  // namespace qindesign
@@ -0,0 +1,94 @@
+// This file is part of the TeensyDMX library.
+// (c) 2022 Shawn Silverman
+
+#include "ReceiverSimulator.h"
+
+// C++ includes
+#include <algorithm>
+#include <memory>
+
+#include <core_pins.h>
+#include <util/atomic.h>
+
+namespace qindesign {
+namespace teensydmx {
+
+extern const uint32_t kCharTime;  // In microseconds
+
+ReceiverSimulator::ReceiverSimulator(HardwareSerial &uart)
+    : rx_(uart),
+      handler_(nullptr),
+      time_(0) {
+  auto h = std::make_unique<SimulatedReceiveHandler>(rx_.serialIndex_, &rx_);
+  handler_ = h.get();
+  rx_.receiveHandler_ = std::move(h);
+}
+
+ReceiverSimulator::~ReceiverSimulator() {
+  end();
+}
+
+void ReceiverSimulator::begin() {
+  rx_.begin();
+  handler_->resetResponseCounts();
+  time_ = micros();
+}
+
+void ReceiverSimulator::end() {
+  rx_.end();
+}
+
+void ReceiverSimulator::addBreak(uint32_t breakTime, uint32_t mabTime) {
+  uint32_t start = time_;
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+    rx_.receivePotentialBreak(start + kCharTime);
+
+    // IDLE detection is set to "after start bit" after a packet completes, so
+    // a long MAB is seen as an IDLE one character time after the line rises
+    if (mabTime >= kCharTime) {
+      rx_.receiveIdle(start + breakTime + kCharTime);
+    }
+  }
+  time_ = start + breakTime + mabTime;
+}
+
+void ReceiverSimulator::addSlots(const uint8_t *buf, int len,
+                                 uint32_t interSlotTime) {
+  if (interSlotTime == 0) {
+    for (int i = 0; i < len; i += kBatchSize) {
+      int count = std::min(len - i, kBatchSize);
+      time_ += kCharTime*count;
+      ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        rx_.receiveBytes(&buf[i], count, time_);
+      }
+    }
+    return;
+  }
+
+  for (int i = 0; i < len; i++) {
+    time_ += kCharTime;
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+      rx_.receiveBytes(&buf[i], 1, time_);
+      if (interSlotTime >= kCharTime) {
+        rx_.receiveIdle(time_ + kCharTime);
+      }
+    }
+    time_ += interSlotTime;
+  }
+}
+
+void ReceiverSimulator::addIdle() {
+  time_ += kCharTime;
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+    rx_.receiveIdle(time_);
+  }
+}
+
+void ReceiverSimulator::addPacket(const uint8_t *buf, int len) {
+  addBreak();
+  addSlots(buf, len);
+  addIdle();
+}
+
+}  // namespace teensydmx
+}  // namespace qindesign
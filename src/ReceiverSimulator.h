@@ -0,0 +1,121 @@
+// This file is part of the TeensyDMX library.
+// (c) 2022 Shawn Silverman
+
+// ReceiverSimulator.h defines a way to feed synthetic line events to
+// a receiver.
+
+#ifndef TEENSYDMX_RECEIVERSIMULATOR_H_
+#define TEENSYDMX_RECEIVERSIMULATOR_H_
+
+// C++ includes
+#include <cstdint>
+
+#include <HardwareSerial.h>
+
+#include "SimulatedReceiveHandler.h"
+#include "TeensyDMX.h"
+
+namespace qindesign {
+namespace teensydmx {
+
+// Drives a receiver's framing state machine without any UART traffic. The
+// receiver's handler is replaced with one that doesn't touch the hardware, and
+// the BREAKs, MABs, slots, and IDLEs are described by calling functions here.
+// Each one calls into the receiver the same way the UART interrupts would,
+// with interrupts disabled, and with timestamps from a simulated clock.
+//
+// The simulated clock starts at `micros()` when `begin()` is called and only
+// moves forward when line events are added or when `advance()` is called. It
+// usually runs much faster than real time, so real timers, such as the idle
+// timeout and the responder delays, are not simulated. A response is counted
+// and completed as soon as its data would start.
+//
+// This is useful for measuring the cost of the framing logic, for example, in
+// bytes per second or microseconds per packet, and for checking its behaviour
+// with specific timings. The receiver is placed in the instance slot for the
+// UART, so that UART shouldn't also be used by another receiver.
+class ReceiverSimulator final {
+ public:
+  // The default BREAK time, in microseconds.
+  static constexpr uint32_t kDefaultBreakTime = 176;
+
+  // The default MAB time, in microseconds.
+  static constexpr uint32_t kDefaultMABTime = 12;
+
+  // The number of slots delivered at a time when there's no inter-slot MARK
+  // time. This is the size of the larger UART FIFOs.
+  static constexpr int kBatchSize = 8;
+
+  // Creates a simulator for a new receiver on the given UART.
+  explicit ReceiverSimulator(HardwareSerial &uart);
+
+  // Destructs the simulator. This calls `end()`.
+  ~ReceiverSimulator();
+
+  // The receiver refers to this object, so it can't be copied or moved
+  ReceiverSimulator(const ReceiverSimulator &) = delete;
+  ReceiverSimulator &operator=(const ReceiverSimulator &) = delete;
+
+  // Returns the simulated receiver. Its API can be used as usual, except for
+  // `begin()` and `end()`, which should be called here instead.
+  Receiver &receiver() {
+    return rx_;
+  }
+
+  // Starts the receiver and resets the simulated clock.
+  void begin();
+
+  // Stops the receiver.
+  void end();
+
+  // Returns the current simulated time, in microseconds.
+  uint32_t time() const {
+    return time_;
+  }
+
+  // Moves the simulated clock forward by the given number of microseconds
+  // without any line activity.
+  void advance(uint32_t us) {
+    time_ += us;
+  }
+
+  // Adds a BREAK and MAB having the given times, in microseconds. The BREAK
+  // is detected as a framing error after one character time. A BREAK
+  // shorter than that is seen as a bad BREAK.
+  void addBreak(uint32_t breakTime = kDefaultBreakTime,
+                uint32_t mabTime = kDefaultMABTime);
+
+  // Adds slots, each followed by the given inter-slot MARK time, in
+  // microseconds. The slots are delivered `kBatchSize` at a time if the
+  // MARK time is zero, and one at a time otherwise.
+  void addSlots(const uint8_t *buf, int len, uint32_t interSlotTime = 0);
+
+  // Adds an IDLE condition, one character time long, after the last event.
+  void addIdle();
+
+  // Adds a complete packet: a BREAK and MAB having the default times, the
+  // slots, and an IDLE.
+  void addPacket(const uint8_t *buf, int len);
+
+  // Returns the number of responses that were sent.
+  uint32_t responseCount() const {
+    return handler_->responseCount();
+  }
+
+  // Returns the total number of response bytes that were sent.
+  uint32_t responseBytes() const {
+    return handler_->responseBytes();
+  }
+
+ private:
+  Receiver rx_;
+  SimulatedReceiveHandler *handler_;  // Owned by the receiver
+
+  // The simulated clock, in microseconds
+  uint32_t time_;
+};
+
+}  // namespace teensydmx
+}  // namespace qindesign
+
+#endif  // TEENSYDMX_RECEIVERSIMULATOR_H_
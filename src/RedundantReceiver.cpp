@@ -0,0 +1,113 @@
+// This file is part of the TeensyDMX library.
+// (c) 2022 Shawn Silverman
+
+#include "RedundantReceiver.h"
+
+// C++ includes
+#include <algorithm>
+
+#include <core_pins.h>
+
+namespace qindesign {
+namespace teensydmx {
+
+RedundantReceiver::RedundantReceiver(Receiver &primary, Receiver &backup)
+    : primary_(primary),
+      backup_(backup),
+      missedBreaks_(kDefaultMissedBreaks),
+      revertTime_(kDefaultRevertTime),
+      switchFunc_(nullptr),
+      live_(kNone),
+      alive_{false},
+      primaryReturning_(false),
+      primaryAliveTime_(0),
+      switchCount_(0) {}
+
+void RedundantReceiver::setMissedBreaks(int count) {
+  missedBreaks_ = std::max(count, 1);
+}
+
+bool RedundantReceiver::checkAlive(Receiver &r, uint32_t now) const {
+  uint32_t breakTime;
+  uint32_t period;
+  {
+    Receiver::Lock lock{r};
+    if (!r.connected_ || r.lastBreakStartTime_ == 0) {
+      return false;
+    }
+    breakTime = r.lastBreakStartTime_;
+    period = r.packetStats_.breakToBreakTime;
+  }
+
+  // Until a BREAK-to-BREAK time has been measured, rely on the receiver's
+  // own timeouts
+  if (period == 0) {
+    return true;
+  }
+
+  // The next BREAK was expected one period after the last one. Allow half a
+  // period of jitter on top of the missed BREAKs.
+  return now - breakTime <= period*static_cast<uint32_t>(missedBreaks_) +
+                                period/2;
+}
+
+int RedundantReceiver::update() {
+  uint32_t now = micros();
+  alive_[kPrimary] = checkAlive(primary_, now);
+  alive_[kBackup] = checkAlive(backup_, now);
+
+  int live;
+  if (!alive_[kPrimary]) {
+    primaryReturning_ = false;
+    if (alive_[kBackup]) {
+      live = kBackup;
+    } else {
+      live = kNone;
+    }
+  } else if (live_ != kBackup || !alive_[kBackup]) {
+    primaryReturning_ = false;
+    live = kPrimary;
+  } else {
+    // The primary is back, but wait for it to prove itself before switching
+    if (!primaryReturning_) {
+      primaryReturning_ = true;
+      primaryAliveTime_ = millis();
+    }
+    if (millis() - primaryAliveTime_ >= revertTime_) {
+      primaryReturning_ = false;
+      live = kPrimary;
+    } else {
+      live = kBackup;
+    }
+  }
+
+  if (live != live_) {
+    live_ = live;
+    switchCount_++;
+    if (switchFunc_ != nullptr) {
+      switchFunc_(this, live);
+    }
+  }
+  return live;
+}
+
+Receiver *RedundantReceiver::live() const {
+  switch (live_) {
+    case kPrimary:
+      return &primary_;
+    case kBackup:
+      return &backup_;
+    default:
+      return nullptr;
+  }
+}
+
+bool RedundantReceiver::isAlive(int input) const {
+  if (input != kPrimary && input != kBackup) {
+    return false;
+  }
+  return alive_[input];
+}
+
+}  // namespace teensydmx
+}  // namespace qindesign
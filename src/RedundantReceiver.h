@@ -0,0 +1,127 @@
+// This file is part of the TeensyDMX library.
+// (c) 2022 Shawn Silverman
+
+// RedundantReceiver.h defines a way to fail over between a primary and a
+// backup receiver.
+
+#ifndef TEENSYDMX_REDUNDANTRECEIVER_H_
+#define TEENSYDMX_REDUNDANTRECEIVER_H_
+
+// C++ includes
+#include <cstdint>
+
+#include "TeensyDMX.h"
+
+namespace qindesign {
+namespace teensydmx {
+
+// Watches a primary and a backup receiver, the inputs, and chooses which one is
+// live. An input is alive while its receiver is connected and its BREAKs keep
+// arriving at the rate it's been sending them. The expected time between
+// BREAKs is the latest BREAK-to-BREAK time measured by the receiver, so the
+// switch to the backup happens soon after the primary misses its next BREAK,
+// without waiting for the receiver's own timeouts.
+//
+// Once the primary is alive again, it's used again after it has stayed alive
+// for the revert time.
+//
+// Nothing is copied. The program reads the live receiver, for example with
+// `acquireFrame` or `readPacket`. The receivers are started and configured
+// separately.
+class RedundantReceiver final {
+ public:
+  // The default number of BREAKs an input can miss before it's no longer
+  // alive. See `setMissedBreaks`.
+  static constexpr int kDefaultMissedBreaks = 1;
+
+  // The default revert time, in milliseconds. See `setRevertTime`.
+  static constexpr uint32_t kDefaultRevertTime = 1000;
+
+  // Input numbers. `kNone` means neither input is alive.
+  static constexpr int kPrimary = 0;
+  static constexpr int kBackup  = 1;
+  static constexpr int kNone    = -1;
+
+  // Creates a new redundant receiver using the given inputs.
+  RedundantReceiver(Receiver &primary, Receiver &backup);
+
+  ~RedundantReceiver() = default;
+
+  // The state refers to the receivers, so it can't be copied or moved
+  RedundantReceiver(const RedundantReceiver &) = delete;
+  RedundantReceiver &operator=(const RedundantReceiver &) = delete;
+
+  // Sets how many expected BREAKs an input can miss before it's no longer
+  // alive. Values less than 1 are raised to 1. The default is
+  // `kDefaultMissedBreaks`.
+  void setMissedBreaks(int count);
+
+  // Returns the number of BREAKs an input can miss.
+  int missedBreaks() const {
+    return missedBreaks_;
+  }
+
+  // Sets how long, in milliseconds, the primary must stay alive before it's
+  // used again after a failover. Zero switches back immediately. The default is
+  // `kDefaultRevertTime`.
+  void setRevertTime(uint32_t ms) {
+    revertTime_ = ms;
+  }
+
+  // Returns the revert time, in milliseconds.
+  uint32_t revertTime() const {
+    return revertTime_;
+  }
+
+  // Sets the function to call from `update()` when the live input changes. The
+  // function takes this object and the new live input. It may be NULL.
+  void onSwitch(void (*f)(RedundantReceiver *r, int input)) {
+    switchFunc_ = f;
+  }
+
+  // Checks the inputs and chooses the live one, and then returns it. The
+  // backup becomes live when the primary isn't alive, and the live input
+  // becomes `kNone` when neither is. Call this often from the main loop;
+  // how quickly a failure is noticed depends on it.
+  int update();
+
+  // Returns the live input chosen by the last `update()`.
+  int liveInput() const {
+    return live_;
+  }
+
+  // Returns the receiver for the live input, or NULL if there's none.
+  Receiver *live() const;
+
+  // Returns whether an input was alive at the last `update()`. This returns
+  // `false` for anything other than `kPrimary` or `kBackup`.
+  bool isAlive(int input) const;
+
+  // Returns the number of times the live input changed.
+  uint32_t switchCount() const {
+    return switchCount_;
+  }
+
+ private:
+  // Returns whether the given receiver is alive at time `now`, in
+  // microseconds.
+  bool checkAlive(Receiver &r, uint32_t now) const;
+
+  Receiver &primary_;
+  Receiver &backup_;
+
+  int missedBreaks_;
+  uint32_t revertTime_;
+  void (*switchFunc_)(RedundantReceiver *r, int input);
+
+  int live_;
+  bool alive_[2];
+  bool primaryReturning_;      // Whether switching back to the primary waits
+  uint32_t primaryAliveTime_;  // When the primary came back, in milliseconds
+  uint32_t switchCount_;
+};
+
+}  // namespace teensydmx
+}  // namespace qindesign
+
+#endif  // TEENSYDMX_REDUNDANTRECEIVER_H_
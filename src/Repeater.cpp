@@ -0,0 +1,232 @@
+// This file is part of the TeensyDMX library.
+// (c) 2022 Shawn Silverman
+
+#include "Repeater.h"
+
+// C++ includes
+#include <algorithm>
+
+#include <util/atomic.h>
+
+namespace qindesign {
+namespace teensydmx {
+
+Repeater::Repeater(Receiver &receiver, Sender &sender)
+    : receiver_(receiver),
+      sender_(sender),
+      began_(false),
+      bufs_{{0}},
+      ready_{0},
+      ended_{false},
+      rxBuf_(0),
+      txBuf_(-1),
+      pending_(false),
+      receiving_(false),
+      patched_(false),
+      starved_(false) {
+  resetPatch();
+}
+
+Repeater::~Repeater() {
+  end();
+}
+
+bool Repeater::begin() {
+  if (began_ || sender_.group_ != nullptr || sender_.repeater_ != nullptr ||
+      sender_.playbackRing_ != nullptr || receiver_.repeater_ != nullptr) {
+    return false;
+  }
+
+  rxBuf_ = 0;
+  txBuf_ = -1;
+  pending_ = false;
+  receiving_ = false;
+  starved_ = false;
+  updateNeeds();
+
+  // Restart the sender paused, so that it only sends when a packet arrives
+  sender_.end();
+  sender_.savedInactiveBuf_ = sender_.inactiveBuf_;
+  sender_.paused_ = true;
+  sender_.resumeCounter_ = 0;
+  sender_.repeater_ = this;
+  sender_.begin();
+
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+    receiver_.repeater_ = this;
+  }
+  began_ = true;
+  return true;
+}
+
+void Repeater::end() {
+  if (!began_) {
+    return;
+  }
+  began_ = false;
+
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+    receiver_.repeater_ = nullptr;
+  }
+
+  sender_.end();
+  sender_.repeater_ = nullptr;
+  sender_.inactiveBuf_ = sender_.savedInactiveBuf_;
+  sender_.savedInactiveBuf_ = nullptr;
+  sender_.inactivePacketSize_ = sender_.activePacketSize_;
+  sender_.inactiveBufIndex_ = 0;
+  sender_.paused_ = false;
+  sender_.resumeCounter_ = 0;
+}
+
+bool Repeater::setPatch(int outputChannel, int inputChannel) {
+  if (began_ ||
+      outputChannel < 1 || kMaxDMXPacketSize <= outputChannel ||
+      inputChannel == 0 || kMaxDMXPacketSize <= inputChannel) {
+    return false;
+  }
+  map_[outputChannel] = std::max(inputChannel, -1);
+  return true;
+}
+
+bool Repeater::resetPatch() {
+  if (began_) {
+    return false;
+  }
+  for (int i = 0; i < kMaxDMXPacketSize; i++) {
+    map_[i] = i;
+  }
+  return true;
+}
+
+int Repeater::patch(int outputChannel) const {
+  if (outputChannel < 1 || kMaxDMXPacketSize <= outputChannel) {
+    return -1;
+  }
+  return map_[outputChannel];
+}
+
+void Repeater::updateNeeds() {
+  // An output slot needs its own input slot, because the sizes are the same,
+  // plus whatever its patch and the slots before it need
+  int need = 0;
+  for (int i = 0; i < kMaxDMXPacketSize; i++) {
+    need = std::max(need, std::max(i, static_cast<int>(map_[i])) + 1);
+    needs_[i] = need;
+  }
+}
+
+void Repeater::sendNext() {
+  txBuf_ = rxBuf_;
+  starved_ = false;
+  sender_.inactiveBuf_ = bufs_[rxBuf_];
+  sender_.inactivePacketSize_ = ready_[rxBuf_];
+  sender_.inactiveBufIndex_ = 0;
+  sender_.resumeCounter_ = 1;
+  sender_.paused_ = false;
+}
+
+void Repeater::receiveStart() {
+  if (!sender_.began_) {
+    receiving_ = false;
+    return;
+  }
+
+  // Fill the buffer that isn't being sent. This replaces any pending packet
+  // that the sender hasn't started yet.
+  if (txBuf_ >= 0) {
+    rxBuf_ = 1 - txBuf_;
+  }
+  ready_[rxBuf_] = 0;
+  ended_[rxBuf_] = false;
+  receiving_ = true;
+
+  if (txBuf_ >= 0 && sender_.transmitting_) {
+    pending_ = true;
+    return;
+  }
+  pending_ = false;
+  sendNext();
+  sender_.sendHandler_->setActive();
+}
+
+void Repeater::receiveSlots(const uint8_t *buf, int size) {
+  if (!receiving_) {
+    return;
+  }
+
+  volatile uint8_t *out = bufs_[rxBuf_];
+  int n = ready_[rxBuf_];
+  if (n == 0) {
+    if (size <= 0) {
+      return;
+    }
+    patched_ = (buf[0] == 0);
+  }
+  if (patched_) {
+    while (n < size && needs_[n] <= size) {
+      int in = map_[n];
+      out[n] = (in < 0) ? 0 : buf[in];
+      n++;
+    }
+  } else {
+    for (; n < size; n++) {
+      out[n] = buf[n];
+    }
+  }
+  ready_[rxBuf_] = n;
+  updateSender();
+}
+
+void Repeater::receiveEnd(const uint8_t *buf, int size) {
+  if (!receiving_) {
+    return;
+  }
+  receiving_ = false;
+
+  // Input channels past the end of the packet are zero. The output keeps any
+  // slots that were already forwarded, even if the packet was discarded.
+  volatile uint8_t *out = bufs_[rxBuf_];
+  int n = ready_[rxBuf_];
+  if (n == 0 && size > 0) {
+    patched_ = (buf[0] == 0);
+  }
+  for (; n < size; n++) {
+    int in = patched_ ? map_[n] : n;
+    out[n] = (0 <= in && in < size) ? buf[in] : 0;
+  }
+  ready_[rxBuf_] = n;
+  ended_[rxBuf_] = true;
+  updateSender();
+}
+
+bool Repeater::sendDone() {
+  int b = txBuf_;
+  if (b >= 0 && !ended_[b]) {
+    starved_ = true;
+    return false;
+  }
+
+  if (pending_) {
+    pending_ = false;
+    sendNext();
+  } else {
+    txBuf_ = -1;
+  }
+  return true;
+}
+
+void Repeater::updateSender() {
+  if (pending_ || txBuf_ != rxBuf_) {
+    return;
+  }
+  int n = ready_[rxBuf_];
+  sender_.inactivePacketSize_ = n;
+  if (starved_ && (sender_.inactiveBufIndex_ < n || ended_[rxBuf_])) {
+    starved_ = false;
+    sender_.sendHandler_->setActive();
+  }
+}
+
+}  // namespace teensydmx
+}  // namespace qindesign
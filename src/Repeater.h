@@ -0,0 +1,144 @@
+// This file is part of the TeensyDMX library.
+// (c) 2022 Shawn Silverman
+
+// Repeater.h defines a way to forward the packets from a receiver to a sender
+// as they arrive, slot by slot.
+
+#ifndef TEENSYDMX_REPEATER_H_
+#define TEENSYDMX_REPEATER_H_
+
+// C++ includes
+#include <cstdint>
+
+#include "TeensyDMX.h"
+
+namespace qindesign {
+namespace teensydmx {
+
+// Forwards the slots from a receiver to a sender while they're being received,
+// instead of waiting for the whole packet. The sender starts its own BREAK and
+// MAB as soon as the receiver has validated an incoming BREAK, which happens
+// when the start code arrives, and then it sends each slot once it's been
+// received. This keeps the delay through the repeater close to the output's
+// BREAK plus MAB time, instead of a whole packet.
+//
+// The output slots can be patched. Each output channel takes its value from
+// any input channel, or it's always zero. Patches only apply to packets having
+// a zero start code; other packets are forwarded as-is. An output slot is sent
+// only once every input channel needed by it and by all the slots before it
+// has been received, so patching a low output channel to a high input channel
+// adds delay. The output packet has the same size as the input packet.
+//
+// The sender's own BREAK, MAB, and inter-slot times are used for the output.
+// Any refresh rate or MBB time adds delay, so leave them at their defaults.
+// The sender's buffer isn't sent while the repeater is running.
+//
+// Slots received with DMA are only forwarded once each block has been received.
+//
+// The receiver's and sender's serial ports must have the same interrupt
+// priority, because the receiver's ISR drives the sender's state.
+class Repeater final {
+ public:
+  // Creates a new repeater. All output channels initially take their values
+  // from the same input channel.
+  Repeater(Receiver &receiver, Sender &sender);
+
+  // Destructs the repeater. This calls `end()`.
+  ~Repeater();
+
+  // The ISRs refer to this object, so it can't be copied or moved
+  Repeater(const Repeater &) = delete;
+  Repeater &operator=(const Repeater &) = delete;
+
+  // Starts repeating. This restarts the sender in repeater mode. The receiver
+  // should be started separately. This returns `false` if the repeater is
+  // already running, if the sender is in a group or is playing frames, or if
+  // the receiver or sender is used by another repeater. Otherwise, this
+  // returns `true`.
+  bool begin();
+
+  // Stops repeating. This stops the sender and restores its own buffer.
+  void end();
+
+  // Returns whether the repeater is running.
+  bool isRunning() const {
+    return began_;
+  }
+
+  // Patches an output channel to an input channel. A negative input channel
+  // makes the output always zero. This returns `false` if the repeater is
+  // running or if either channel is outside the range 1-512. Otherwise, this
+  // returns `true`.
+  bool setPatch(int outputChannel, int inputChannel);
+
+  // Restores the default patch, where each output channel takes its value from
+  // the same input channel. This returns `false` if the repeater is running.
+  bool resetPatch();
+
+  // Returns the input channel patched to an output channel, or -1 if the
+  // output is always zero. This also returns -1 if the output channel is
+  // outside the range 1-512.
+  int patch(int outputChannel) const;
+
+ private:
+  // Updates the number of input slots that each output slot needs.
+  void updateNeeds();
+
+  // Points the sender at the buffer being filled and lets it send one packet.
+  void sendNext();
+
+  // Called by the receiver when an incoming BREAK has been validated. This
+  // starts the next output packet.
+  // This is called from an ISR.
+  void receiveStart();
+
+  // Called by the receiver when the packet being received has `size` slots in
+  // `buf`. This forwards any output slots that can now be sent.
+  // This is called from an ISR.
+  void receiveSlots(const uint8_t *buf, int size);
+
+  // Called by the receiver when the packet being received has ended, having
+  // `size` slots in `buf`. This forwards all the remaining output slots.
+  // This is called from an ISR.
+  void receiveEnd(const uint8_t *buf, int size);
+
+  // Called by the sender when it has sent all the output slots that are ready.
+  // This returns `true` if the packet is done, and then switches the sender to
+  // any pending packet. Otherwise, this returns `false` and the sender waits
+  // for more slots.
+  // This is called from an ISR.
+  bool sendDone();
+
+  // Gives the sender the new output size of the packet being sent, and wakes
+  // it if it's waiting for slots.
+  void updateSender();
+
+  Receiver &receiver_;
+  Sender &sender_;
+  volatile bool began_;
+
+  // Output packets, in output order. One is being sent while the next one is
+  // being received.
+  volatile uint8_t bufs_[2][kMaxDMXPacketSize];
+  volatile int ready_[2];    // Output slots ready to send
+  volatile bool ended_[2];   // Whether the input packet has ended
+  int rxBuf_;                // Buffer being filled
+  volatile int txBuf_;       // Buffer being sent, or -1 if none
+  volatile bool pending_;    // Whether the filled buffer waits to be sent
+  volatile bool receiving_;  // Whether an input packet is in progress
+  bool patched_;             // Whether the patch applies to the input packet
+  volatile bool starved_;    // Whether the sender waits for more slots
+
+  // The input channel for each output channel, or -1 for always zero, and
+  // the number of input slots needed to send each output slot
+  int16_t map_[kMaxDMXPacketSize];
+  int16_t needs_[kMaxDMXPacketSize];
+
+  friend class Receiver;
+  friend class Sender;
+};
+
+}  // namespace teensydmx
+}  // namespace qindesign
+
+#endif  // TEENSYDMX_REPEATER_H_
@@ -99,6 +99,41 @@ class Responder {
     return -1;
   }
 
+  // Processes a chunk of bytes that were received together, for example when
+  // the UART's FIFO was read. This is called instead of `processByte` for
+  // those bytes. The new bytes are at indexes `start` through
+  // `start + count - 1`, so the packet length is `start + count` after this
+  // chunk. `start` will always be at least 1 because the start code is always
+  // passed to `processByte`.
+  //
+  // The return value has the same meaning as for `processByte`. If a response
+  // should be sent then `len` must be set to the packet length at which the
+  // response became ready; any received bytes after that point are treated as
+  // extra bytes after the end of the packet. Otherwise, `len` is ignored.
+  //
+  // The default implementation calls `processByte` for each byte, stopping at
+  // the first response.
+  //
+  // This may be called from inside an interrupt routine, so it's important to
+  // execute as quickly as possible.
+  //
+  // @param buf a buffer containing the packet so far
+  // @param start the index of the first new byte
+  // @param count the number of new bytes, at least 1
+  // @param outBuf buffer for output, at least `outputBufferSize()` bytes
+  // @param len the packet length at which a response became ready, if any
+  virtual int processBytes(const uint8_t *buf, int start, int count,
+                           uint8_t *outBuf, int *len) {
+    for (int i = start + 1; i <= start + count; i++) {
+      int respLen = processByte(buf, i, outBuf);
+      if (respLen > 0) {
+        *len = i;
+        return respLen;
+      }
+    }
+    return -1;
+  }
+
   // Receives a packet. This doesn't return a response because the end of a
   // packet is determined heuristically and there's no way to guarantee that
   // response timing is correct.
@@ -15,8 +15,22 @@ class Sender;
 // Defines this interface.
 class SendHandler {
  public:
+  // The concrete handler types. The ISRs check this before calling a port's
+  // handler directly, without dynamic dispatch.
+  enum class Kind {
+    kUART,
+    kLPUART,
+    kFlexIO,
+    kOther,  // Not driven by the port's interrupt, for example a simulator's
+  };
+
   virtual ~SendHandler() = default;
 
+  // Returns this handler's type.
+  Kind kind() const {
+    return kind_;
+  }
+
   // Indicates that the BREAK/MAB serial parameters have changed.
   void breakSerialParamsChanged() {
     breakSerialParamsChanged_ = true;
@@ -46,12 +60,33 @@ class SendHandler {
   // Handles interrupts.
   virtual void irqHandler() const = 0;
 
+  // The following are used by `SenderGroup` to generate a BREAK and MAB for
+  // several senders at once. They're called from an ISR while the UART
+  // is inactive.
+
+  // Starts a BREAK by inverting the TX line.
+  virtual void startBreak() const = 0;
+
+  // Ends the BREAK and starts the MAB by restoring the TX line.
+  virtual void startMAB() const = 0;
+
+  // Sends a BREAK and MAB using the BREAK serial parameters, for when a timer
+  // isn't available. This puts the UART into "COMPLETING" mode.
+  virtual void sendSerialBreak() const = 0;
+
+  // Returns the baud rate the hardware actually produces when asked for the
+  // given rate, after the divisor has been rounded. This returns zero if the
+  // given rate is zero.
+  virtual uint32_t actualBaud(uint32_t baud) const = 0;
+
  protected:
-  SendHandler(int serialIndex, Sender *sender)
-      : serialIndex_(serialIndex),
+  SendHandler(int serialIndex, Sender *sender, Kind kind = Kind::kOther)
+      : kind_(kind),
+        serialIndex_(serialIndex),
         sender_(sender),
         breakSerialParamsChanged_(true) {}
 
+  const Kind kind_;
   const int serialIndex_;
   Sender *sender_;
 
@@ -5,8 +5,14 @@
 
 // C++ includes
 #include <algorithm>
+#include <atomic>
 #include <limits>
 
+#include <core_pins.h>
+
+#include "Repeater.h"
+#include "SenderGroup.h"
+
 namespace qindesign {
 namespace teensydmx {
 
@@ -38,6 +44,29 @@ constexpr uint32_t kDefaultMABTime   = 20;   // In us
 constexpr uint32_t kSerialFormatRXINVBit = 0x10;
 constexpr uint32_t kSerialFormatTXINVBit = 0x20;
 
+// The BREAK serial formats that `setBreakSerialParamsFromTimes` chooses from,
+// and how many bit times of BREAK and MAB each one produces when sending a
+// zero. These match `Sender::breakSerialBits()`.
+struct BreakFormat {
+  uint32_t format;
+  uint32_t breakBits;
+  uint32_t mabBits;
+};
+constexpr BreakFormat kBreakFormats[]{
+    {SERIAL_8N1, 9, 1},
+    {SERIAL_8N2, 9, 2},
+    {SERIAL_8E1, 10, 1},
+    {SERIAL_7O1, 8, 2},
+#if defined(__MK64FX512__) || defined(__MK66FX1M0__) || defined(KINETISL) || \
+    defined(__IMXRT1062__) || defined(__IMXRT1052__)
+    {SERIAL_8E2, 10, 2},
+    {SERIAL_8O2, 9, 3},
+#endif  // Serial 8E2- and 8O2-supporting chips
+#ifdef SERIAL_9BIT_SUPPORT
+    {SERIAL_9E1, 11, 1},
+#endif  // SERIAL_9BIT_SUPPORT
+};
+
 #ifndef TEENSYDMX_USE_PERIODICTIMER
 // Empirically observed BREAK generation adjustment constants, for 180us. The
 // timer adjust values are added to the requested BREAK to get the actual BREAK.
@@ -186,18 +215,61 @@ void lpuart5_tx_isr();
 
 // Used by the TX ISRs
 #if defined(__IMXRT1052__) || defined(ARDUINO_TEENSY41)
-static Sender *volatile txInstances[8]{nullptr};
+constexpr int kSerialInstanceCount = 8;
 #else
-static Sender *volatile txInstances[7]{nullptr};
+constexpr int kSerialInstanceCount = 7;
 #endif  // __IMXRT1052__ || ARDUINO_TEENSY41
 
+#if defined(__IMXRT1062__)
+// FlexIO senders are indexed after the serial ports
+constexpr int kFlexIOIndexStart = kSerialInstanceCount;
+constexpr int kFlexIOIndexEnd =
+    kFlexIOIndexStart + flexio::kChannelCount;
+static Sender *volatile txInstances[kFlexIOIndexEnd]{nullptr};
+#else
+static Sender *volatile txInstances[kSerialInstanceCount]{nullptr};
+#endif  // __IMXRT1062__
+
 Sender::Sender(HardwareSerial &uart)
-    : TeensyDMX(uart),
+    : Sender(&uart, serialIndex(uart), nullptr) {}
+
+Sender::Sender(HardwareSerial &uart, Storage &storage)
+    : Sender(&uart, serialIndex(uart), &storage) {}
+
+#if defined(__IMXRT1062__)
+// Returns the instance index for the given FlexIO pin, or -1 if the pin isn't
+// supported.
+static int flexIOIndex(const FlexIOPin &pin) {
+  int channel = flexio::channelForPin(pin.pin);
+  if (channel < 0) {
+    return -1;
+  }
+  return kFlexIOIndexStart + channel;
+}
+
+Sender::Sender(const FlexIOPin &pin)
+    : Sender(nullptr, flexIOIndex(pin), nullptr) {}
+
+Sender::Sender(const FlexIOPin &pin, Storage &storage)
+    : Sender(nullptr, flexIOIndex(pin), &storage) {}
+#endif  // __IMXRT1062__
+
+Sender::Sender(HardwareSerial *uart, int index, Storage *storage)
+    : TeensyDMX(uart, index),
       began_(false),
       state_(XmitStates::kIdle),
-      activeBuf_{0},
-      inactiveBuf_{0},
+      buf1_(nullptr),
+      buf2_(nullptr),
+      activeBuf_(nullptr),
+      inactiveBuf_(nullptr),
       inactiveBufIndex_(0),
+      activeBufChanged_(false),
+      activeBufStale_(false),
+      savedInactiveBuf_(nullptr),
+      buf3_(nullptr),
+      stagingBuf_(nullptr),
+      stagingPacketSize_(kMaxDMXPacketSize),
+      frameOpen_(false),
       breakTime_(kDefaultBreakTime),
       mabTime_(kDefaultMABTime),
 #ifndef TEENSYDMX_USE_PERIODICTIMER
@@ -209,8 +281,14 @@ Sender::Sender(HardwareSerial &uart)
       breakUseTimer_(false),
       interSlotTime_(0),
       adjustedInterSlotTime_(0),
+      interSlotIdleChars_(false),
+      dmaEnabled_(false),
       activePacketSize_(kMaxDMXPacketSize),
       inactivePacketSize_(kMaxDMXPacketSize),
+      adaptivePacketSize_(false),
+      fullSizeInterval_(kDefaultFullSizeInterval),
+      dataSize_(1),
+      packetsSinceFullSize_(0),
       mbbTime_(0),
       adjustedMBBTime_(0),
       refreshRate_(std::numeric_limits<float>::infinity()),
@@ -219,7 +297,36 @@ Sender::Sender(HardwareSerial &uart)
       paused_(false),
       resumeCounter_(0),
       transmitting_(false),
-      doneTXFunc_{nullptr} {
+      doneTXFunc_{nullptr},
+      group_(nullptr),
+      groupWaiting_(false),
+      repeater_(nullptr),
+      playbackRing_(nullptr),
+      playbackCapacity_(0),
+      playbackHead_(0),
+      playbackTail_(0),
+      playbackCurrent_(false),
+      playbackStopping_(false),
+      playbackSent_(0),
+      playbackStartTime_(0),
+      playbackLowWater_(0),
+      playbackLowFunc_{nullptr},
+      stats_{},
+      mabStartTime_(0),
+      breakStartValid_(false),
+      frameTimerBreak_(false),
+      frameDMA_(false) {
+  if (storage == nullptr) {
+    storage = reinterpret_cast<Storage *>(alignStorage(storageBlock_));
+  }
+  std::fill_n(&storage->bufs[0][0], sizeof(storage->bufs), 0);
+  buf1_ = storage->bufs[0];
+  buf2_ = storage->bufs[1];
+  buf3_ = storage->bufs[2];
+  activeBuf_ = buf1_;
+  inactiveBuf_ = buf2_;
+  stagingBuf_ = buf3_;
+
 #ifndef TEENSYDMX_USE_PERIODICTIMER
   setBreakTime(breakTime_);
 #endif  // !TEENSYDMX_USE_PERIODICTIMER
@@ -229,84 +336,98 @@ Sender::Sender(HardwareSerial &uart)
 #if defined(HAS_KINETISK_UART0) || defined(HAS_KINETISL_UART0)
     case 0:
       sendHandler_ = std::make_unique<UARTSendHandler>(
-          serialIndex_, this, &KINETISK_UART0, IRQ_UART0_STATUS, &uart0_tx_isr);
+          serialIndex_, this, &KINETISK_UART0, IRQ_UART0_STATUS, &uart0_tx_isr,
+          DMAMUX_SOURCE_UART0_TX);
       break;
 #elif defined(IMXRT_LPUART6)
     case 0:
       sendHandler_ = std::make_unique<LPUARTSendHandler>(
-          serialIndex_, this, &IMXRT_LPUART6, IRQ_LPUART6, lpuart6_tx_isr);
+          serialIndex_, this, &IMXRT_LPUART6, IRQ_LPUART6, lpuart6_tx_isr,
+          DMAMUX_SOURCE_LPUART6_TX);
       break;
 #endif  // HAS_KINETISK_UART0 || HAS_KINETISL_UART0 || IMXRT_LPUART6
 
 #if defined(HAS_KINETISK_UART1) || defined(HAS_KINETISL_UART1)
     case 1:
       sendHandler_ = std::make_unique<UARTSendHandler>(
-          serialIndex_, this, &KINETISK_UART1, IRQ_UART1_STATUS, &uart1_tx_isr);
+          serialIndex_, this, &KINETISK_UART1, IRQ_UART1_STATUS, &uart1_tx_isr,
+          DMAMUX_SOURCE_UART1_TX);
       break;
 #elif defined(IMXRT_LPUART4)
     case 1:
       sendHandler_ = std::make_unique<LPUARTSendHandler>(
-          serialIndex_, this, &IMXRT_LPUART4, IRQ_LPUART4, lpuart4_tx_isr);
+          serialIndex_, this, &IMXRT_LPUART4, IRQ_LPUART4, lpuart4_tx_isr,
+          DMAMUX_SOURCE_LPUART4_TX);
       break;
 #endif  // HAS_KINETISK_UART1 || HAS_KINETISL_UART1 || IMXRT_LPUART4
 
 #if defined(HAS_KINETISK_UART2) || defined(HAS_KINETISL_UART2)
     case 2:
       sendHandler_ = std::make_unique<UARTSendHandler>(
-          serialIndex_, this, &KINETISK_UART2, IRQ_UART2_STATUS, &uart2_tx_isr);
+          serialIndex_, this, &KINETISK_UART2, IRQ_UART2_STATUS, &uart2_tx_isr,
+          DMAMUX_SOURCE_UART2_TX);
       break;
 #elif defined(IMXRT_LPUART2)
     case 2:
       sendHandler_ = std::make_unique<LPUARTSendHandler>(
-          serialIndex_, this, &IMXRT_LPUART2, IRQ_LPUART2, lpuart2_tx_isr);
+          serialIndex_, this, &IMXRT_LPUART2, IRQ_LPUART2, lpuart2_tx_isr,
+          DMAMUX_SOURCE_LPUART2_TX);
       break;
 #endif  // HAS_KINETISK_UART2 || HAS_KINETISL_UART2 || IMXRT_LPUART2
 
 #if defined(HAS_KINETISK_UART3)
     case 3:
       sendHandler_ = std::make_unique<UARTSendHandler>(
-          serialIndex_, this, &KINETISK_UART3, IRQ_UART3_STATUS, &uart3_tx_isr);
+          serialIndex_, this, &KINETISK_UART3, IRQ_UART3_STATUS, &uart3_tx_isr,
+          DMAMUX_SOURCE_UART3_TX);
       break;
 #elif defined(IMXRT_LPUART3)
     case 3:
       sendHandler_ = std::make_unique<LPUARTSendHandler>(
-          serialIndex_, this, &IMXRT_LPUART3, IRQ_LPUART3, lpuart3_tx_isr);
+          serialIndex_, this, &IMXRT_LPUART3, IRQ_LPUART3, lpuart3_tx_isr,
+          DMAMUX_SOURCE_LPUART3_TX);
       break;
 #endif  // HAS_KINETISK_UART3 || IMXRT_LPUART3
 
 #if defined(HAS_KINETISK_UART4)
     case 4:
       sendHandler_ = std::make_unique<UARTSendHandler>(
-          serialIndex_, this, &KINETISK_UART4, IRQ_UART4_STATUS, &uart4_tx_isr);
+          serialIndex_, this, &KINETISK_UART4, IRQ_UART4_STATUS, &uart4_tx_isr,
+          DMAMUX_SOURCE_UART4_TX);
       break;
 #elif defined(IMXRT_LPUART8)
     case 4:
       sendHandler_ = std::make_unique<LPUARTSendHandler>(
-          serialIndex_, this, &IMXRT_LPUART8, IRQ_LPUART8, lpuart8_tx_isr);
+          serialIndex_, this, &IMXRT_LPUART8, IRQ_LPUART8, lpuart8_tx_isr,
+          DMAMUX_SOURCE_LPUART8_TX);
       break;
 #endif  // HAS_KINETISK_UART4 || IMXRT_LPUART8
 
 #if defined(HAS_KINETISK_UART5)
     case 5:
       sendHandler_ = std::make_unique<UARTSendHandler>(
-          serialIndex_, this, &KINETISK_UART5, IRQ_UART5_STATUS, &uart5_tx_isr);
+          serialIndex_, this, &KINETISK_UART5, IRQ_UART5_STATUS, &uart5_tx_isr,
+          DMAMUX_SOURCE_UART5_TX);
       break;
 #elif defined(HAS_KINETISK_LPUART0)
     case 5:
       sendHandler_ = std::make_unique<LPUARTSendHandler>(
-          serialIndex_, this, &KINETISK_LPUART0, IRQ_LPUART0, lpuart0_tx_isr);
+          serialIndex_, this, &KINETISK_LPUART0, IRQ_LPUART0, lpuart0_tx_isr,
+          DMAMUX_SOURCE_LPUART0_TX);
       break;
 #elif defined(IMXRT_LPUART1)
     case 5:
       sendHandler_ = std::make_unique<LPUARTSendHandler>(
-          serialIndex_, this, &IMXRT_LPUART1, IRQ_LPUART1, lpuart1_tx_isr);
+          serialIndex_, this, &IMXRT_LPUART1, IRQ_LPUART1, lpuart1_tx_isr,
+          DMAMUX_SOURCE_LPUART1_TX);
       break;
 #endif  // HAS_KINETISK_UART5 || HAS_KINETISK_LPUART0 || IMXRT_LPUART1
 
 #if defined(IMXRT_LPUART7)
     case 6:
       sendHandler_ = std::make_unique<LPUARTSendHandler>(
-          serialIndex_, this, &IMXRT_LPUART7, IRQ_LPUART7, lpuart7_tx_isr);
+          serialIndex_, this, &IMXRT_LPUART7, IRQ_LPUART7, lpuart7_tx_isr,
+          DMAMUX_SOURCE_LPUART7_TX);
       break;
 #endif  // IMXRT_LPUART7
 
@@ -314,11 +435,18 @@ Sender::Sender(HardwareSerial &uart)
     (defined(__IMXRT1052__) || defined(ARDUINO_TEENSY41))
     case 7:
       sendHandler_ = std::make_unique<LPUARTSendHandler>(
-          serialIndex_, this, &IMXRT_LPUART5, IRQ_LPUART5, lpuart5_tx_isr);
+          serialIndex_, this, &IMXRT_LPUART5, IRQ_LPUART5, lpuart5_tx_isr,
+          DMAMUX_SOURCE_LPUART5_TX);
       break;
 #endif  // IMXRT_LPUART5 && (__IMXRT1052__ || ARDUINO_TEENSY41)
 
     default:
+#if defined(__IMXRT1062__)
+      if (kFlexIOIndexStart <= serialIndex_ && serialIndex_ < kFlexIOIndexEnd) {
+        sendHandler_ = std::make_unique<FlexIOSendHandler>(
+            serialIndex_, this, serialIndex_ - kFlexIOIndexStart);
+      }
+#endif  // __IMXRT1062__
       break;
   }
 }
@@ -339,6 +467,9 @@ void Sender::begin() {
 
   // Reset all the stats
   resetPacketCount();
+  stats_ = Stats{};
+  breakStartValid_ = false;
+  frameDMA_ = false;
 
   // Set up the instance for the ISRs
   Sender *s = txInstances[serialIndex_];
@@ -373,6 +504,13 @@ void Sender::end() {
   sendHandler_->end();
   intervalTimer_.end();
 
+  // Any group no longer needs to wait for this sender
+  groupWaiting_ = false;
+  SenderGroup *group = group_;
+  if (group != nullptr) {
+    group->senderIdle();
+  }
+
   // Remove the reference from the instances,
   // but only if we're the ones who added it
   if (txInstances[serialIndex_] == this) {
@@ -387,35 +525,42 @@ void Sender::setBreakTime(uint32_t t) {
 }
 #endif  // !TEENSYDMX_USE_PERIODICTIMER
 
-uint32_t Sender::breakTime() const {
-  if (isBreakUseTimerNotSerial()) {
-    return breakTime_;
-  }
-
-  uint32_t t;
+bool Sender::breakSerialBits(uint32_t *breakBits, uint32_t *mabBits) const {
   switch (breakSerialFormat() &
           ~(kSerialFormatTXINVBit | kSerialFormatRXINVBit)) {
     case SERIAL_7E1:
-    case SERIAL_8N1:
+    case SERIAL_8N1: *breakBits = 9; *mabBits = 1; break;
     case SERIAL_8O1:
-    case SERIAL_8N2: t = 9; break;
-    case SERIAL_8E1: t = 10; break;
+    case SERIAL_8N2: *breakBits = 9; *mabBits = 2; break;
+    case SERIAL_8E1: *breakBits = 10; *mabBits = 1; break;
 #if defined(__MK64FX512__) || defined(__MK66FX1M0__) || defined(KINETISL) || \
     defined(__IMXRT1062__) || defined(__IMXRT1052__)
-    case SERIAL_8E2: t = 10; break;
-    case SERIAL_8O2: t = 9; break;
+    case SERIAL_8E2: *breakBits = 10; *mabBits = 2; break;
+    case SERIAL_8O2: *breakBits = 9; *mabBits = 3; break;
 #endif  // Serial 8E2- and 8O2-supporting chips
-    case SERIAL_7O1: t = 8; break;
+    case SERIAL_7O1: *breakBits = 8; *mabBits = 2; break;
 #ifdef SERIAL_9BIT_SUPPORT
-    case SERIAL_9N1:
-    case SERIAL_9O1: t = 10; break;
-    case SERIAL_9E1: t = 11; break;
+    case SERIAL_9N1: *breakBits = 10; *mabBits = 1; break;
+    case SERIAL_9O1: *breakBits = 10; *mabBits = 2; break;
+    case SERIAL_9E1: *breakBits = 11; *mabBits = 1; break;
 #endif  // SERIAL_9BIT_SUPPORT
     default:
-      return kDefaultBreakTime;
+      return false;
+  }
+  return true;
+}
+
+uint32_t Sender::breakTime() const {
+  if (isBreakUseTimerNotSerial()) {
+    return breakTime_;
   }
 
-  return (t * 1000000) / breakSerialBaud();
+  uint32_t breakBits;
+  uint32_t mabBits;
+  if (!breakSerialBits(&breakBits, &mabBits)) {
+    return kDefaultBreakTime;
+  }
+  return (breakBits * 1000000) / actualBreakBaud(breakSerialBaud());
 }
 
 void Sender::setMABTime(uint32_t t) {
@@ -432,30 +577,12 @@ uint32_t Sender::mabTime() const {
     return mabTime_;
   }
 
-  uint32_t t;
-  switch (breakSerialFormat() &
-          ~(kSerialFormatTXINVBit | kSerialFormatRXINVBit)) {
-    case SERIAL_7E1:
-    case SERIAL_8N1:
-    case SERIAL_8E1: t = 1; break;
-    case SERIAL_7O1:
-    case SERIAL_8O1:
-    case SERIAL_8N2: t = 2; break;
-#if defined(__MK64FX512__) || defined(__MK66FX1M0__) || defined(KINETISL) || \
-    defined(__IMXRT1062__) || defined(__IMXRT1052__)
-    case SERIAL_8E2: t = 2; break;
-    case SERIAL_8O2: t = 3; break;
-#endif  // Serial 8E2- and 8O2-supporting chips
-#ifdef SERIAL_9BIT_SUPPORT
-    case SERIAL_9N1:
-    case SERIAL_9E1: t = 1; break;
-    case SERIAL_9O1: t = 2; break;
-#endif  // SERIAL_9BIT_SUPPORT
-    default:
-      return kDefaultMABTime;
+  uint32_t breakBits;
+  uint32_t mabBits;
+  if (!breakSerialBits(&breakBits, &mabBits)) {
+    return kDefaultMABTime;
   }
-
-  return (t * 1000000) / breakSerialBaud();
+  return (mabBits * 1000000) / actualBreakBaud(breakSerialBaud());
 }
 
 bool Sender::setBreakSerialParams(uint32_t baud, uint32_t format) {
@@ -497,6 +624,56 @@ bool Sender::setBreakSerialParams(uint32_t baud, uint32_t format) {
   return true;
 }
 
+bool Sender::setBreakSerialParamsFromTimes(uint32_t breakTime,
+                                           uint32_t mabTime) {
+  if (breakTime == 0 || mabTime == 0) {
+    return false;
+  }
+
+  // For each format, use the fastest baud rate that the UART can actually
+  // produce and that still makes both times long enough, and then pick the
+  // format with the least excess
+  uint32_t bestBaud = 0;
+  uint32_t bestFormat = 0;
+  uint32_t bestExcess = UINT32_MAX;
+  for (const BreakFormat &f : kBreakFormats) {
+    uint32_t maxBaud = std::min(f.breakBits * 1000000 / breakTime,
+                                f.mabBits * 1000000 / mabTime);
+    uint32_t baud = maxBaud;
+    uint32_t actual = actualBreakBaud(baud);
+
+    // The divisor may round the rate up, so scale the request down until it
+    // doesn't; this converges in a few steps
+    for (int i = 0; i < 16 && baud != 0 && actual > maxBaud; i++) {
+      uint32_t next = uint64_t{baud} * maxBaud / actual;
+      baud = (next < baud) ? next : baud - 1;
+      actual = actualBreakBaud(baud);
+    }
+    if (baud == 0 || actual == 0 || actual > maxBaud) {
+      continue;
+    }
+    uint32_t excess = (f.breakBits * 1000000 / actual - breakTime) +
+                      (f.mabBits * 1000000 / actual - mabTime);
+    if (excess < bestExcess) {
+      bestBaud = baud;
+      bestFormat = f.format;
+      bestExcess = excess;
+    }
+  }
+  if (bestBaud == 0 || !setBreakSerialParams(bestBaud, bestFormat)) {
+    return false;
+  }
+  setBreakUseTimerNotSerial(false);
+  return true;
+}
+
+uint32_t Sender::actualBreakBaud(uint32_t baud) const {
+  if (sendHandler_ == nullptr) {
+    return baud;
+  }
+  return sendHandler_->actualBaud(baud);
+}
+
 void Sender::setInterSlotTime(uint32_t t) {
   interSlotTime_ = t;
   if (t <= kInterSlotTimerAdjust) {
@@ -510,6 +687,19 @@ uint32_t Sender::interSlotTime() const {
   return interSlotTime_;
 }
 
+void Sender::setDMAEnabled(bool flag) {
+  if (dmaEnabled_ == flag) {
+    return;
+  }
+  dmaEnabled_ = flag;
+
+  // The DMA channel is allocated or released when starting
+  if (began_) {
+    end();
+    begin();
+  }
+}
+
 bool Sender::setPacketSizeAndData(int size,
                                   int startChannel,
                                   const uint8_t *values,
@@ -521,7 +711,7 @@ bool Sender::setPacketSizeAndData(int size,
     return false;
   }
   if (len == 0) {
-    activePacketSize_ = size;
+    setPacketSize(size);
     return true;
   }
   if (startChannel + len <= 0 || kMaxDMXPacketSize < startChannel + len) {
@@ -531,15 +721,12 @@ bool Sender::setPacketSizeAndData(int size,
     return false;
   }
 
-  if (activePacketSize_ == size) {
-    std::copy_n(&values[0], len, &activeBuf_[startChannel]);
-  } else {
-    Lock lock{*this};
-    //{
-      activePacketSize_ = size;
-      std::copy_n(&values[0], len, &activeBuf_[startChannel]);
-    //}
-  }
+  WriteAccess access{*this};
+  //{
+    access.setPacketSize(size);
+    std::copy_n(&values[0], len, &access.buf()[startChannel]);
+    markChannels(startChannel, values, len);
+  //}
   return true;
 }
 
@@ -547,7 +734,11 @@ bool Sender::setPacketSize(int size) {
   if (size <= 0 || kMaxDMXPacketSize < size) {
     return false;
   }
-  activePacketSize_ = size;
+  if (frameOpen_) {
+    stagingPacketSize_ = size;
+  } else {
+    activePacketSize_ = size;
+  }
   return true;
 }
 
@@ -555,9 +746,12 @@ bool Sender::set(int channel, uint8_t value) {
   if (channel < 0 || kMaxDMXPacketSize <= channel) {
     return false;
   }
-  Lock lock{*this};
+  WriteAccess access{*this};
   //{
-    activeBuf_[channel] = value;
+    access.buf()[channel] = value;
+    if (value != 0) {
+      markChannel(channel);
+    }
   //}
   return true;
 }
@@ -567,10 +761,15 @@ bool Sender::set16Bit(int channel, uint16_t value) {
     return false;
   }
 
-  Lock lock{*this};
+  WriteAccess access{*this};
   //{
-    activeBuf_[channel] = value >> 8;
-    activeBuf_[channel + 1] = value;
+    access.buf()[channel] = value >> 8;
+    access.buf()[channel + 1] = value;
+    if ((value & 0xff) != 0) {
+      markChannel(channel + 1);
+    } else if (value != 0) {
+      markChannel(channel);
+    }
   //}
   return true;
 }
@@ -589,9 +788,10 @@ bool Sender::set(int startChannel, const uint8_t *values, int len) {
     return false;
   }
 
-  Lock lock{*this};
+  WriteAccess access{*this};
   //{
-    std::copy_n(&values[0], len, &activeBuf_[startChannel]);
+    std::copy_n(&values[0], len, &access.buf()[startChannel]);
+    markChannels(startChannel, values, len);
   //}
   return true;
 }
@@ -610,20 +810,22 @@ bool Sender::set16Bit(int startChannel, const uint16_t *values, int len) {
     return false;
   }
 
-  Lock lock{*this};
+  WriteAccess access{*this};
   //{
+    volatile uint8_t *buf = access.buf();
     for (int i = 0; i < len; i++) {
-      activeBuf_[startChannel++] = values[i] >> 8;
-      activeBuf_[startChannel++] = values[i];
+      buf[startChannel + 2*i] = values[i] >> 8;
+      buf[startChannel + 2*i + 1] = values[i];
     }
+    markChannels(startChannel, &buf[startChannel], len*2);
   //}
   return true;
 }
 
 void Sender::clear() {
-  Lock lock{*this};
+  WriteAccess access{*this, true};
   //{
-    std::fill_n(&activeBuf_[0], kMaxDMXPacketSize, uint8_t{0});
+    std::fill_n(&access.buf()[0], kMaxDMXPacketSize, uint8_t{0});
   //}
 }
 
@@ -638,13 +840,247 @@ bool Sender::fill(int startChannel, int len, uint8_t value) {
     return false;
   }
 
+  WriteAccess access{*this};
+  //{
+    std::fill_n(&access.buf()[startChannel], len, value);
+    if (value != 0) {
+      markChannel(startChannel + len - 1);
+    }
+  //}
+  return true;
+}
+
+bool Sender::startPlayback(PlaybackFrame *ring, int capacity) {
+  if (ring == nullptr || capacity <= 0) {
+    return false;
+  }
+
   Lock lock{*this};
   //{
-    std::fill_n(&activeBuf_[startChannel], len, value);
+    if (playbackRing_ != nullptr || repeater_ != nullptr) {
+      return false;
+    }
+    playbackCapacity_ = capacity;
+    playbackHead_ = 0;
+    playbackTail_ = 0;
+    playbackCurrent_ = false;
+    playbackStopping_ = false;
+    playbackRing_ = ring;
   //}
   return true;
 }
 
+void Sender::stopPlayback() {
+  Lock lock{*this};
+  //{
+    if (playbackRing_ == nullptr) {
+      return;
+    }
+    if (!playbackCurrent_) {
+      playbackRing_ = nullptr;
+      return;
+    }
+    if (!began_ || !transmitting_) {
+      // Nothing is using the frame data, so the regular buffer can be
+      // restored now
+      inactiveBuf_ = savedInactiveBuf_;
+      savedInactiveBuf_ = nullptr;
+      inactivePacketSize_ = nextPacketSize();
+      playbackCurrent_ = false;
+      playbackRing_ = nullptr;
+      return;
+    }
+    playbackStopping_ = true;
+  //}
+}
+
+bool Sender::queueFrame(const PlaybackFrame &f) {
+  if (f.data == nullptr || f.size <= 0 || kMaxDMXPacketSize < f.size) {
+    return false;
+  }
+
+  Lock lock{*this};
+  //{
+    PlaybackFrame *ring = playbackRing_;
+    if (ring == nullptr || playbackStopping_) {
+      return false;
+    }
+    uint32_t used = playbackTail_ - playbackHead_ + (playbackCurrent_ ? 1 : 0);
+    if (used >= static_cast<uint32_t>(playbackCapacity_)) {
+      return false;
+    }
+    ring[playbackTail_ % playbackCapacity_] = f;
+    playbackTail_ = playbackTail_ + 1;
+  //}
+  return true;
+}
+
+int Sender::queuedFrames() const {
+  Lock lock{*this};
+  //{
+    int n = (playbackRing_ == nullptr) ? 0 : playbackTail_ - playbackHead_;
+  //}
+  return n;
+}
+
+void Sender::onPlaybackLow(int lowWater, void (*f)(Sender *s)) {
+  Lock lock{*this};
+  //{
+    playbackLowWater_ = lowWater;
+    playbackLowFunc_ = f;
+  //}
+}
+
+bool Sender::advancePlayback() {
+  PlaybackFrame *ring = playbackRing_;
+  if (ring == nullptr) {
+    return false;
+  }
+
+  if (playbackStopping_) {
+    inactiveBuf_ = savedInactiveBuf_;
+    savedInactiveBuf_ = nullptr;
+    playbackCurrent_ = false;
+    playbackStopping_ = false;
+    playbackRing_ = nullptr;
+    return false;
+  }
+
+  if (playbackCurrent_) {
+    const PlaybackFrame &f = ring[(playbackHead_ - 1) % playbackCapacity_];
+    playbackSent_++;
+    bool done;
+    if (f.duration != 0) {
+      done = (micros() - playbackStartTime_ >= f.duration);
+    } else {
+      done = (playbackSent_ >= f.count);
+    }
+
+    // Keep sending the current frame until it's done, and after that if
+    // there's nothing else
+    if (!done || playbackTail_ == playbackHead_) {
+      return true;
+    }
+  } else if (playbackTail_ == playbackHead_) {
+    return false;
+  } else {
+    savedInactiveBuf_ = inactiveBuf_;
+  }
+
+  // Start the next frame
+  const PlaybackFrame &f = ring[playbackHead_ % playbackCapacity_];
+  playbackHead_ = playbackHead_ + 1;
+  playbackCurrent_ = true;
+  playbackSent_ = 0;
+  playbackStartTime_ = micros();
+  inactiveBuf_ = const_cast<uint8_t *>(f.data);  // Only read by the handlers
+  inactivePacketSize_ = f.size;
+
+  void (*lowFunc)(Sender *) = playbackLowFunc_;
+  if (lowFunc != nullptr &&
+      static_cast<int>(playbackTail_ - playbackHead_) <= playbackLowWater_) {
+    lowFunc(this);
+  }
+  return true;
+}
+
+void Sender::setAdaptivePacketSize(bool flag, int fullSizeInterval) {
+  Lock lock{*this};
+  //{
+    adaptivePacketSize_ = flag;
+    fullSizeInterval_ = fullSizeInterval;
+    packetsSinceFullSize_ = 0;
+  //}
+}
+
+void Sender::markChannels(int startChannel,
+                          const volatile uint8_t *values,
+                          int len) {
+  // Only the part above the current data size can change it
+  for (int i = len; --i >= 0 && startChannel + i >= dataSize_;) {
+    if (values[i] != 0) {
+      dataSize_ = startChannel + i + 1;
+      return;
+    }
+  }
+}
+
+int Sender::nextPacketSize() {
+  int size = activePacketSize_;
+  if (!adaptivePacketSize_) {
+    return size;
+  }
+  int interval = fullSizeInterval_;
+  if (interval > 0 && ++packetsSinceFullSize_ >= interval) {
+    packetsSinceFullSize_ = 0;
+    return size;
+  }
+
+  // Pad the packet so that it isn't shorter than the minimum BREAK-to-BREAK
+  // time, counting each slot's inter-slot MARK
+  int n = dataSize_;
+  uint32_t overhead = breakTime() + mabTime() + mbbTime_;
+  if (overhead < kMinDMXPacketTime) {
+    uint32_t slotTime =
+        kSlotTime + (useInterSlotIdleChars() ? kSlotTime : interSlotTime_);
+    int minSize = (kMinDMXPacketTime - overhead + slotTime - 1) / slotTime;
+    n = std::max(n, minSize);
+  }
+  return std::min(n, size);
+}
+
+void Sender::beginFrame() {
+  if (frameOpen_) {
+    return;
+  }
+
+  // Find the latest data. Only the lookup needs the lock because only the API
+  // modifies the buffer contents; the ISR may only swap them.
+  const volatile uint8_t *buf;
+  {
+    Lock lock{*this};
+    buf = activeBufStale_ ? latestSentBuf() : activeBuf_;
+    stagingPacketSize_ = activePacketSize_;
+  }
+  std::copy_n(&buf[0], kMaxDMXPacketSize, &stagingBuf_[0]);
+  frameOpen_ = true;
+}
+
+bool Sender::commitFrame() {
+  if (!frameOpen_) {
+    return false;
+  }
+
+  Lock lock{*this};
+  //{
+    volatile uint8_t *buf = activeBuf_;
+    activeBuf_ = stagingBuf_;
+    stagingBuf_ = buf;
+    activeBufStale_ = false;
+    activeBufChanged_ = true;
+    activePacketSize_ = stagingPacketSize_;
+    frameOpen_ = false;
+  //}
+  return true;
+}
+
+volatile uint8_t *Sender::beginFrameForOverwrite() {
+  if (!frameOpen_) {
+    stagingPacketSize_ = activePacketSize_;
+    frameOpen_ = true;
+  }
+  return stagingBuf_;
+}
+
+bool Sender::commitWrittenFrame(int size) {
+  if (!frameOpen_ || size <= 0 || kMaxDMXPacketSize < size) {
+    return false;
+  }
+  stagingPacketSize_ = size;
+  markChannels(0, stagingBuf_, size);
+  return commitFrame();
+}
+
 void Sender::setMBBTime(uint32_t t) {
   mbbTime_ = t;
   if (t <= kMBBTimerMin) {
@@ -686,7 +1122,7 @@ bool Sender::resumeFor(int n) {
 }
 
 bool Sender::resumeFor(int n, void (*doneTXFunc)(Sender *s)) {
-  if (n < 0) {
+  if (n < 0 || repeater_ != nullptr) {
     return false;
   }
 
@@ -695,9 +1131,11 @@ bool Sender::resumeFor(int n, void (*doneTXFunc)(Sender *s)) {
   //{
     resumeCounter_ = n;
     if (paused_) {
-      // Copy the active buffer into the inactive buffer
-      std::copy_n(&activeBuf_[0], kMaxDMXPacketSize, &inactiveBuf_[0]);
-      inactivePacketSize_ = activePacketSize_;
+      // Make the latest data available, unless it's being played back
+      if (playbackRing_ == nullptr || !playbackCurrent_) {
+        swapBuffersIfChanged();
+        inactivePacketSize_ = nextPacketSize();
+      }
 
       if (began_ && !transmitting_) {
         sendHandler_->setActive();
@@ -720,22 +1158,129 @@ bool Sender::isTransmitting() const {
   return state;
 }
 
-void Sender::completePacket() {
-  // Copy the active buffer into the inactive buffer
-  std::copy_n(&activeBuf_[0], kMaxDMXPacketSize, &inactiveBuf_[0]);
-  inactivePacketSize_ = activePacketSize_;
+void Sender::swapBuffersIfChanged() {
+  if (!activeBufChanged_) {
+    return;
+  }
+  volatile uint8_t *buf = inactiveBuf_;
+  inactiveBuf_ = activeBuf_;
+  activeBuf_ = buf;
+  activeBufChanged_ = false;
+  activeBufStale_ = true;
+}
+
+void Sender::prepareActiveBuf(bool overwrite) {
+  if (activeBufStale_) {
+    if (!overwrite) {
+      std::copy_n(&latestSentBuf()[0], kMaxDMXPacketSize, &activeBuf_[0]);
+    }
+    activeBufStale_ = false;
+  }
+  activeBufChanged_ = true;
+}
+
+bool Sender::completePacket() {
+  TEENSYDMX_PROFILE(kSendCompletePacket);
+
+  Repeater *repeater = repeater_;
+  if (repeater != nullptr) {
+    // The repeater supplies the next packet's buffer and size
+    if (!repeater->sendDone()) {
+      return false;
+    }
+  } else if (!advancePlayback()) {
+    // Make any changed data available for the next packet
+    swapBuffersIfChanged();
+    inactivePacketSize_ = nextPacketSize();
+  }
 
   incPacketCount();
+  if (frameTimerBreak_) {
+    stats_.timerBreakFrames++;
+  } else {
+    stats_.serialBreakFrames++;
+  }
+  if (frameDMA_) {
+    stats_.dmaFrames++;
+    frameDMA_ = false;
+  }
   inactiveBufIndex_ = 0;
   transmitting_ = false;
   state_ = XmitStates::kIdle;
 
   if (paused_) {
+    // The next BREAK, if any, won't be for the next packet in sequence
+    breakStartValid_ = false;
+
     void (*f)(Sender *) = doneTXFunc_;
     if (f != nullptr) {
       f(this);
     }
   }
+  return true;
+}
+
+// ---------------------------------------------------------------------------
+//  Output statistics
+// ---------------------------------------------------------------------------
+
+Sender::Stats Sender::stats() const {
+  Stats stats;
+  bool timerBreak;
+  {
+    Lock lock{*this};
+    std::atomic_signal_fence(std::memory_order_acquire);
+    stats = stats_;
+    timerBreak = frameTimerBreak_;
+  }
+  stats.targetBreakToBreakTime = breakToBreakTime_;
+
+  // Only the sum is measured for a serial BREAK
+  uint32_t breakBits;
+  uint32_t mabBits;
+  if (!timerBreak && stats.breakPlusMABTime != 0 &&
+      breakSerialBits(&breakBits, &mabBits)) {
+    uint32_t baud = actualBreakBaud(breakSerialBaud());
+    stats.breakTime = (breakBits * 1000000) / baud;
+    stats.mabTime = (mabBits * 1000000) / baud;
+  }
+  return stats;
+}
+
+void Sender::resetStats() {
+  Lock lock{*this};
+  //{
+    stats_ = Stats{};
+    breakStartValid_ = false;
+  //}
+}
+
+void Sender::breakStarted(uint32_t t, bool timer) {
+  if (breakStartValid_) {
+    uint32_t b2b = t - breakStartTime_;
+    if (stats_.breakToBreakCount == 0 || b2b < stats_.breakToBreakMin) {
+      stats_.breakToBreakMin = b2b;
+    }
+    if (b2b > stats_.breakToBreakMax) {
+      stats_.breakToBreakMax = b2b;
+    }
+    stats_.breakToBreakSum += b2b;
+    stats_.breakToBreakCount++;
+  }
+  breakStartValid_ = true;
+  breakStartTime_ = t;
+  frameTimerBreak_ = timer;
+}
+
+void Sender::slotsStarted(uint32_t t) {
+  stats_.breakPlusMABTime = t - breakStartTime_;
+  if (frameTimerBreak_) {
+    stats_.breakTime = mabStartTime_ - breakStartTime_;
+    stats_.mabTime = t - mabStartTime_;
+  } else {
+    stats_.breakTime = 0;
+    stats_.mabTime = 0;
+  }
 }
 
 // ---------------------------------------------------------------------------
@@ -749,6 +1294,19 @@ void Sender::setIRQState(bool flag) const {
   sendHandler_->setIRQState(flag);
 }
 
+// The ISRs below call the port's handler directly instead of through the
+// virtual interface. The handler classes are final, so once the handler's type
+// has been checked, the call doesn't need any dynamic dispatch. Any other
+// handler, for example a simulator's, isn't driven by the port, and so the
+// interrupt is ignored. The Kinetis UART ISRs also pass their `UARTPort`, so
+// that the handler's registers and FIFO depth are compile-time constants.
+template <typename Handler, typename... Port>
+static inline void callIRQHandler(const SendHandler *h, Port... port) {
+  if (h->kind() == Handler::kKind) {
+    static_cast<const Handler *>(h)->irqHandler(port...);
+  }
+}
+
 // ---------------------------------------------------------------------------
 //  UART0 TX ISR
 // ---------------------------------------------------------------------------
@@ -758,7 +1316,7 @@ void Sender::setIRQState(bool flag) const {
 void uart0_tx_isr() {
   Sender *s = txInstances[0];
   if (s != nullptr) {
-    s->sendHandler_->irqHandler();
+    callIRQHandler<UARTSendHandler>(s->sendHandler_.get(), UARTPort<0>{});
   }
 }
 
@@ -773,7 +1331,7 @@ void uart0_tx_isr() {
 void uart1_tx_isr() {
   Sender *s = txInstances[1];
   if (s != nullptr) {
-    s->sendHandler_->irqHandler();
+    callIRQHandler<UARTSendHandler>(s->sendHandler_.get(), UARTPort<1>{});
   }
 }
 
@@ -788,7 +1346,7 @@ void uart1_tx_isr() {
 void uart2_tx_isr() {
   Sender *s = txInstances[2];
   if (s != nullptr) {
-    s->sendHandler_->irqHandler();
+    callIRQHandler<UARTSendHandler>(s->sendHandler_.get(), UARTPort<2>{});
   }
 }
 
@@ -803,7 +1361,7 @@ void uart2_tx_isr() {
 void uart3_tx_isr() {
   Sender *s = txInstances[3];
   if (s != nullptr) {
-    s->sendHandler_->irqHandler();
+    callIRQHandler<UARTSendHandler>(s->sendHandler_.get(), UARTPort<3>{});
   }
 }
 
@@ -818,7 +1376,7 @@ void uart3_tx_isr() {
 void uart4_tx_isr() {
   Sender *s = txInstances[4];
   if (s != nullptr) {
-    s->sendHandler_->irqHandler();
+    callIRQHandler<UARTSendHandler>(s->sendHandler_.get(), UARTPort<4>{});
   }
 }
 
@@ -833,7 +1391,7 @@ void uart4_tx_isr() {
 void uart5_tx_isr() {
   Sender *s = txInstances[5];
   if (s != nullptr) {
-    s->sendHandler_->irqHandler();
+    callIRQHandler<UARTSendHandler>(s->sendHandler_.get(), UARTPort<5>{});
   }
 }
 
@@ -848,7 +1406,7 @@ void uart5_tx_isr() {
 void lpuart0_tx_isr() {
   Sender *s = txInstances[5];
   if (s != nullptr) {
-    s->sendHandler_->irqHandler();
+    callIRQHandler<LPUARTSendHandler>(s->sendHandler_.get());
   }
 }
 
@@ -863,7 +1421,7 @@ void lpuart0_tx_isr() {
 void lpuart6_tx_isr() {
   Sender *s = txInstances[0];
   if (s != nullptr) {
-    s->sendHandler_->irqHandler();
+    callIRQHandler<LPUARTSendHandler>(s->sendHandler_.get());
   }
 }
 
@@ -878,7 +1436,7 @@ void lpuart6_tx_isr() {
 void lpuart4_tx_isr() {
   Sender *s = txInstances[1];
   if (s != nullptr) {
-    s->sendHandler_->irqHandler();
+    callIRQHandler<LPUARTSendHandler>(s->sendHandler_.get());
   }
 }
 
@@ -893,7 +1451,7 @@ void lpuart4_tx_isr() {
 void lpuart2_tx_isr() {
   Sender *s = txInstances[2];
   if (s != nullptr) {
-    s->sendHandler_->irqHandler();
+    callIRQHandler<LPUARTSendHandler>(s->sendHandler_.get());
   }
 }
 
@@ -908,7 +1466,7 @@ void lpuart2_tx_isr() {
 void lpuart3_tx_isr() {
   Sender *s = txInstances[3];
   if (s != nullptr) {
-    s->sendHandler_->irqHandler();
+    callIRQHandler<LPUARTSendHandler>(s->sendHandler_.get());
   }
 }
 
@@ -923,7 +1481,7 @@ void lpuart3_tx_isr() {
 void lpuart8_tx_isr() {
   Sender *s = txInstances[4];
   if (s != nullptr) {
-    s->sendHandler_->irqHandler();
+    callIRQHandler<LPUARTSendHandler>(s->sendHandler_.get());
   }
 }
 
@@ -938,7 +1496,7 @@ void lpuart8_tx_isr() {
 void lpuart1_tx_isr() {
   Sender *s = txInstances[5];
   if (s != nullptr) {
-    s->sendHandler_->irqHandler();
+    callIRQHandler<LPUARTSendHandler>(s->sendHandler_.get());
   }
 }
 
@@ -953,7 +1511,7 @@ void lpuart1_tx_isr() {
 void lpuart7_tx_isr() {
   Sender *s = txInstances[6];
   if (s != nullptr) {
-    s->sendHandler_->irqHandler();
+    callIRQHandler<LPUARTSendHandler>(s->sendHandler_.get());
   }
 }
 
@@ -969,12 +1527,31 @@ void lpuart7_tx_isr() {
 void lpuart5_tx_isr() {
   Sender *s = txInstances[7];
   if (s != nullptr) {
-    s->sendHandler_->irqHandler();
+    callIRQHandler<LPUARTSendHandler>(s->sendHandler_.get());
   }
 }
 
 #endif  // IMXRT_LPUART5 && (__IMXRT1052__ || ARDUINO_TEENSY41)
 
+// ---------------------------------------------------------------------------
+//  FlexIO2 TX ISR (FlexIO senders on Teensy 4)
+// ---------------------------------------------------------------------------
+
+#if defined(__IMXRT1062__)
+
+// All the FlexIO senders and receivers share this interrupt, and each handler
+// only looks at its own flags. See FlexIO.cpp.
+void flexio2_tx_isr() {
+  for (int i = kFlexIOIndexStart; i < kFlexIOIndexEnd; i++) {
+    Sender *s = txInstances[i];
+    if (s != nullptr) {
+      callIRQHandler<FlexIOSendHandler>(s->sendHandler_.get());
+    }
+  }
+}
+
+#endif  // __IMXRT1062__
+
 // Undefine these macros
 #undef UART_C2_TX_ENABLE
 #undef UART_C2_TX_ACTIVE
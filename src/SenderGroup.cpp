@@ -0,0 +1,221 @@
+// This file is part of the TeensyDMX library.
+// (c) 2022 Shawn Silverman
+
+#include "SenderGroup.h"
+
+// C++ includes
+#include <algorithm>
+
+#include <core_pins.h>
+#include <util/atomic.h>
+
+namespace qindesign {
+namespace teensydmx {
+
+SenderGroup::SenderGroup()
+    : senders_{nullptr},
+      count_(0),
+      began_(false),
+      phase_(Phases::kIdle),
+      breakStartTime_(0) {}
+
+SenderGroup::~SenderGroup() {
+  end();
+}
+
+bool SenderGroup::add(Sender &s) {
+  if (began_ || count_ >= kMaxSenders || s.group_ != nullptr) {
+    return false;
+  }
+  if (std::find(&senders_[0], &senders_[count_], &s) != &senders_[count_]) {
+    return false;
+  }
+  senders_[count_++] = &s;
+  return true;
+}
+
+void SenderGroup::begin() {
+  if (began_ || count_ <= 0) {
+    return;
+  }
+
+  phase_ = Phases::kIdle;
+  breakStartTime_ = micros();
+
+  // Restart the senders so that their ISRs see the group from the start. The
+  // first BREAK waits until all of them have been started.
+  for (int i = 0; i < count_; i++) {
+    Sender *s = senders_[i];
+    s->end();
+    s->groupWaiting_ = false;
+    s->group_ = this;
+    s->begin();
+  }
+
+  // Match the UART priority
+  timer_.setPriority(senders_[0]->sendHandler_->priority());
+
+  began_ = true;
+  senderIdle();
+}
+
+void SenderGroup::end() {
+  if (!began_) {
+    return;
+  }
+  began_ = false;
+
+  timer_.end();
+  for (int i = 0; i < count_; i++) {
+    Sender *s = senders_[i];
+    s->end();
+    s->group_ = nullptr;
+  }
+  phase_ = Phases::kIdle;
+}
+
+void SenderGroup::senderIdle() {
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+    if (!began_ || phase_ != Phases::kIdle) {
+      return;
+    }
+
+    // Every running sender must either be waiting or paused
+    bool anyWaiting = false;
+    for (int i = 0; i < count_; i++) {
+      const Sender *s = senders_[i];
+      if (!s->began_ || s->serialIndex_ < 0) {
+        continue;
+      }
+      if (s->groupWaiting_) {
+        anyWaiting = true;
+      } else if (!s->paused_ || s->transmitting_) {
+        return;
+      }
+    }
+    if (!anyWaiting) {
+      return;
+    }
+
+    // Delay so that we can achieve the specified refresh rate
+    // including the MBB
+    const Sender *first = senders_[0];
+    if (first->breakToBreakTime_ == UINT32_MAX) {
+      // Infinite BREAK to BREAK time
+      return;
+    }
+    uint32_t timeSinceBreak = micros() - breakStartTime_;
+    uint32_t delay = first->adjustedMBBTime_;
+    if (timeSinceBreak + delay < first->breakToBreakTime_) {
+      delay = first->breakToBreakTime_ - timeSinceBreak;
+    }
+    if (delay > 0) {
+      phase_ = Phases::kRate;
+      if (timer_.begin(callback<&SenderGroup::rateTimerCallback>(), delay)) {
+        return;
+      }
+      for (int i = 0; i < count_; i++) {
+        Sender *s = senders_[i];
+        if (s->groupWaiting_) {
+          s->stats_.rateTimerFailures++;
+        }
+      }
+    }
+    // Starting the timer failed or no delay is necessary
+    startBreak();
+  }
+}
+
+void SenderGroup::startBreak() {
+  const Sender *first = senders_[0];
+  phase_ = Phases::kBreak;
+#ifndef TEENSYDMX_USE_PERIODICTIMER
+  if (timer_.begin(callback<&SenderGroup::breakTimerCallback>(),
+                   first->adjustedBreakTime_)) {
+    breakTimerPreCallback();
+#else
+  if (timer_.begin(callback<&SenderGroup::breakTimerCallback>(),
+                   first->breakTime_,
+                   callback<&SenderGroup::breakTimerPreCallback>())) {
+#endif  // !TEENSYDMX_USE_PERIODICTIMER
+    return;
+  }
+
+  // Starting the timer failed, so have each sender use its serial parameters
+  breakStartTime_ = micros();
+  for (int i = 0; i < count_; i++) {
+    Sender *s = senders_[i];
+    if (s->groupWaiting_) {
+      s->groupWaiting_ = false;
+      s->stats_.breakTimerFailures++;
+      s->sendHandler_->sendSerialBreak();
+    }
+  }
+  phase_ = Phases::kIdle;
+}
+
+void SenderGroup::breakTimerPreCallback() {
+  // Invert all the lines as close as possible to the timer start
+  for (int i = 0; i < count_; i++) {
+    Sender *s = senders_[i];
+    if (s->groupWaiting_) {
+      s->sendHandler_->startBreak();
+    }
+  }
+  uint32_t t = micros();
+  breakStartTime_ = t;
+  for (int i = 0; i < count_; i++) {
+    Sender *s = senders_[i];
+    if (s->groupWaiting_) {
+      s->breakStarted(t, true);
+    }
+  }
+}
+
+void SenderGroup::breakTimerCallback() {
+  TEENSYDMX_PROFILE(kBreakTimer);
+
+  bool mabFailed = false;
+  if (phase_ == Phases::kBreak) {
+    for (int i = 0; i < count_; i++) {
+      Sender *s = senders_[i];
+      if (s->groupWaiting_) {
+        s->sendHandler_->startMAB();
+        s->mabStarted(micros());
+        s->state_ = Sender::XmitStates::kMAB;
+      }
+    }
+    phase_ = Phases::kMAB;
+    if (timer_.restart(senders_[0]->adjustedMABTime_)) {
+      return;
+    }
+    // See the note in the send handlers' BREAK timer callbacks about
+    // a failed restart
+    mabFailed = true;
+  }
+  timer_.end();
+  phase_ = Phases::kIdle;
+  uint32_t t = micros();
+  for (int i = 0; i < count_; i++) {
+    Sender *s = senders_[i];
+    if (s->groupWaiting_) {
+      if (mabFailed) {
+        s->stats_.mabTimerFailures++;
+      }
+      s->slotsStarted(t);
+      s->groupWaiting_ = false;
+      s->state_ = Sender::XmitStates::kData;
+      s->sendHandler_->setActive();
+    }
+  }
+}
+
+void SenderGroup::rateTimerCallback() {
+  TEENSYDMX_PROFILE(kRateTimer);
+
+  timer_.end();
+  startBreak();
+}
+
+}  // namespace teensydmx
+}  // namespace qindesign
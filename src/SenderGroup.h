@@ -0,0 +1,134 @@
+// This file is part of the TeensyDMX library.
+// (c) 2022 Shawn Silverman
+
+// SenderGroup.h defines a way to drive several senders from one timer so that
+// their packets start at the same time.
+
+#ifndef TEENSYDMX_SENDERGROUP_H_
+#define TEENSYDMX_SENDERGROUP_H_
+
+// C++ includes
+#include <cstdint>
+
+#include "TeensyDMX.h"
+#ifndef TEENSYDMX_USE_PERIODICTIMER
+#include "util/IntervalTimerEx.h"
+#else
+#include "util/PeriodicTimer.h"
+#endif  // !TEENSYDMX_USE_PERIODICTIMER
+#include "util/Delegate.h"
+
+namespace qindesign {
+namespace teensydmx {
+
+// Drives a group of senders from one shared timer. Each packet's BREAK starts
+// on all the senders at the same time, in one pass from a single timer
+// interrupt, and the MAB ends on all of them at the same time. This keeps the
+// universes phase-aligned and it only uses one timer for the whole group,
+// instead of one for each sender.
+//
+// A new packet is started when every running, unpaused sender has finished
+// its current packet. The BREAK, MAB, and MBB times, and the refresh rate, are
+// taken from the first sender in the group; the grouped senders' own settings
+// for these are not used. The BREAK and MAB are always generated with the
+// timer, unless it can't be started, in which case each sender uses its
+// BREAK serial parameters. The slots, including any inter-slot MARK time, are
+// sent by each sender as usual.
+//
+// All the grouped senders' UARTs should have the same interrupt priority.
+class SenderGroup final {
+ public:
+  // The maximum number of senders in a group.
+  static constexpr int kMaxSenders = 8;
+
+  SenderGroup();
+
+  // Destructs the group. This calls `end()`.
+  ~SenderGroup();
+
+  // The timer callbacks refer to this object, so it can't be copied or moved
+  SenderGroup(const SenderGroup &) = delete;
+  SenderGroup &operator=(const SenderGroup &) = delete;
+
+  // Adds a sender to the group. This returns `false` if the group is running,
+  // if the group is full, or if the sender is already in this group or in
+  // another running group. Otherwise, this returns `true`.
+  bool add(Sender &s);
+
+  // Returns the number of senders in the group.
+  int size() const {
+    return count_;
+  }
+
+  // Starts the group. This restarts all the senders in group mode.
+  void begin();
+
+  // Stops the group. This calls `end()` on all the senders.
+  void end();
+
+  // Returns whether the group is running.
+  bool isRunning() const {
+    return began_;
+  }
+
+ private:
+  // Where we are in generating the BREAK and MAB.
+  enum class Phases {
+    kIdle,   // Waiting for the senders to be ready
+    kRate,   // Waiting for the MBB or refresh rate delay
+    kBreak,  // BREAK
+    kMAB,    // MARK after BREAK
+  };
+
+  // Called by a grouped sender when it has become idle, either because it
+  // finished a packet and is waiting for the next BREAK, or because it's paused
+  // or stopped. This starts the next packet if all the senders are ready.
+  // This may be called from an ISR.
+  void senderIdle();
+
+  // Starts the BREAK on all the waiting senders.
+  void startBreak();
+
+  // Returns a timer callback that calls the given member function.
+  template <void (SenderGroup::*Method)()>
+  util::Delegate callback() {
+    return util::Delegate::fromMethod<SenderGroup, Method>(this);
+  }
+
+  // Timer handling
+  void breakTimerCallback();     // When the timer triggers
+  void breakTimerPreCallback();  // Just before the timer starts
+  void rateTimerCallback();      // After the MBB delay
+
+  Sender *senders_[kMaxSenders];
+  int count_;
+
+  volatile bool began_;
+  volatile Phases phase_;
+
+  // Keeps track of the last BREAK start time, in microseconds. This is for
+  // refresh rate timing.
+  uint32_t breakStartTime_;
+
+#ifndef TEENSYDMX_USE_PERIODICTIMER
+  util::IntervalTimerEx timer_;
+#else
+  util::PeriodicTimer timer_;
+#endif  // !TEENSYDMX_USE_PERIODICTIMER
+
+  friend class Sender;
+#if defined(__IMXRT1062__) || defined(__IMXRT1052__) || defined(__MK66FX1M0__)
+  friend class LPUARTSendHandler;
+#endif  // __IMXRT1062__ || __IMXRT1052__ || __MK66FX1M0__
+#if defined(KINETISK) || defined(KINETISL)
+  friend class UARTSendHandler;
+#endif  // KINETISK || KINETISL
+#if defined(__IMXRT1062__)
+  friend class FlexIOSendHandler;
+#endif  // __IMXRT1062__
+};
+
+}  // namespace teensydmx
+}  // namespace qindesign
+
+#endif  // TEENSYDMX_SENDERGROUP_H_
@@ -0,0 +1,63 @@
+// This file is part of the TeensyDMX library.
+// (c) 2022 Shawn Silverman
+
+#include "SenderSimulator.h"
+
+// C++ includes
+#include <algorithm>
+#include <memory>
+
+#include <util/atomic.h>
+
+namespace qindesign {
+namespace teensydmx {
+
+SenderSimulator::SenderSimulator(HardwareSerial &uart)
+    : tx_(uart) {
+  tx_.sendHandler_ =
+      std::make_unique<SimulatedSendHandler>(tx_.serialIndex_, &tx_);
+}
+
+SenderSimulator::~SenderSimulator() {
+  end();
+}
+
+void SenderSimulator::begin() {
+  tx_.begin();
+}
+
+void SenderSimulator::end() {
+  tx_.end();
+}
+
+int SenderSimulator::sendPacket(uint8_t *buf, int len) {
+  int size = -1;
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+    // Sender::begin() doesn't start anything in these cases
+    bool running = tx_.began_ && tx_.serialIndex_ >= 0 && tx_.buf1_ != nullptr;
+
+    // A packet that was waiting for a repeater continues, otherwise this does
+    // the same pause management as the handlers do before a BREAK
+    if (running && (tx_.transmitting_ || !tx_.paused_)) {
+      if (!tx_.transmitting_) {
+        if (tx_.resumeCounter_ > 0) {
+          if (--tx_.resumeCounter_ == 0) {
+            tx_.paused_ = true;
+          }
+        }
+        tx_.transmitting_ = true;
+      }
+
+      int n = tx_.inactivePacketSize_;
+      std::copy_n(&tx_.inactiveBuf_[0], std::min(n, len), &buf[0]);
+      tx_.inactiveBufIndex_ = n;
+      if (tx_.completePacket()) {
+        size = n;
+      }
+    }
+  }
+  return size;
+}
+
+}  // namespace teensydmx
+}  // namespace qindesign
@@ -0,0 +1,67 @@
+// This file is part of the TeensyDMX library.
+// (c) 2022 Shawn Silverman
+
+// SenderSimulator.h defines a way to capture a sender's packets without any
+// UART traffic.
+
+#ifndef TEENSYDMX_SENDERSIMULATOR_H_
+#define TEENSYDMX_SENDERSIMULATOR_H_
+
+#include <HardwareSerial.h>
+
+#include "SimulatedSendHandler.h"
+#include "TeensyDMX.h"
+
+namespace qindesign {
+namespace teensydmx {
+
+// Runs a sender's packet sequencing without any UART traffic. The sender's
+// handler is replaced with one that doesn't touch the hardware, and each
+// packet is "sent" by calling `sendPacket()`, which copies out the data that
+// would have been transmitted and completes the packet the same way the UART
+// interrupts would, with interrupts disabled.
+//
+// The timing isn't simulated: there are no BREAKs, MABs, or rate delays, and
+// `sendPacket()` sends the next packet whenever it's called. This is useful
+// for checking what gets sent for a sequence of API calls, for example around
+// playback, repeaters, and frames. The sender is placed in the instance slot
+// for the UART, so that UART shouldn't also be used by another sender. The
+// sender shouldn't be added to a `SenderGroup`.
+class SenderSimulator final {
+ public:
+  // Creates a simulator for a new sender on the given UART.
+  explicit SenderSimulator(HardwareSerial &uart);
+
+  // Destructs the simulator. This calls `end()`.
+  ~SenderSimulator();
+
+  // The sender refers to this object, so it can't be copied or moved
+  SenderSimulator(const SenderSimulator &) = delete;
+  SenderSimulator &operator=(const SenderSimulator &) = delete;
+
+  // Returns the simulated sender. Its API can be used as usual, except for
+  // `begin()` and `end()`, which should be called here instead.
+  Sender &sender() {
+    return tx_;
+  }
+
+  // Starts the sender.
+  void begin();
+
+  // Stops the sender.
+  void end();
+
+  // Sends the next packet. This copies up to `len` bytes of it, starting with
+  // the start code, into `buf` and returns the packet size. If the sender
+  // isn't running, is paused, or is waiting for a repeater, then nothing is
+  // sent and this returns -1.
+  int sendPacket(uint8_t *buf, int len);
+
+ private:
+  Sender tx_;
+};
+
+}  // namespace teensydmx
+}  // namespace qindesign
+
+#endif  // TEENSYDMX_SENDERSIMULATOR_H_
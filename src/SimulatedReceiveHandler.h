@@ -0,0 +1,82 @@
+// This file is part of the TeensyDMX library.
+// (c) 2022 Shawn Silverman
+
+// SimulatedReceiveHandler.h defines a receive handler that doesn't touch any
+// hardware. It's used by `ReceiverSimulator`.
+
+#ifndef TEENSYDMX_SIMULATEDRECEIVEHANDLER_H_
+#define TEENSYDMX_SIMULATEDRECEIVEHANDLER_H_
+
+// C++ includes
+#include <cstdint>
+
+#include "ReceiveHandler.h"
+#include "TeensyDMX.h"
+
+namespace qindesign {
+namespace teensydmx {
+
+// A receive handler with no register access. Starting and stopping, and all
+// the IDLE, watermark, and IRQ settings, do nothing. Response data is counted
+// instead of being sent, and the response is completed as soon as it starts.
+class SimulatedReceiveHandler final : public ReceiveHandler {
+ public:
+  SimulatedReceiveHandler(int serialIndex, Receiver *receiver)
+      : ReceiveHandler(serialIndex, receiver),
+        responseCount_(0),
+        responseBytes_(0) {}
+
+  ~SimulatedReceiveHandler() override = default;
+
+  void start() override {}
+  void end() const override {}
+  void setTXEnabled(bool flag) const override {}
+  void setILT(bool flag) const override {}
+  void setRXWatermarkHigh(bool flag) const override {}
+  void setIRQState(bool flag) const override {}
+
+  // Returns the default timer priority.
+  int priority() const override {
+    return 128;
+  }
+
+  void irqHandler() const override {}
+  void txStartBreak() const override {}
+  void txStartMAB() const override {}
+
+  // Counts the response and completes it.
+  void txStartData() const override {
+    responseCount_ = responseCount_ + 1;
+    responseBytes_ = responseBytes_ + receiver_->responseLen_;
+    receiver_->responseComplete();
+  }
+
+  void txStop() const override {}
+
+  // Returns the number of responses that were sent.
+  uint32_t responseCount() const {
+    return responseCount_;
+  }
+
+  // Returns the total number of response bytes that were sent.
+  uint32_t responseBytes() const {
+    return responseBytes_;
+  }
+
+  // Resets the response counts to zero.
+  void resetResponseCounts() {
+    responseCount_ = 0;
+    responseBytes_ = 0;
+  }
+
+ private:
+  // These are changed from the const handler functions, the same way the
+  // hardware handlers change their port registers
+  mutable volatile uint32_t responseCount_;
+  mutable volatile uint32_t responseBytes_;
+};
+
+}  // namespace teensydmx
+}  // namespace qindesign
+
+#endif  // TEENSYDMX_SIMULATEDRECEIVEHANDLER_H_
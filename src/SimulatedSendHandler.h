@@ -0,0 +1,48 @@
+// This file is part of the TeensyDMX library.
+// (c) 2022 Shawn Silverman
+
+// SimulatedSendHandler.h defines a send handler that doesn't touch any
+// hardware. It's used by `SenderSimulator`.
+
+#ifndef TEENSYDMX_SIMULATEDSENDHANDLER_H_
+#define TEENSYDMX_SIMULATEDSENDHANDLER_H_
+
+#include "SendHandler.h"
+
+namespace qindesign {
+namespace teensydmx {
+
+// A send handler with no register access. Everything does nothing; the
+// packets are sent by `SenderSimulator` instead.
+class SimulatedSendHandler final : public SendHandler {
+ public:
+  SimulatedSendHandler(int serialIndex, Sender *sender)
+      : SendHandler(serialIndex, sender) {}
+
+  ~SimulatedSendHandler() override = default;
+
+  void start() override {}
+  void end() const override {}
+  void setIRQState(bool flag) const override {}
+
+  // Returns the default timer priority.
+  int priority() const override {
+    return 128;
+  }
+
+  void setActive() const override {}
+  void irqHandler() const override {}
+  void startBreak() const override {}
+  void startMAB() const override {}
+  void sendSerialBreak() const override {}
+
+  // There's no divisor, so this returns the given rate.
+  uint32_t actualBaud(uint32_t baud) const override {
+    return baud;
+  }
+};
+
+}  // namespace teensydmx
+}  // namespace qindesign
+
+#endif  // TEENSYDMX_SIMULATEDSENDHANDLER_H_
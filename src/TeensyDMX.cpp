@@ -11,9 +11,7 @@ extern const uint32_t kSlotsFormat = SERIAL_8N2;            // 9:2
 extern const uint32_t kBitTime     = 1000000 / kSlotsBaud;  // In microseconds
 extern const uint32_t kCharTime    = 11 * kBitTime;         // In microseconds
 
-// Returns the index given a serial port, or -1 if the serial port is
-// not supported.
-constexpr int serialIndex(const HardwareSerial &uart) {
+int TeensyDMX::serialIndex(const HardwareSerial &uart) {
 #if defined(HAS_KINETISK_UART0) || defined(HAS_KINETISL_UART0) || \
     defined(IMXRT_LPUART6)
   if (&uart == &Serial1) {
@@ -67,12 +65,31 @@ constexpr int serialIndex(const HardwareSerial &uart) {
   }
 #endif  // IMXRT_LPUART5 && (__IMXRT1052__ || ARDUINO_TEENSY41)
 
+#if defined(TEENSYDMX_HOST_BUILD)
+  // The host stand-ins, which are only used for simulation
+  const HardwareSerial *ports[]{&Serial1, &Serial2, &Serial3, &Serial4,
+                                &Serial5, &Serial6, &Serial7};
+  for (int i = 0; i < 7; i++) {
+    if (&uart == ports[i]) {
+      return i;
+    }
+  }
+#endif  // TEENSYDMX_HOST_BUILD
+
   return -1;
 }
 
+uint8_t *TeensyDMX::alignStorage(uint8_t *block) {
+  uintptr_t addr = reinterpret_cast<uintptr_t>(block);
+  return block + ((32 - (addr & 31)) & 31);
+}
+
 TeensyDMX::TeensyDMX(HardwareSerial &uart)
+    : TeensyDMX(&uart, serialIndex(uart)) {}
+
+TeensyDMX::TeensyDMX(HardwareSerial *uart, int index)
     : uart_(uart),
-      serialIndex_(serialIndex(uart_)),
+      serialIndex_(index),
       packetCount_(0) {}
 
 }  // namespace teensydmx
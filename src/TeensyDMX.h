@@ -26,8 +26,12 @@
 
 #include <HardwareSerial.h>
 
+#include "FlexIO.h"
+#include "FlexIOReceiveHandler.h"
+#include "FlexIOSendHandler.h"
 #include "LPUARTReceiveHandler.h"
 #include "LPUARTSendHandler.h"
+#include "Profiler.h"
 #include "ReceiveHandler.h"
 #include "Responder.h"
 #include "SendHandler.h"
@@ -42,9 +46,17 @@
 namespace qindesign {
 namespace teensydmx {
 
+class Repeater;
+class SenderGroup;
+
 // The maximum size of a DMX packet, including the start code.
 constexpr int kMaxDMXPacketSize = 513;
 
+// The space reserved for each packet buffer, in bytes. This rounds
+// `kMaxDMXPacketSize` up to a whole number of 32-byte cache lines so that a
+// buffer in cached memory never shares a line with anything else.
+constexpr int kPacketBufferSize = (kMaxDMXPacketSize + 31) & ~31;
+
 // The minimum size of a DMX packet, including the start code. This value is
 // used for senders and is a guideline for how many slots will fit in a packet,
 // assuming full-speed transmission and minimum BREAK and MAB times. This value
@@ -59,8 +71,17 @@ constexpr int kMinTXBreakTime = 92;
 // in microseconds.
 constexpr int kMinTXMABTime = 12;
 
+#if defined(__IMXRT1062__)
+// Identifies a Teensy 4 pin for sending or receiving DMX using FlexIO2 instead
+// of a UART. The supported pins are 6-13. For example:
+// `Sender dmxTx{FlexIOPin{10}};`
+struct FlexIOPin final {
+  int pin;
+};
+#endif  // __IMXRT1062__
+
 // TeensyDMX implements either a receiver or transmitter on one of hardware
-// serial ports 1-6.
+// serial ports 1-8, or on a Teensy 4 FlexIO2 pin.
 class TeensyDMX {
  public:
   // TeensyDMX isn't copyable but it is movable
@@ -80,12 +101,25 @@ class TeensyDMX {
   // https://github.com/isocpp/CppCoreGuidelines/blob/master/CppCoreGuidelines.md#Rc-explicit
   explicit TeensyDMX(HardwareSerial &uart);
 
+  // Creates a new DMX receiver or transmitter that isn't necessarily backed by
+  // a hardware UART. `uart` may be NULL, and `index` is the instance index, or
+  // -1 if the port is not supported.
+  TeensyDMX(HardwareSerial *uart, int index);
+
   ~TeensyDMX() = default;
 
   // https://github.com/isocpp/CppCoreGuidelines/blob/master/CppCoreGuidelines.md#Rc-zero
   // https://github.com/isocpp/CppCoreGuidelines/blob/master/CppCoreGuidelines.md#Rc-dtor-virtual
   // Don't have to define the destructor.
 
+  // Returns the index given a serial port, or -1 if the serial port is
+  // not supported.
+  static int serialIndex(const HardwareSerial &uart);
+
+  // Returns the first 32-byte boundary in the given block. The block must have
+  // 31 bytes to spare.
+  static uint8_t *alignStorage(uint8_t *block);
+
   // Increments the packet count.
   void incPacketCount() {
     packetCount_++;
@@ -96,7 +130,7 @@ class TeensyDMX {
     packetCount_ = 0;
   }
 
-  HardwareSerial &uart_;
+  HardwareSerial *uart_;  // NULL for ports that don't use a UART
   const int serialIndex_;
 
  private:
@@ -238,9 +272,181 @@ class Receiver final : public TeensyDMX {
     uint32_t longPacketCount;
   };
 
-  // Creates a new receiver and uses the given UART for communication.
+  // A fixed-size histogram of times, in microseconds. Bin `i` counts the times
+  // from `binStart + i*binWidth` up to, but not including, the start of the
+  // next bin. Times before the first bin are counted in the first bin and times
+  // past the last bin are counted in the last bin.
+  //
+  // Notes on the variables:
+  // * Count: The total number of times added.
+  // * Min and max: The smallest and largest times added. These are only valid
+  //   if the count is non-zero.
+  class Histogram final {
+   public:
+    // The number of bins.
+    static constexpr int kBinCount = 32;
+
+    // Creates an empty histogram having the given bin layout.
+    constexpr Histogram(uint32_t start, uint32_t width)
+        : binStart(start),
+          binWidth(width),
+          bins{0},
+          count(0),
+          min(0),
+          max(0) {}
+
+    ~Histogram() = default;
+
+    // Support common use of this object
+    Histogram(const Histogram &) = default;
+    Histogram(Histogram &&) = default;
+    Histogram &operator=(const Histogram &) = default;
+    Histogram &operator=(Histogram &&) = default;
+
+    // Adds a time to the histogram.
+    void add(uint32_t t);
+
+    // Clears the counts, keeping the bin layout.
+    void reset();
+
+    uint32_t binStart;  // Start of the first bin, in microseconds
+    uint32_t binWidth;  // Width of each bin, in microseconds
+    uint32_t bins[kBinCount];
+    uint32_t count;
+    uint32_t min;
+    uint32_t max;
+  };
+
+  // Distributions of the received packet timings, which are added to when each
+  // packet is completed.
+  //
+  // Notes on the variables:
+  // * BREAK and MAB times: These are only measured when there's an RX watch
+  //   pin. The bins are 8us wide starting at 64us for the BREAK and 4us wide
+  //   starting at 0us for the MAB.
+  // * BREAK to BREAK time: This is only known for consecutive packets while
+  //   connected. The bins are 1ms wide.
+  // * Packet time: From the BREAK start to the end of the last slot. The bins
+  //   are 1ms wide.
+  class TimingStats final {
+   public:
+    // Initializes all the histograms to be empty.
+    constexpr TimingStats()
+        : breakTime(64, 8),
+          mabTime(0, 4),
+          breakToBreakTime(0, 1000),
+          packetTime(0, 1000) {}
+
+    ~TimingStats() = default;
+
+    // Support common use of this object
+    TimingStats(const TimingStats &) = default;
+    TimingStats(TimingStats &&) = default;
+    TimingStats &operator=(const TimingStats &) = default;
+    TimingStats &operator=(TimingStats &&) = default;
+
+    // Clears all the histograms.
+    void reset();
+
+    Histogram breakTime;
+    Histogram mabTime;
+    Histogram breakToBreakTime;
+    Histogram packetTime;
+  };
+
+  // A read-only view of the latest completed packet, filled in by
+  // `acquireFrame`. The data isn't copied, so it's only valid until the view is
+  // released or until the next call to `acquireFrame`.
+  //
+  // Notes on the variables:
+  // * Data: Points to the packet data, starting with the start code. This will
+  //   be NULL if no view has been acquired.
+  // * Size: The packet size. This will be zero if there's no packet or if the
+  //   packet was discarded, for example if it was a short packet or if it was
+  //   eaten by a responder.
+  // * Generation: Incremented for each completed packet. Zero means that no
+  //   packet has been completed yet.
+  // * Stats: The packet statistics, as they were when the packet
+  //   was completed.
+  class FrameView final {
+   public:
+    // Initializes everything to zero.
+    constexpr FrameView()
+        : data(nullptr),
+          size(0),
+          generation(0),
+          stats() {}
+
+    ~FrameView() = default;
+
+    // Support common use of this object
+    FrameView(const FrameView &) = default;
+    FrameView(FrameView &&) = default;
+    FrameView &operator=(const FrameView &) = default;
+    FrameView &operator=(FrameView &&) = default;
+
+    const uint8_t *data;  // Packet data, including the start code
+    int size;             // Packet size
+    uint32_t generation;  // Packet generation
+    PacketStats stats;    // Packet statistics
+  };
+
+  // The number of 32-bit words needed to hold one bit for each channel. See
+  // `readChanges`.
+  static constexpr int kChangeWords = (kMaxDMXPacketSize + 31)/32;
+
+  // The largest packet history size. See `setPacketHistorySize`.
+  static constexpr int kMaxPacketHistorySize = 1024;
+
+  // The maximum number of start codes that can have a responder. See
+  // `setResponder`.
+  static constexpr int kMaxResponders = 8;
+
+  // The default packet timeout, the longest allowed BREAK plus data and
+  // BREAK-to-BREAK time, in microseconds. This is the limit from the DMX
+  // specification. See `setPacketTimeout`.
+  static constexpr uint32_t kDefaultPacketTimeout = 1250000;
+
+  // The default idle timeout, the longest allowed IDLE and MARK before BREAK
+  // (MBB) time, in microseconds, exclusive. See `setIdleTimeout`.
+  static constexpr uint32_t kDefaultIdleTimeout = 1000000;
+
+  // Storage for a receiver's three packet buffers, 32-byte aligned. See
+  // `Receiver(HardwareSerial &, Storage &)`.
+  struct Storage {
+    alignas(32) uint8_t bufs[3][kPacketBufferSize];
+  };
+
+  // Creates a new receiver and uses the given UART for communication. The
+  // packet buffers are part of the object.
   explicit Receiver(HardwareSerial &uart);
 
+  // Creates a new receiver that uses the packet buffers in the given storage
+  // instead of its own. This places the buffers in a chosen memory region, for
+  // example with `DMAMEM` on the Teensy 4, or in an arena owned by the
+  // program. The storage must stay valid for the life of the receiver and must
+  // not be shared. If it's placed on the heap by other means, it must still be
+  // 32-byte aligned for DMA to be used on the Teensy 4.
+  Receiver(HardwareSerial &uart, Storage &storage);
+
+#if defined(__IMXRT1062__)
+  // Creates a new receiver that receives on the given pin using FlexIO2. This
+  // doesn't need a UART, so it can be used for more universes than there are
+  // serial ports. Each pin uses its own FlexIO2 shifter and timer, the same
+  // ones a FlexIO sender on that pin would use, and FlexIO2 must not be used
+  // for anything else that needs these or a different clock.
+  //
+  // If the pin isn't supported then nothing will be received.
+  //
+  // There's no TX, so responders can't send responses; anything they return
+  // is dropped. DMA and the RX watch pin are not used for these.
+  explicit Receiver(const FlexIOPin &pin);
+
+  // Creates a new FlexIO receiver that keeps its packet buffers in the given
+  // storage. See `Receiver(HardwareSerial &, Storage &)`.
+  Receiver(const FlexIOPin &pin, Storage &storage);
+#endif  // __IMXRT1062__
+
   // Receiver is movable
   Receiver(Receiver &&) = default;
   Receiver &operator=(Receiver &&) = default;
@@ -280,6 +486,99 @@ class Receiver final : public TeensyDMX {
     return keepShortPackets_;
   }
 
+  // Sets whether to use DMA to receive the slots. When enabled, the slots
+  // following the start code are placed directly into the packet buffer by a
+  // DMA channel, and they are accounted for when the line goes idle or the next
+  // BREAK arrives. This removes almost all the per-slot interrupts. The timing
+  // checks are then done once for each block of slots instead of for each slot.
+  //
+  // DMA isn't used for packets whose start code has a responder, or for the
+  // rest of a packet after the line goes idle in the middle of the packet, for
+  // example if the transmitter uses a long inter-slot time. It's also not used
+  // if a DMA channel couldn't be allocated when the receiver was started.
+  // FlexIO receivers can only use it on pins 6-9, and only one of pins 6 and 7,
+  // and one of pins 8 and 9, at a time.
+  //
+  // This is currently only supported on the Teensy 4. The packet buffers may be
+  // in DTCM (RAM1) or in cached memory, such as the heap or `DMAMEM`. Buffers
+  // in cached memory must start on a 32-byte boundary, otherwise DMA isn't
+  // used, and their cache lines are maintained around each transfer. The
+  // buffers inside this object are always aligned, and so are those in a
+  // `Storage`, unless it was placed by some means that ignores its alignment.
+  //
+  // If the receiver is running and the setting changes, then this will call
+  // `end()` and then `begin()` so that the DMA channel can be allocated
+  // or released.
+  //
+  // The default is to not use DMA.
+  void setDMAEnabled(bool flag);
+
+  // Returns whether DMA was requested for receiving the slots.
+  bool isDMAEnabled() const {
+    return dmaEnabled_;
+  }
+
+  // Sets whether to track which channels change from one packet to the next.
+  // When enabled, each received packet is compared with the previous one, four
+  // bytes at a time, and the differences are accumulated until they're
+  // retrieved with `readChanges`. Enabling this clears any
+  // accumulated changes.
+  //
+  // This does nothing while a `Merger` or `USBProWidget` is using this
+  // receiver, because it keeps change tracking enabled.
+  //
+  // The default is to not track changes.
+  void setChangeTrackingEnabled(bool flag);
+
+  // Returns whether channel changes are tracked.
+  bool isChangeTrackingEnabled() const {
+    return changeTracking_;
+  }
+
+  // Retrieves and then clears the set of channels that changed since the last
+  // call to this function. Bit (c%32) of `bits[c/32]` is set if channel `c`
+  // changed. `bits` must have room for `kChangeWords` values. This returns
+  // whether any channel changed.
+  //
+  // A channel is considered changed if its value is different from the one in
+  // the previous packet, or if it was in only one of the two packets because
+  // the size changed. Discarded packets, for example short packets or ones
+  // eaten by a responder, don't count as changes, but the packet after one is
+  // compared with nothing and so all of its channels are considered changed.
+  //
+  // No changes are accumulated while change tracking is disabled. While a
+  // `Merger` or `USBProWidget` is using this receiver, the changes are theirs,
+  // so this clears `bits` and returns `false`.
+  bool readChanges(uint32_t *bits);
+
+  // How received slots are coalesced into interrupts.
+  enum class CoalescingModes {
+    kLatency,     // Keep the UART's own RX FIFO watermark
+    kThroughput,  // Raise the watermark during a packet's data
+  };
+
+  // Sets how received slots are coalesced into interrupts. In latency mode,
+  // the UART's RX FIFO watermark is left as it was set when the UART was
+  // started. In throughput mode, the watermark is kept low after a BREAK so
+  // that the start code is seen quickly, and then raised to near the FIFO depth
+  // for the rest of the packet, as long as its start code has no responder.
+  // IDLE detection catches any slots left in the FIFO at the end of a packet.
+  // This reduces the number of receive interrupts per packet. The slot
+  // timestamps are reconstructed from the FIFO count either way, so the
+  // packet statistics keep the same accuracy.
+  //
+  // This only has an effect on UARTs having an RX FIFO deeper than two slots,
+  // for example Serial1 and Serial2 on the Teensy 3.x and all the serial
+  // ports on the Teensy 4.
+  //
+  // The default is latency mode.
+  void setCoalescingMode(CoalescingModes mode);
+
+  // Returns the current coalescing mode.
+  CoalescingModes coalescingMode() const {
+    return coalescingMode_;
+  }
+
   // Reads all or part of the latest packet into buf. This returns zero if len
   // is negative or zero, or if startChannel is negative or beyond
   // `kMaxDMXPacketSize`. This only reads up to the end of the packet if
@@ -336,6 +635,32 @@ class Receiver final : public TeensyDMX {
   // been stopped.
   uint16_t get16Bit(int channel, bool *rangeError = nullptr) const;
 
+  // Fills in the view with the latest completed packet and its statistics
+  // without disabling any interrupts and without copying the packet data. This
+  // returns whether the packet is newer than the one previously described by
+  // `view`, by comparing generations. To see every packet, pass the same view
+  // object each time.
+  //
+  // The data is guaranteed not to change until `releaseFrame()` is called or
+  // until this is called again, so it can be read at leisure. Packets continue
+  // to be received in the meantime. Only one view can be held at a time; an
+  // acquired view is released when another one is acquired.
+  //
+  // This is independent of `readPacket`; neither affects what the other
+  // considers to be new.
+  //
+  // Note that this returns the latest data received, even if the receiver has
+  // been stopped.
+  //
+  // While a `Merger` or `USBProWidget` is using this receiver, the view is
+  // theirs, so this returns `false` and leaves `view` alone.
+  bool acquireFrame(FrameView &view);
+
+  // Releases the view acquired by `acquireFrame`. The view's data must not be
+  // accessed after this is called. This does nothing while a `Merger` or
+  // `USBProWidget` is using this receiver.
+  void releaseFrame();
+
   // Returns the latest packet statistics. These are reset when the receiver is
   // started or restarted.
   //
@@ -379,16 +704,30 @@ class Receiver final : public TeensyDMX {
   // Setting the responder for a start code to `nullptr` will remove any
   // previously-set responder for that start code.
   //
-  // This function dynamically allocates memory. On small systems, the memory
-  // may not be available, so it is possible that this will silently fail. To
-  // detect this condition, you can check `errno` for the `ENOMEM` condition. If
-  // this case occurs, then all responders can be considered wiped out; this
-  // includes all previously-set responders. This will return `nullptr` if this
-  // happens.
+  // At most `kMaxResponders` start codes can have a responder. Setting one
+  // more returns `nullptr` and sets `errno` to `ENOMEM`, leaving the existing
+  // responders in place.
+  //
+  // This function dynamically allocates the output buffer. On small systems,
+  // the memory may not be available, so it is possible that this will silently
+  // fail. To detect this condition, you can check `errno` for the `ENOMEM`
+  // condition. If this case occurs, then all responders can be considered
+  // wiped out; this includes all previously-set responders. This will return
+  // `nullptr` if this happens.
   //
   // Responder functions are called from an ISR.
   Responder *setResponder(uint8_t startCode, Responder *r);
 
+  // Supplies the responder output buffer instead of having `setResponder`
+  // allocate it. A NULL buffer restores allocation. With a supplied buffer,
+  // `setResponder` fails for a responder whose `outputBufferSize()` is larger
+  // than `size`, as if the allocation had failed. The buffer must stay valid
+  // while any responders are set.
+  //
+  // This returns `false` if any responders are set or if `size` is negative.
+  // Otherwise, this returns `true`.
+  bool setResponderOutputBuffer(uint8_t *buf, int size);
+
   // Sets the `setTXNotRX` implementation function. This should be called before
   // calling `begin()`.
   //
@@ -408,6 +747,37 @@ class Receiver final : public TeensyDMX {
     return rxWatchPin_;
   }
 
+  // Sets the packet timeout, in microseconds. A packet whose BREAK plus data
+  // time or BREAK-to-BREAK time is longer than this counts as a timeout, and
+  // the former also disconnects. The default is `kDefaultPacketTimeout`.
+  //
+  // Packets are cut off at this time, so it must be longer than the longest
+  // packet expected, about 23ms for 513 slots sent at full speed. Values less
+  // than the minimum packet time, 1196us, are raised to it. This can be
+  // set anytime.
+  void setPacketTimeout(uint32_t timeout);
+
+  // Returns the packet timeout, in microseconds.
+  uint32_t packetTimeout() const {
+    return packetTimeout_;
+  }
+
+  // Sets the idle timeout, in microseconds. The receiver disconnects when the
+  // line has been idle, between slots or before the next BREAK, for at least
+  // this long. The default is `kDefaultIdleTimeout`.
+  //
+  // A shorter time notices a lost transmitter sooner. With a transmitter
+  // refreshing at rate R, anything a little more than 1/R seconds works, less
+  // the packet time. Values less than two character times (88us) are raised.
+  // This can be set anytime and it takes effect the next time the line goes
+  // idle. Note that the timer is only available if a PIT is free.
+  void setIdleTimeout(uint32_t timeout);
+
+  // Returns the idle timeout, in microseconds.
+  uint32_t idleTimeout() const {
+    return idleTimeout_;
+  }
+
   // Returns whether this is considered to be connected to a DMX transmitter. A
   // connection is considered to have been broken if a timeout was detected or a
   // BREAK plus MARK after BREAK (MAB) was too short.
@@ -431,7 +801,92 @@ class Receiver final : public TeensyDMX {
   // Please refer to the `ErrorStats` docs for more information.
   ErrorStats errorStats() const;
 
+  // Enables or disables collecting packet timing histograms. Enabling this
+  // allocates memory for the histograms and clears them, and disabling it
+  // frees that memory. This returns whether the operation was successful; it
+  // will return `false` if the memory couldn't be allocated. Calling this with
+  // `true` when already enabled does nothing.
+  //
+  // The default is disabled.
+  bool setTimingStatsEnabled(bool flag);
+
+  // Returns whether packet timing histograms are being collected.
+  bool isTimingStatsEnabled() const {
+    return timingStats_ != nullptr;
+  }
+
+  // Returns a copy of the packet timing histograms. These are reset when the
+  // receiver is started or restarted. The UART interrupts are only disabled for
+  // the duration of the copy, so this is cheap enough to poll regularly. This
+  // returns empty histograms if timing stats aren't enabled.
+  //
+  // Please refer to the `TimingStats` docs for more information.
+  TimingStats timingStats() const;
+
+  // Clears the packet timing histograms.
+  void resetTimingStats();
+
+  // Sets how many of the latest `PacketStats` values to keep, one for each
+  // completed packet, including discarded ones. The size is rounded up to a
+  // power of two, and is at most `kMaxPacketHistorySize`. Setting a size of
+  // zero disables the history. This allocates
+  // memory and returns whether the operation was successful; it will return
+  // `false` if the memory couldn't be allocated, in which case the history
+  // is disabled.
+  //
+  // The default is zero.
+  bool setPacketHistorySize(int size);
+
+  // Returns the packet history size.
+  int packetHistorySize() const {
+    return historySize_;
+  }
+
+  // Reads the packet stats that have been added to the history since the last
+  // call, up to `len` of them, oldest first. The rest remain for the next call.
+  // This returns the number of stats read into `stats`.
+  //
+  // This doesn't disable any interrupts. Any entries that were overwritten
+  // before they could be read, including while they were being read, are
+  // skipped.
+  int readPacketHistory(PacketStats *stats, int len);
+
+  // Sets the function to call when a packet has been received. This can be used
+  // instead of polling `readPacket`. The function takes three arguments: a
+  // pointer to this Receiver instance, the packet data, starting with the start
+  // code, and the packet statistics, including the size.
+  //
+  // The function is called after any responder for the packet's start code has
+  // processed it, but not for packets that were discarded, for example short
+  // packets or packets eaten by a responder. The data and stats are only valid
+  // for the duration of the call; the function doesn't affect what
+  // `readPacket` considers to be new. It is called from an ISR, so it should
+  // be short.
+  //
+  // The function may be set to `nullptr`.
+  void onPacket(void (*f)(Receiver *r, const uint8_t *buf,
+                          const PacketStats &stats)) {
+    packetFunc_ = f;
+  }
+
+  // Returns whether there's a packet that hasn't yet been read by
+  // `readPacket`. This doesn't disable any interrupts, so it's cheap to poll.
+  bool isPacketAvailable() const {
+    return packetSize_ > 0;
+  }
+
+  // Returns whether a responder's response is currently being sent. No
+  // responder's `processByte` is called while this is the case.
+  bool isResponding() const {
+    return responseState_ != ResponseStates::kIdle;
+  }
+
  private:
+  // Common constructor. `uart` is NULL for a FlexIO receiver, and `index` is
+  // the instance index, or -1 if the port isn't supported. The storage is
+  // allocated if `storage` is NULL.
+  Receiver(HardwareSerial *uart, int index, Storage *storage);
+
   // State that tracks where we are in the receive process.
   enum class RecvStates {
     kBreak,     // BREAK
@@ -441,6 +896,16 @@ class Receiver final : public TeensyDMX {
     kIdle,      // The end of data for one packet has been reached
   };
 
+  // State that tracks where we are in sending a responder's response.
+  enum class ResponseStates {
+    kIdle,        // Not sending a response
+    kTurnaround,  // Waiting before enabling the transmit driver
+    kPreData,     // Waiting before sending the BREAK or the data
+    kBreak,       // BREAK
+    kMAB,         // MARK after BREAK
+    kData,        // The handler is sending the data
+  };
+
   // Interrupt lock that uses RAII to disable and enable the UART interrupts.
   class Lock final {
    public:
@@ -454,19 +919,36 @@ class Receiver final : public TeensyDMX {
 
    private:
     const Receiver &r_;
+#ifdef TEENSYDMX_ENABLE_PROFILING
+    // Measures from just before the IRQs are disabled until just after
+    // they're enabled again
+    util::ProfileScope profileScope_{ProfilePoints::kReceiverLock};
+#endif  // TEENSYDMX_ENABLE_PROFILING
   };
 
-  // The maximum allowed packet time for receivers, both BREAK plus data and
-  // BREAK to BREAK, in microseconds.
-  static constexpr uint32_t kMaxDMXPacketTime = 1250000;
-
   // The minimum allowed packet time for receivers, both BREAK plus data and
   // BREAK to BREAK, in microseconds.
   static constexpr uint32_t kMinDMXPacketTime = 1196;
 
-  // The maximum allowed IDLE and MARK before BREAK (MBB) time,
-  // in microseconds, exclusive.
-  static constexpr uint32_t kMaxDMXIdleTime = 1000000;
+  // Gives `user` the only use of the frame view and the change tracking, and
+  // enables change tracking. Only one view can be pinned and the changes are
+  // cleared when read, so they can't be shared. This returns `false` if
+  // something else is using them: another user, or the application, if it's
+  // holding a view or has enabled change tracking. Otherwise, this
+  // returns `true`.
+  bool claimFrames(const void *user);
+
+  // Releases any view held by `user`, disables change tracking, and gives the
+  // frame view and change tracking back to the application. This does nothing
+  // if `user` hasn't claimed them.
+  void unclaimFrames(const void *user);
+
+  // These are `acquireFrame`, `releaseFrame`, and `readChanges` for the user
+  // that claimed them, or for the application if `user` is NULL. They fail or
+  // do nothing if `user` isn't the current user.
+  bool acquireFrameFor(const void *user, FrameView &view);
+  void releaseFrameFor(const void *user);
+  bool readChangesFor(const void *user, uint32_t *bits);
 
   // If the flag is false, disables all the UART IRQs so that variables can be
   // accessed concurrently. Otherwise, enables all the UART IRQs.
@@ -478,6 +960,16 @@ class Receiver final : public TeensyDMX {
   // This may be called from an ISR.
   void setConnected(bool flag);
 
+  // Adds the given packet stats to any timing histograms and packet history.
+  // This is called from an ISR.
+  void recordStats(const PacketStats &stats);
+
+  // Adds the channels that differ between the two packets to the
+  // accumulated changes.
+  // This is called from an ISR.
+  void addChanges(const uint8_t *buf, int size,
+                  const uint8_t *prevBuf, int prevSize);
+
   // Does these things
   // 1. If there's data:
   //    1. Makes a new packet available and sets the packet stats, and
@@ -502,11 +994,85 @@ class Receiver final : public TeensyDMX {
   // This is called from an ISR.
   void receiveBadBreak();
 
+  // Returns the index, 0-2, of the given receive buffer.
+  int bufIndex(const uint8_t *buf) const {
+    return (buf == buf1_) ? 0 : ((buf == buf2_) ? 1 : 2);
+  }
+
   // Receives a byte. The `eopTime` parameter is the timestamp of the end of the
   // character, in microseconds.
   // This is called from an ISR.
   void receiveByte(uint8_t b, uint32_t eopTime);
 
+  // Receives a burst of bytes that were read together from the FIFO. The
+  // `eopTime` parameter is the timestamp of the end of the last character, in
+  // microseconds. Once a packet's start code has been received, the rest of
+  // the burst is validated and copied in one batch, and any responder for it
+  // is given those bytes in one `processBytes` call instead of one
+  // `processByte` call per byte. Only the bytes around a BREAK or timing
+  // problem go through `receiveByte`.
+  // This is called from an ISR.
+  void receiveBytes(const uint8_t *b, int count, uint32_t eopTime);
+
+  // Receives as many of the given bytes as possible into the current packet in
+  // one batch and passes them to any responder using `processBytes`. The
+  // `eopTime` parameter is the timestamp of the end of the first character, in
+  // microseconds. This returns the number of bytes that were used, or zero if
+  // the bytes need to be received singly instead. This is only possible in the
+  // middle of a packet, and when the timing checks pass for all the bytes.
+  // This is called from an ISR.
+  int receiveBatch(const uint8_t *b, int count, uint32_t eopTime);
+
+  // Returns whether the rest of the current packet's slots may be received in
+  // bulk, without per-slot processing. This is the case after the start code
+  // has been received, if there's no responder for it.
+  bool isBulkReceiveAllowed() const;
+
+  // Receives `count` slots that have already been placed into the active
+  // buffer, starting at the current index. The `eopTime` parameter is the
+  // timestamp of the end of the last character, in microseconds. This does the
+  // same checks as `receiveByte`, but only once for the whole block.
+  // This is called from an ISR.
+  void receiveBulk(int count, uint32_t eopTime);
+
+  // Gives any repeater the slots received so far in the current packet.
+  // This is called from an ISR.
+  void repeatSlots();
+
+  // Starts sending a response of `len` bytes from the responder output buffer,
+  // using the given responder's timings. The delays, BREAK, and MAB are timed
+  // with the response timer, and the data is sent by the receive handler using
+  // the TX interrupts, so none of this waits inside the ISR unless the timer
+  // can't be started.
+  // This is called from an ISR.
+  void startResponse(const Responder &r, int len, uint32_t eopTime);
+
+  // Moves the response to its next state. This is also the response
+  // timer callback.
+  void continueResponse();
+
+  // Waits for the given delay before continuing the response. This returns
+  // whether the response timer was started. If it wasn't then the delay has
+  // already passed by the time this returns.
+  bool waitForResponse(uint32_t delay);
+
+  // Called by the receive handler when the last response byte has been sent.
+  // This is called from an ISR.
+  void responseComplete();
+
+  // Stops any response in progress and returns to receiving.
+  void abortResponse();
+
+  // Drops the responder output buffer, freeing any allocation.
+  void releaseResponderOutBuf();
+
+  // Returns the responder for the given start code, or NULL if there isn't one.
+  Responder *findResponder(uint8_t startCode) const;
+
+  // Looks up the responder for the packet being received, if any, and caches it
+  // in `frameResponder_`.
+  void updateFrameResponder();
+
   // ISR functions.
   void rxPinFell_isr();
   void rxPinRose_isr();
@@ -537,10 +1103,18 @@ class Receiver final : public TeensyDMX {
 
   // Features
   volatile bool keepShortPackets_;
-
-  // Receive buffers
-  uint8_t buf1_[kMaxDMXPacketSize];
-  uint8_t buf2_[kMaxDMXPacketSize];
+  bool dmaEnabled_;  // Applied when starting
+  volatile bool changeTracking_;
+  volatile CoalescingModes coalescingMode_;
+
+  // Receive buffers. There are three so that a frame view can hold on to one
+  // while another is being filled and the third holds the latest packet.
+  // These point into the caller's storage or into the default storage kept
+  // in this object.
+  uint8_t storageBlock_[sizeof(Storage) + 31];  // Aligned with alignStorage()
+  uint8_t *buf1_;
+  uint8_t *buf2_;
+  uint8_t *buf3_;
   uint8_t *activeBuf_;
   // Read-only shared memory buffer, make const volatile
   // https://embeddedgurus.com/barr-code/2012/01/combining-cs-volatile-and-const-keywords/
@@ -556,6 +1130,22 @@ class Receiver final : public TeensyDMX {
   // `packetTimestamp_`, and adds other information.
   PacketStats packetStats_;
 
+  // Frame view state. The stats and generation of each buffer, indexed by
+  // `bufIndex`, are set when its packet is completed. The ISR never chooses the
+  // pinned buffer, the one held by a view, as the next active buffer.
+  PacketStats bufStats_[3];
+  uint32_t bufGenerations_[3];
+  uint32_t frameGeneration_;
+  const uint8_t *volatile pinnedBuf_;
+
+  // The `Merger` or `USBProWidget` using the frame view and change tracking,
+  // or NULL if the application may use them. See `claimFrames`.
+  const void *frameUser_;
+
+  // Channels that changed since the last `readChanges` call, one bit
+  // per channel.
+  uint32_t changes_[kChangeWords];
+
   // Current and last BREAK start times, in microseconds. The last start time is
   // zero if we can consider that there's been no prior packet, and the current
   // start time isn't set until it's confirmed that there's been a valid BREAK.
@@ -571,17 +1161,58 @@ class Receiver final : public TeensyDMX {
   // one byte of data with valid timings have been received.
   volatile bool connected_;
 
+  // Timeouts, in microseconds. See `setPacketTimeout` and `setIdleTimeout`.
+  volatile uint32_t packetTimeout_;
+  volatile uint32_t idleTimeout_;
+
   // This is called when the connection state changes.
   void (*volatile connectChangeFunc_)(Receiver *r);
 
+  // This is called when a packet has been received.
+  void (*volatile packetFunc_)(Receiver *r, const uint8_t *buf,
+                               const PacketStats &stats);
+
   // Error stats.
   ErrorStats errorStats_;
 
-  // Responders state
-  std::unique_ptr<Responder *[]> responders_;
+  // Timing histograms, allocated when enabled.
+  std::unique_ptr<TimingStats> timingStats_;
+
+  // Packet history ring. Entry `i` is at index `i & (historySize_ - 1)`. The
+  // head is the total number of entries added and the tail is the number of
+  // entries read.
+  std::unique_ptr<PacketStats[]> history_;
+  int historySize_;
+  volatile uint32_t historyHead_;
+  uint32_t historyTail_;
+
+  // Responders state. The responders are kept sorted by start code. The one
+  // for the packet being received is looked up when its start code arrives.
+  uint8_t responderStartCodes_[kMaxResponders];
+  Responder *responders_[kMaxResponders];
   int responderCount_;
-  std::unique_ptr<uint8_t[]> responderOutBuf_;
+  Responder *frameResponder_;
+
+  // The output buffer points either to the allocated block or to the caller's
+  // buffer. See `setResponderOutputBuffer`.
+  uint8_t *responderOutBuf_;
   int responderOutBufLen_;
+  std::unique_ptr<uint8_t[]> responderOutBufBlock_;
+  uint8_t *responderOutBufStorage_;
+  int responderOutBufStorageSize_;
+
+  // The repeater forwarding the received slots, if any. See `Repeater`.
+  Repeater *volatile repeater_;
+
+  // Response state. The handler sends the bytes in the responder output buffer
+  // from `responseIndex_` up to `responseLen_`.
+  volatile ResponseStates responseState_;
+  bool responseBreak_;  // Whether to send a BREAK and MAB
+  uint32_t responsePreDataDelay_;
+  uint32_t responseBreakTime_;
+  uint32_t responseMABTime_;
+  int responseLen_;
+  int responseIndex_;
 
   // Function for enabling/disabling RX and TX.
   void (*volatile setTXNotRXFunc_)(bool flag);
@@ -598,19 +1229,36 @@ class Receiver final : public TeensyDMX {
   uint32_t mabStartTime_;       // When we've seen the pin rise
   uint32_t mabEndTime_;         // When we've seen the pin fall
 
-  // Timer for tracking IDLE timeouts and for timing sending a responder BREAK.
+  // Timer for tracking IDLE timeouts.
 #ifndef TEENSYDMX_USE_PERIODICTIMER
   util::IntervalTimerEx intervalTimer_;
 #else
   util::PeriodicTimer intervalTimer_;
 #endif  // !TEENSYDMX_USE_PERIODICTIMER
 
+  // Timer for a response's delays, BREAK, and MAB. This is only running while
+  // a response is being started.
+#ifndef TEENSYDMX_USE_PERIODICTIMER
+  util::IntervalTimerEx responseTimer_;
+#else
+  util::PeriodicTimer responseTimer_;
+#endif  // !TEENSYDMX_USE_PERIODICTIMER
+
 #if defined(__IMXRT1062__) || defined(__IMXRT1052__) || defined(__MK66FX1M0__)
   friend class LPUARTReceiveHandler;
 #endif  // __IMXRT1062__ || __IMXRT1052__ || __MK66FX1M0__
 #if defined(KINETISK) || defined(KINETISL)
   friend class UARTReceiveHandler;
 #endif  // KINETISK || KINETISL
+#if defined(__IMXRT1062__)
+  friend class FlexIOReceiveHandler;
+#endif  // __IMXRT1062__
+  friend class Merger;
+  friend class RedundantReceiver;
+  friend class Repeater;
+  friend class ReceiverSimulator;
+  friend class USBProWidget;
+  friend class SimulatedReceiveHandler;
 
   // RX pin change ISRs
   friend void rxPinFellSerial0_isr();
@@ -693,6 +1341,10 @@ class Receiver final : public TeensyDMX {
     (defined(__IMXRT1052__) || defined(ARDUINO_TEENSY41))
   friend void lpuart5_rx_isr();
 #endif  // IMXRT_LPUART5 && (__IMXRT1052__ || ARDUINO_TEENSY41)
+
+#if defined(__IMXRT1062__)
+  friend void flexio2_rx_isr();
+#endif  // __IMXRT1062__
 };
 
 // ---------------------------------------------------------------------------
@@ -702,9 +1354,117 @@ class Receiver final : public TeensyDMX {
 // A DMX transmitter. This sends packets asynchronously.
 class Sender final : public TeensyDMX {
  public:
-  // Creates a new transmitter and uses the given UART for communication.
+  // The default number of packets between forced full-size packets when
+  // adaptive packet sizes are enabled. See `setAdaptivePacketSize`.
+  static constexpr int kDefaultFullSizeInterval = 50;
+
+  // Storage for a sender's three packet buffers, 32-byte aligned. See
+  // `Sender(HardwareSerial &, Storage &)`.
+  struct Storage {
+    alignas(32) volatile uint8_t bufs[3][kPacketBufferSize];
+  };
+
+  // What was actually sent, as opposed to what was configured. These are
+  // updated from the ISRs and reset when the transmitter is started.
+  //
+  // Notes on the variables:
+  // * BREAK to BREAK time: Measured between consecutive BREAKs. The time across
+  //   a pause isn't included. The target is the configured time from the
+  //   refresh rate; zero means as fast as possible and `UINT32_MAX` means
+  //   nothing is sent.
+  // * BREAK and MAB times: From the last packet. When a timer generates these,
+  //   they're measured. When the BREAK serial parameters are used, they're the
+  //   times the serial format produces, and only the sum is measured.
+  // * Timer failures: The number of times a timer couldn't be started. When
+  //   this happens, the BREAK falls back to the serial parameters, the MAB is
+  //   cut short, and the refresh rate delay and the inter-slot time are
+  //   skipped.
+  // * Frame counts: The number of packets sent having a BREAK generated by a
+  //   timer or by the serial parameters, and the number whose slots were sent
+  //   using DMA.
+  class Stats final {
+   public:
+    // Initializes everything to zero.
+    constexpr Stats()
+        : breakToBreakCount(0),
+          breakToBreakMin(0),
+          breakToBreakMax(0),
+          breakToBreakSum(0),
+          targetBreakToBreakTime(0),
+          breakTime(0),
+          mabTime(0),
+          breakPlusMABTime(0),
+          breakTimerFailures(0),
+          mabTimerFailures(0),
+          rateTimerFailures(0),
+          interSlotTimerFailures(0),
+          timerBreakFrames(0),
+          serialBreakFrames(0),
+          dmaFrames(0) {}
+
+    ~Stats() = default;
+
+    // Support common use of this object
+    Stats(const Stats &) = default;
+    Stats(Stats &&) = default;
+    Stats &operator=(const Stats &) = default;
+    Stats &operator=(Stats &&) = default;
+
+    // Returns the mean BREAK to BREAK time, in microseconds, or zero if none
+    // has been measured.
+    uint32_t breakToBreakMean() const {
+      if (breakToBreakCount == 0) {
+        return 0;
+      }
+      return static_cast<uint32_t>(breakToBreakSum / breakToBreakCount);
+    }
+
+    uint32_t breakToBreakCount;       // Number of times measured
+    uint32_t breakToBreakMin;         // In microseconds
+    uint32_t breakToBreakMax;         // In microseconds
+    uint64_t breakToBreakSum;         // In microseconds
+    uint32_t targetBreakToBreakTime;  // In microseconds
+
+    uint32_t breakTime;         // In microseconds
+    uint32_t mabTime;           // In microseconds
+    uint32_t breakPlusMABTime;  // In microseconds
+
+    uint32_t breakTimerFailures;      // Fell back to the serial parameters
+    uint32_t mabTimerFailures;        // MAB was cut short
+    uint32_t rateTimerFailures;       // Sent without the refresh rate delay
+    uint32_t interSlotTimerFailures;  // Sent a slot without the pause
+
+    uint32_t timerBreakFrames;
+    uint32_t serialBreakFrames;
+    uint32_t dmaFrames;
+  };
+
+  // Creates a new transmitter and uses the given UART for communication. The
+  // packet buffers are part of the object.
   explicit Sender(HardwareSerial &uart);
 
+  // Creates a new transmitter that uses the packet buffers in the given
+  // storage instead of its own, for example to place them in a specific memory
+  // region with `DMAMEM` on the Teensy 4. The storage must stay valid for the
+  // life of the sender and must not be shared.
+  Sender(HardwareSerial &uart, Storage &storage);
+
+#if defined(__IMXRT1062__)
+  // Creates a new transmitter that sends on the given pin using FlexIO2. This
+  // doesn't need a UART, so it can be used for more universes than there are
+  // serial ports. Each pin uses its own FlexIO2 shifter and timer, and FlexIO2
+  // must not be used for anything else that needs these or a different clock.
+  //
+  // If the pin isn't supported then nothing will be sent.
+  //
+  // DMA is not used for these, even if enabled with `setDMAEnabled`.
+  explicit Sender(const FlexIOPin &pin);
+
+  // Creates a new FlexIO transmitter that keeps its packet buffers in the
+  // given storage. See `Sender(HardwareSerial &, Storage &)`.
+  Sender(const FlexIOPin &pin, Storage &storage);
+#endif  // __IMXRT1062__
+
   // Sender is movable
   Sender(Sender &&) = default;
   Sender &operator=(Sender &&) = default;
@@ -788,6 +1548,23 @@ class Sender final : public TeensyDMX {
   // and 20us MAB.
   bool setBreakSerialParams(uint32_t baud, uint32_t format);
 
+  // Chooses and sets the BREAK/MAB serial port parameters that produce BREAK
+  // and MAB times as close as possible to, but not shorter than, the given
+  // times, in microseconds. Like `setBreakSerialParams`, the parameters are
+  // only applied when the transmitter is started or restarted. This also
+  // switches to using serial parameters instead of a timer; see
+  // `setBreakUseTimerNotSerial`.
+  //
+  // This only chooses the parameters; the BREAK and MAB are then generated as
+  // with `setBreakSerialParams`. Since the BREAK and MAB are a whole number of
+  // bits at the same baud rate, and the UART can only approximate that rate,
+  // not every combination can be matched exactly; use `breakTime()` and
+  // `mabTime()` to see the chosen times. These account for the UART's divisor.
+  //
+  // This returns `false` if either time is zero or if no parameters could be
+  // found. Nothing is changed in that case.
+  bool setBreakSerialParamsFromTimes(uint32_t breakTime, uint32_t mabTime);
+
   // Returns the currently-set BREAK baud rate.
   uint32_t breakSerialBaud() const {
     return breakBaud_;
@@ -817,6 +1594,11 @@ class Sender final : public TeensyDMX {
   //
   // Due to some system timing, the actual time may be longer.
   //
+  // A FlexIO sender shifts times up to 92us out as part of each slot, rounded
+  // up to a whole number of 4us bit times, and doesn't need a timer for them.
+  // A UART sender can do the same for times up to 44us with idle characters.
+  // See `setInterSlotIdleCharsEnabled`.
+  //
   // The default is zero.
   void setInterSlotTime(uint32_t t);
 
@@ -824,9 +1606,75 @@ class Sender final : public TeensyDMX {
   // likely be larger than the return value due to some UART intricacies.
   uint32_t interSlotTime() const;
 
+  // Sets whether a UART sender fills inter-slot MARK times of up to 44us, one
+  // slot time, with a queued idle character instead of using a timer. Each
+  // such gap is then exactly 44us, even for shorter times, but it doesn't
+  // take a timer or its interrupts. Longer times still use a timer.
+  //
+  // A FlexIO sender doesn't need this because it sends the gaps as part of
+  // each slot.
+  //
+  // The default is to use a timer.
+  void setInterSlotIdleCharsEnabled(bool flag) {
+    interSlotIdleChars_ = flag;
+  }
+
+  // Returns whether a UART sender may fill inter-slot MARK times with
+  // idle characters.
+  bool isInterSlotIdleCharsEnabled() const {
+    return interSlotIdleChars_;
+  }
+
+  // Sets whether to use DMA to transmit the slots. When enabled, the start code
+  // and slots are streamed to the UART by a DMA channel, and only the end of
+  // the packet causes an interrupt. The BREAK and MAB are generated the same
+  // way as without DMA.
+  //
+  // DMA is only used when the inter-slot time is zero. If a DMA channel could
+  // not be allocated when the transmitter was started, or if the chip does not
+  // support this feature (Teensy LC), then the slots are sent using interrupts.
+  //
+  // If the transmitter is running and the setting changes, then this will call
+  // `end()` and then `begin()` so that the DMA channel can be allocated
+  // or released.
+  //
+  // The default is to not use DMA.
+  void setDMAEnabled(bool flag);
+
+  // Returns whether DMA was requested for transmitting the slots.
+  bool isDMAEnabled() const {
+    return dmaEnabled_;
+  }
+
+  // Opens a frame. Until the frame is committed with `commitFrame()`, all
+  // channel and packet size changes go to a separate staging buffer instead of
+  // to the data being sent, and they don't disable any interrupts. The staging
+  // buffer starts out holding the latest data and packet size.
+  //
+  // This is useful for updating many channels at once: none of the changes are
+  // sent until all of them are committed together, so a packet never contains
+  // a partially-updated frame.
+  //
+  // This does nothing if a frame is already open.
+  void beginFrame();
+
+  // Atomically makes the open frame the data to send, starting with the packet
+  // after the current one. This doesn't copy the data. This returns `false` if
+  // there's no open frame, and `true` otherwise.
+  bool commitFrame();
+
+  // Discards the open frame, if any. The data to send is unchanged.
+  void abortFrame() {
+    frameOpen_ = false;
+  }
+
+  // Returns whether a frame is open. See `beginFrame()`.
+  bool isFrameOpen() const {
+    return frameOpen_;
+  }
+
   // Atomically sets the packet size and data. This function is useful because
-  // the library operates asynchronously. Note that this does not grab the lock
-  // if the new packet size is the same as the current packet size.
+  // the library operates asynchronously.
   //
   // See the `setPacketSize` and `set` functions for more information.
   bool setPacketSizeAndData(int size,
@@ -853,9 +1701,30 @@ class Sender final : public TeensyDMX {
   // The default size is 513.
   bool setPacketSize(int size);
 
-  // Returns the current packet size.
+  // Returns the current packet size. If a frame is open then this returns the
+  // frame's packet size.
   int packetSize() const {
-    return activePacketSize_;
+    return frameOpen_ ? stagingPacketSize_ : activePacketSize_;
+  }
+
+  // Sets whether to send packets that are only as large as the data needs.
+  // When enabled, each packet only goes up to the highest channel that's ever
+  // been set to a non-zero value, but no further than the packet size. It's
+  // padded so that the BREAK-to-BREAK time, including the MBB, isn't less than
+  // 1204us. Channels that have always been zero don't need to be sent, so
+  // smaller packets can be sent more often without any manual tuning.
+  //
+  // A full-size packet is still sent every `fullSizeInterval` packets so that
+  // newly connected or re-patched receivers see every channel. A value of zero
+  // or less means full-size packets are never forced.
+  //
+  // The default is to always send the full packet size.
+  void setAdaptivePacketSize(bool flag,
+                             int fullSizeInterval = kDefaultFullSizeInterval);
+
+  // Returns whether adaptive packet sizes are enabled.
+  bool isAdaptivePacketSize() const {
+    return adaptivePacketSize_;
   }
 
   // Sets a channel's value. Channel zero represents the start code. The start
@@ -874,6 +1743,13 @@ class Sender final : public TeensyDMX {
   // range 25-512, then the value will be set internally but will not be
   // transmitted until the packet size changes via `setPacketSize`.
   //
+  // The first change after a packet has picked up new data first copies all
+  // 513 channels into the buffer being modified, with the transmitter's
+  // interrupt disabled. Later changes before the next packet don't copy
+  // anything. This applies to all the functions that modify the data except
+  // `clear()`, which replaces the whole buffer. An open frame is modified
+  // without any copy or lock; its copy is made by `beginFrame()`.
+  //
   // After pausing with `pause()`, it is necessary to wait until transmission is
   // finished before setting channel values.
   bool set(int channel, uint8_t value);
@@ -930,6 +1806,8 @@ class Sender final : public TeensyDMX {
   // This returns `false` if any part of the channel range is not in the range
   // 0-512, or if the length is negative. Otherwise, this returns `true`. The
   // upper limit is equal to `kDMXMaxPacketSize-1`.
+  //
+  // See `set` for the copy that the first change after a packet makes.
   bool fill(int startChannel, int len, uint8_t value);
 
   // Sets the MBB time, in microseconds. If a timer is unavailable then no MBB
@@ -1016,8 +1894,8 @@ class Sender final : public TeensyDMX {
 
   // Resumes sending, but pauses again after the specified number of packets are
   // sent. A value of zero will resume. This will return `false` for values < 0
-  // and `true` for all other values. In other words, this will return `true`
-  // when sending is resumed.
+  // or while a `Repeater` is using this sender, and `true` otherwise. In other
+  // words, this will return `true` when sending is resumed.
   //
   // If sending is not already paused, only the next n packets will be sent, not
   // including any already in transmission.
@@ -1032,8 +1910,8 @@ class Sender final : public TeensyDMX {
 
   // Resumes sending, but pauses again after the specified number of packets are
   // sent. A value of zero will resume. This will return `false` for values < 0
-  // and `true` for all other values. In other words, this will return `true`
-  // when sending is resumed.
+  // or while a `Repeater` is using this sender, and `true` otherwise. In other
+  // words, this will return `true` when sending is resumed.
   //
   // If sending is not already paused, only the next n packets will be sent, not
   // including any already in transmission.
@@ -1075,7 +1953,73 @@ class Sender final : public TeensyDMX {
     doneTXFunc_ = f;
   }
 
+  // Returns the output statistics. These are reset when the transmitter is
+  // started or restarted. Please refer to the `Stats` docs for
+  // more information.
+  Stats stats() const;
+
+  // Resets the output statistics.
+  void resetStats();
+
+  // A pre-rendered frame for playback. See `startPlayback`.
+  struct PlaybackFrame {
+    const uint8_t *data;  // The start code and slots
+    int size;             // Packet size, 1-513
+    uint32_t count;       // Number of packets to send
+    uint32_t duration;    // How long to send, in microseconds; zero means
+                          // use the count instead
+  };
+
+  // Starts playing frames from the given ring of `capacity` entries, owned by
+  // the caller. Queued frames are sent in order, starting with the packet after
+  // the current one. Each frame is sent until either its duration has passed
+  // or, if the duration is zero, until it has been sent `count` times. The
+  // frame is then replaced at the next packet boundary by pointing the
+  // transmitter at the next frame's data, without any copying and without
+  // the application needing to do anything.
+  //
+  // If no frame is queued when the current one is done, then the current one
+  // keeps being sent. If no frame has been queued yet, then the regular data
+  // is sent. The regular data can still be modified during playback, and it's
+  // sent again after playback stops.
+  //
+  // This returns `false` if playback is already running, if a `Repeater` is
+  // using this sender, or if the ring is NULL or its capacity is not positive.
+  // Otherwise, this returns `true`.
+  bool startPlayback(PlaybackFrame *ring, int capacity);
+
+  // Stops playback. The regular data is sent starting with the next packet.
+  // Until `isPlaying()` returns `false`, the ring and the frame data may still
+  // be in use. This does nothing if playback isn't running.
+  void stopPlayback();
+
+  // Returns whether playback is running, including while it's stopping.
+  bool isPlaying() const {
+    return playbackRing_ != nullptr;
+  }
+
+  // Adds a frame to the end of the playback queue. The frame's data must stay
+  // valid until the frame has been replaced. This returns `false` if playback
+  // isn't running, if the queue is full, or if the frame is invalid.
+  // Otherwise, this returns `true`. This may be called from the low-water
+  // function.
+  bool queueFrame(const PlaybackFrame &f);
+
+  // Returns the number of queued frames that haven't been started yet.
+  int queuedFrames() const;
+
+  // Sets a function that's called when a frame is started and the number of
+  // queued frames left is at or below `lowWater`. This is a good place to
+  // queue more frames. It is called from an ISR.
+  //
+  // The function may be set to `nullptr`.
+  void onPlaybackLow(int lowWater, void (*f)(Sender *s));
+
  private:
+  // Common constructor. `uart` may be NULL if the port doesn't use a UART.
+  // The storage is allocated if `storage` is NULL.
+  Sender(HardwareSerial *uart, int index, Storage *storage);
+
   // State that tracks what to transmit and when.
   enum class XmitStates {
     kBreak,      // Need to transmit a BREAK
@@ -1098,6 +2042,59 @@ class Sender final : public TeensyDMX {
 
    private:
     const Sender &s_;
+#ifdef TEENSYDMX_ENABLE_PROFILING
+    // Measures from just before the IRQs are disabled until just after
+    // they're enabled again
+    util::ProfileScope profileScope_{ProfilePoints::kSenderLock};
+#endif  // TEENSYDMX_ENABLE_PROFILING
+  };
+
+  // Gives access to the buffer that the API modifies. If a frame is open then
+  // this is the staging buffer and nothing is locked. Otherwise, this takes the
+  // lock, using RAII, and prepares the active buffer for modification. See
+  // `prepareActiveBuf` for the meaning of `overwrite`.
+  class WriteAccess final {
+   public:
+    explicit WriteAccess(Sender &s, bool overwrite = false)
+        : s_(s),
+          locked_(!s.frameOpen_) {
+      if (locked_) {
+        s_.setIRQState(false);
+        s_.prepareActiveBuf(overwrite);
+        buf_ = s_.activeBuf_;
+      } else {
+        buf_ = s_.stagingBuf_;
+      }
+    }
+
+    ~WriteAccess() {
+      if (locked_) {
+        s_.setIRQState(true);
+      }
+    }
+
+    // Returns the buffer to modify.
+    volatile uint8_t *buf() const {
+      return buf_;
+    }
+
+    // Sets the packet size that goes with the buffer.
+    void setPacketSize(int size) const {
+      if (locked_) {
+        s_.activePacketSize_ = size;
+      } else {
+        s_.stagingPacketSize_ = size;
+      }
+    }
+
+   private:
+    Sender &s_;
+    bool locked_;
+#ifdef TEENSYDMX_ENABLE_PROFILING
+    // Measures the locked case the same way as `Lock`
+    util::ProfileScope profileScope_{ProfilePoints::kSenderLock, locked_};
+#endif  // TEENSYDMX_ENABLE_PROFILING
+    volatile uint8_t *buf_;
   };
 
   std::unique_ptr<SendHandler> sendHandler_;
@@ -1106,17 +2103,120 @@ class Sender final : public TeensyDMX {
   // or BREAK to BREAK, in microseconds.
   static constexpr uint32_t kMinDMXPacketTime = 1204;
 
+  // The time to send one slot, in microseconds.
+  static constexpr uint32_t kSlotTime = 44;
+
+  // Returns whether the inter-slot MARK time is to be sent as a queued idle
+  // character, one slot time long, instead of with a timer.
+  bool useInterSlotIdleChars() const {
+    uint32_t t = interSlotTime_;
+    return interSlotIdleChars_ && 0 < t && t <= kSlotTime;
+  }
+
   // If the flag is false, disables all the UART IRQs so that variables can be
   // accessed concurrently. Otherwise, enables all the UART IRQs.
   //
   // This does nothing if `began_` is `false`.
   void setIRQState(bool flag) const;
 
-  // Completes a sent packet. This increments the packet count, resets the
-  // output buffer index, and sets the state to `kIdle`.
+  // Completes a sent packet. This makes any changed data available for the
+  // next packet, increments the packet count, resets the output buffer index,
+  // and sets the state to `kIdle`.
+  //
+  // With a repeater, the packet isn't complete until all its slots have been
+  // received. This returns `false` if the handler needs to wait for more
+  // slots, in which case nothing is changed. Otherwise, this returns `true`.
   //
   // This is called from an ISR.
-  void completePacket();
+  bool completePacket();
+
+  // Gets the number of bit times in the BREAK and in the MAB that the BREAK
+  // serial format produces when sending a zero. This returns `false` if the
+  // format isn't known.
+  bool breakSerialBits(uint32_t *breakBits, uint32_t *mabBits) const;
+
+  // Returns the baud rate the UART actually produces for the given BREAK baud
+  // rate, after its divisor has been rounded.
+  uint32_t actualBreakBaud(uint32_t baud) const;
+
+  // Notes that a BREAK started at time `t`, in microseconds, and whether it's
+  // generated by a timer. This also measures the BREAK to BREAK time.
+  //
+  // This is called from an ISR.
+  void breakStarted(uint32_t t, bool timer);
+
+  // Notes that a timer-generated MAB started at time `t`, in microseconds.
+  void mabStarted(uint32_t t) {
+    mabStartTime_ = t;
+  }
+
+  // Notes that the MAB ended at time `t`, in microseconds, and measures the
+  // BREAK and MAB.
+  //
+  // This is called from an ISR.
+  void slotsStarted(uint32_t t);
+
+  // Moves playback to the next packet, and to the next frame if the current
+  // one is done. This returns whether playback supplies the next packet's data
+  // and size. Otherwise, the regular data is used.
+  //
+  // This is called from an ISR.
+  bool advancePlayback();
+
+  // Returns the size of the next packet, from the packet size and, when
+  // enabled, the adaptive size.
+  //
+  // This is called from an ISR or with the lock held.
+  int nextPacketSize();
+
+  // Opens a frame like `beginFrame()`, but without copying the latest data
+  // into the staging buffer, for when the whole packet is about to be written
+  // there directly. An already open frame is kept as it is. This returns the
+  // staging buffer.
+  volatile uint8_t *beginFrameForOverwrite();
+
+  // Commits the open frame after its first `size` slots were written directly
+  // to the staging buffer. This sets the frame's packet size and notes the
+  // slots for adaptive packet sizes. This returns `false` if there's no open
+  // frame or if the size is outside the range 1-513. Otherwise, this
+  // returns `true`.
+  bool commitWrittenFrame(int size);
+
+  // Notes that a channel has been set to a non-zero value, for adaptive
+  // packet sizes.
+  void markChannel(int channel) {
+    if (channel >= dataSize_) {
+      dataSize_ = channel + 1;
+    }
+  }
+
+  // Marks the highest non-zero value in the given range. See `markChannel`.
+  void markChannels(int startChannel, const volatile uint8_t *values, int len);
+
+  // Makes the active buffer the one that's transmitted, but only if it was
+  // changed. Otherwise, the same data is sent again without any copying.
+  //
+  // This is called from an ISR or with the lock held.
+  void swapBuffersIfChanged();
+
+  // Prepares the active buffer for modification and marks it as changed. If
+  // the buffers were swapped since the last modification then this first
+  // brings the active buffer up to date with the transmitted data, unless
+  // `overwrite` is `true`, meaning that the whole buffer is about to
+  // be replaced.
+  //
+  // This must be called with the lock held.
+  void prepareActiveBuf(bool overwrite = false);
+
+  // Returns the buffer holding the application data that was last made
+  // available for sending. This is the inactive buffer, or the saved one if
+  // playback or a repeater has replaced it.
+  //
+  // This must be called with the lock held.
+  const volatile uint8_t *latestSentBuf() const {
+    const volatile uint8_t *buf = savedInactiveBuf_;
+    return (buf != nullptr) ? buf : inactiveBuf_;
+  }
 
   // Tracks whether the system has been configured.
   volatile bool began_;
@@ -1124,10 +2224,34 @@ class Sender final : public TeensyDMX {
   // Keeps track of what we're transmitting.
   volatile XmitStates state_;
 
-  // Output buffers
-  volatile uint8_t activeBuf_[kMaxDMXPacketSize];
-  volatile uint8_t inactiveBuf_[kMaxDMXPacketSize];
+  // Output buffers. The API modifies the active buffer and the ISRs transmit
+  // the inactive buffer. The two are swapped at the end of a packet only if
+  // the active buffer was changed. After a swap, the active buffer is stale
+  // and is updated from the inactive buffer just before it's next modified.
+  // The buffers point into the caller's storage or into the default storage
+  // kept in this object.
+  uint8_t storageBlock_[sizeof(Storage) + 31];  // Aligned with alignStorage()
+  volatile uint8_t *buf1_;
+  volatile uint8_t *buf2_;
+  volatile uint8_t *volatile activeBuf_;
+  volatile uint8_t *volatile inactiveBuf_;
   volatile int inactiveBufIndex_;
+  volatile bool activeBufChanged_;
+  volatile bool activeBufStale_;
+
+  // The regular inactive buffer while playback or a repeater has replaced it
+  // with its own data, and NULL otherwise. This is where a stale active buffer
+  // gets its data from in the meantime, so that the application's data isn't
+  // mixed with the replacement. See `latestSentBuf`.
+  volatile uint8_t *volatile savedInactiveBuf_;
+
+  // Frame staging. When a frame is open, the API modifies the staging buffer
+  // instead of the active buffer, and the two are swapped when the frame
+  // is committed.
+  volatile uint8_t *buf3_;
+  volatile uint8_t *stagingBuf_;
+  int stagingPacketSize_;
+  bool frameOpen_;
 
   // BREAK and MAB times
 #ifndef TEENSYDMX_USE_PERIODICTIMER
@@ -1152,11 +2276,23 @@ class Sender final : public TeensyDMX {
   // MARK time between slots
   volatile uint32_t interSlotTime_;
   volatile uint32_t adjustedInterSlotTime_;
+  volatile bool interSlotIdleChars_;  // Whether to use idle characters for
+                                     // short inter-slot times
+
+  // Whether to use DMA for the slots; applied when starting
+  bool dmaEnabled_;
 
   // The size of the packet to be sent.
   volatile int activePacketSize_;
   volatile int inactivePacketSize_;
 
+  // Adaptive packet sizes. The data size only grows; it's one more than the
+  // highest channel that's been set to a non-zero value.
+  volatile bool adaptivePacketSize_;
+  volatile int fullSizeInterval_;
+  volatile int dataSize_;
+  int packetsSinceFullSize_;
+
   // MBB
   volatile uint32_t mbbTime_;
   volatile uint32_t adjustedMBBTime_;
@@ -1186,12 +2322,50 @@ class Sender final : public TeensyDMX {
   // This is called when we are done transmitting after a `resumeFor` call.
   void (*volatile doneTXFunc_)(Sender *s);
 
+  // The group generating the BREAK and MAB, if any, and whether this is waiting
+  // for the group to start the next one. See `SenderGroup`.
+  SenderGroup *volatile group_;
+  volatile bool groupWaiting_;
+
+  // The repeater supplying the packets, if any. See `Repeater`.
+  Repeater *volatile repeater_;
+
+  // Playback. The head and tail count the started and queued frames, so the
+  // pending frames are the ones in between. While a frame is current, its ring
+  // entry is still in use.
+  PlaybackFrame *volatile playbackRing_;
+  int playbackCapacity_;
+  volatile uint32_t playbackHead_;
+  volatile uint32_t playbackTail_;
+  volatile bool playbackCurrent_;
+  volatile bool playbackStopping_;
+  uint32_t playbackSent_;       // Packets sent of the current frame
+  uint32_t playbackStartTime_;  // When the current frame started, in us
+  volatile int playbackLowWater_;
+  void (*volatile playbackLowFunc_)(Sender *s);
+
+  // Output statistics, and the current packet's part in them
+  Stats stats_;
+  uint32_t mabStartTime_;
+  bool breakStartValid_;  // Whether the last BREAK can start a measurement
+  bool frameTimerBreak_;  // Whether the BREAK is generated by a timer
+  bool frameDMA_;         // Whether the slots are sent using DMA
+
+  friend class Merger;
+  friend class Repeater;
+  friend class SenderGroup;
+  friend class SenderSimulator;
+  friend class USBProWidget;
+
 #if defined(__IMXRT1062__) || defined(__IMXRT1052__) || defined(__MK66FX1M0__)
   friend class LPUARTSendHandler;
 #endif  // __IMXRT1062__ || __IMXRT1052__ || __MK66FX1M0__
 #if defined(KINETISK) || defined(KINETISL)
   friend class UARTSendHandler;
 #endif  // KINETISK || KINETISL
+#if defined(__IMXRT1062__)
+  friend class FlexIOSendHandler;
+#endif  // __IMXRT1062__
 
   // These error ISRs need to access private functions
 #if defined(HAS_KINETISK_UART0) || defined(HAS_KINETISL_UART0)
@@ -1254,6 +2428,10 @@ class Sender final : public TeensyDMX {
     (defined(__IMXRT1052__) || defined(ARDUINO_TEENSY41))
   friend void lpuart5_tx_isr();
 #endif  // IMXRT_LPUART5 && (__IMXRT1052__ || ARDUINO_TEENSY41)
+
+#if defined(__IMXRT1062__)
+  friend void flexio2_tx_isr();
+#endif  // __IMXRT1062__
 };
 
 }  // namespace teensydmx
@@ -0,0 +1,115 @@
+// UARTPort.h describes the Kinetis UARTs for the handlers' interrupt routines.
+// This file is part of the TeensyDMX library.
+// (c) 2022 Shawn Silverman
+
+#if defined(__MK20DX128__) || defined(__MK20DX256__) || \
+    defined(__MKL26Z64__) || defined(__MK64FX512__) || defined(__MK66FX1M0__)
+
+#ifndef TEENSYDMX_UARTPORT_H_
+#define TEENSYDMX_UARTPORT_H_
+
+// C++ includes
+#include <cstdint>
+
+#include <kinetis.h>
+
+namespace qindesign {
+namespace teensydmx {
+
+// A UART port, as used by the UART handlers' interrupt routines. A port
+// provides these:
+// * `regs()`: the UART registers,
+// * `index()`: the serial port index,
+// * `rxFIFOSize()` and `txFIFOSize()`: the FIFO depths.
+//
+// Each port's ISR uses its own `UARTPort`, where all of these are compile-time
+// constants. The register addresses don't have to be reloaded after each 8-bit
+// register write, which could alias them, and FIFO code that the port can't
+// use is removed. Everything else uses a `DynamicUARTPort`, with the values
+// known to the handler at run time.
+
+// A UART known at compile time, where `N` is the serial port index. Only the
+// ports that the chip has are defined.
+template <int N>
+struct UARTPort;
+
+// A UART known only at run time.
+struct DynamicUARTPort final {
+  KINETISK_UART_t *port;
+  int serialIndex;
+  uint8_t rxFIFO;
+  uint8_t txFIFO;
+
+  KINETISK_UART_t &regs() const {
+    return *port;
+  }
+
+  int index() const {
+    return serialIndex;
+  }
+
+  uint8_t rxFIFOSize() const {
+    return rxFIFO;
+  }
+
+  uint8_t txFIFOSize() const {
+    return txFIFO;
+  }
+};
+
+// Defines a `UARTPort` for the given index and FIFO depth. The RX and TX FIFOs
+// have the same depth.
+#define TEENSYDMX_DEFINE_UART_PORT(n, fifoSize)        \
+  template <>                                          \
+  struct UARTPort<n> final {                           \
+    static KINETISK_UART_t &regs() {                   \
+      return KINETISK_UART##n;                         \
+    }                                                  \
+    static constexpr int index() {                     \
+      return n;                                        \
+    }                                                  \
+    static constexpr uint8_t rxFIFOSize() {            \
+      return fifoSize;                                 \
+    }                                                  \
+    static constexpr uint8_t txFIFOSize() {            \
+      return fifoSize;                                 \
+    }                                                  \
+  }
+
+#if defined(HAS_KINETISK_UART0_FIFO)
+TEENSYDMX_DEFINE_UART_PORT(0, 8);
+#elif defined(HAS_KINETISK_UART0) || defined(HAS_KINETISL_UART0)
+TEENSYDMX_DEFINE_UART_PORT(0, 1);
+#endif  // HAS_KINETISK_UART0_FIFO
+
+#if defined(HAS_KINETISK_UART1_FIFO)
+TEENSYDMX_DEFINE_UART_PORT(1, 8);
+#elif defined(HAS_KINETISK_UART1) || defined(HAS_KINETISL_UART1)
+TEENSYDMX_DEFINE_UART_PORT(1, 1);
+#endif  // HAS_KINETISK_UART1_FIFO
+
+#if defined(HAS_KINETISK_UART2) || defined(HAS_KINETISL_UART2)
+TEENSYDMX_DEFINE_UART_PORT(2, 1);
+#endif  // HAS_KINETISK_UART2 || HAS_KINETISL_UART2
+
+#if defined(HAS_KINETISK_UART3)
+TEENSYDMX_DEFINE_UART_PORT(3, 1);
+#endif  // HAS_KINETISK_UART3
+
+#if defined(HAS_KINETISK_UART4)
+TEENSYDMX_DEFINE_UART_PORT(4, 1);
+#endif  // HAS_KINETISK_UART4
+
+#if defined(HAS_KINETISK_UART5)
+TEENSYDMX_DEFINE_UART_PORT(5, 1);
+#endif  // HAS_KINETISK_UART5
+
+#undef TEENSYDMX_DEFINE_UART_PORT
+
+}  // namespace teensydmx
+}  // namespace qindesign
+
+#endif  // TEENSYDMX_UARTPORT_H_
+
+#endif  // __MK20DX128__ || __MK20DX256__ || __MKL26Z64__ || __MK64FX512__ ||
+        // __MK66FX1M0__
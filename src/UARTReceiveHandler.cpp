@@ -6,6 +6,9 @@
 
 #include "UARTReceiveHandler.h"
 
+// C++ includes
+#include <algorithm>
+
 #include <core_pins.h>
 #include <util/atomic.h>
 
@@ -20,7 +23,7 @@ extern const uint32_t kSlotsFormat;
 extern const uint32_t kCharTime;  // In microseconds
 
 void UARTReceiveHandler::start() {
-  receiver_->uart_.begin(kSlotsBaud, kSlotsFormat);
+  receiver_->uart_->begin(kSlotsBaud, kSlotsFormat);
 
 #if defined(KINETISK)
   // Calculate the FIFO sizes now that the peripheral has been enabled and we can
@@ -42,6 +45,7 @@ void UARTReceiveHandler::start() {
 
     fifoSizesSet_ = true;
   }
+  rxWatermark_ = port_->RWFIFO;
 #endif  // KINETISK
 
   // Enable receive
@@ -70,7 +74,7 @@ void UARTReceiveHandler::start() {
 #undef UART_C2_RX_ENABLE
 
 void UARTReceiveHandler::end() const {
-  receiver_->uart_.end();
+  receiver_->uart_->end();
 
 #if defined(KINETISK)
   port_->C3 &= ~UART_C3_FEIE;
@@ -94,6 +98,17 @@ void UARTReceiveHandler::setILT(bool flag) const {
   }
 }
 
+void UARTReceiveHandler::setRXWatermarkHigh(bool flag) const {
+#if defined(KINETISK)
+  // Leave room for two more slots so that there's time to respond to the
+  // interrupt before the FIFO overflows
+  if (rxFIFOSize_ <= 2) {
+    return;
+  }
+  port_->RWFIFO = flag ? rxFIFOSize_ - 2 : rxWatermark_;  // Receive Watermark
+#endif  // KINETISK
+}
+
 void UARTReceiveHandler::setIRQState(bool flag) const {
 #if defined(KINETISK)
   if (flag) {
@@ -120,11 +135,54 @@ int UARTReceiveHandler::priority() const {
   return NVIC_GET_PRIORITY(irq_);
 }
 
+template <typename Port>
+void UARTReceiveHandler::txIRQHandler(Port port, uint8_t status) const {
+  uint8_t control = port.regs().C2;
+
+  // If the transmit buffer is empty
+  if ((control & UART_C2_TIE) != 0 && (status & UART_S1_TDRE) != 0) {
+    const uint8_t *b = receiver_->responderOutBuf_;
+    int index = receiver_->responseIndex_;
+    int len = receiver_->responseLen_;
+    port.regs().D = b[index++];
+
+#if defined(KINETISK)
+    // Fill the FIFO
+    if (port.txFIFOSize() > 1) {
+      // TCFIFO is the Transmit Count
+      while (index < len && port.regs().TCFIFO < port.txFIFOSize()) {
+        port.regs().S1;
+        port.regs().D = b[index++];
+      }
+    }
+#endif  // KINETISK
+
+    receiver_->responseIndex_ = index;
+    if (index >= len) {
+      // Wait until transmission complete
+      port.regs().C2 = (control & ~UART_C2_TIE) | UART_C2_TCIE;
+    }
+  } else if ((control & UART_C2_TCIE) != 0 && (status & UART_S1_TC) != 0) {
+    port.regs().C2 = control & ~UART_C2_TCIE;
+    receiver_->responseComplete();
+  }
+}
+
 void UARTReceiveHandler::irqHandler() const {
-  uint8_t status = port_->S1;
+  irqHandler(dynamicPort());
+}
+
+template <typename Port>
+void UARTReceiveHandler::irqHandler(Port port) const {
+  TEENSYDMX_PROFILE(kReceiveIRQ);
+
+  uint8_t status = port.regs().S1;
 
   uint32_t eventTime = micros();
 
+  // Any response data
+  txIRQHandler(port, status);
+
   // A framing error likely indicates a BREAK, but it could also mean that there
   // were too few stop bits
   if ((status & UART_S1_FE) != 0) {
@@ -134,33 +192,36 @@ void UARTReceiveHandler::irqHandler() const {
 
 #if defined(KINETISL)
     // Clear the flag
-    if (serialIndex_ == 0) {
-      port_->S1 |= UART_S1_FE;
+    if (port.index() == 0) {
+      port.regs().S1 |= UART_S1_FE;
     } else {
       // It's not necessary to read the data register here to clear the flag
       // because it's read next
-      // port_->D;
+      // port.regs().D;
     }
 #endif  // KINETISL
 
 #if defined(KINETISK)
-    if (rxFIFOSize_ > 1) {
+    if (port.rxFIFOSize() > 1) {
       // Flush anything in the buffer
-      uint8_t avail = port_->RCFIFO;  // Receive Count
+      uint8_t avail = port.regs().RCFIFO;  // Receive Count
       if (avail > 1) {
         // Read everything but the last byte
-        uint32_t timestamp = eventTime - kCharTime*avail;
-        if (avail < port_->RWFIFO) {  // Receive Watermark
+        uint32_t timestamp = eventTime - kCharTime;
+        if (avail < port.regs().RWFIFO) {  // Receive Watermark
           timestamp -= kCharTime;
         }
-        while (--avail > 0) {
-          receiver_->receiveByte(port_->D, timestamp += kCharTime);
+        uint8_t data[8];  // The largest RX FIFO is 8 bytes
+        int count = std::min(avail - 1, int{sizeof(data)});
+        for (int i = 0; i < count; i++) {
+          data[i] = port.regs().D;
         }
+        receiver_->receiveBytes(data, count, timestamp);
       }
     }
 #endif  // KINETISK
 
-    if (port_->D == 0) {
+    if (port.regs().D == 0) {
       receiver_->receivePotentialBreak(eventTime);
     } else {
       receiver_->receiveBadBreak();
@@ -169,52 +230,67 @@ void UARTReceiveHandler::irqHandler() const {
   }
 
 #if defined(KINETISK)
-  if (rxFIFOSize_ > 1) {
+  if (port.rxFIFOSize() > 1) {
     // If the receive buffer is full or there's an idle condition
     if ((status & (UART_S1_RDRF | UART_S1_IDLE)) != 0) {
       __disable_irq();
-      uint8_t avail = port_->RCFIFO;  // Receive Count
+      uint8_t avail = port.regs().RCFIFO;  // Receive Count
       if (avail == 0) {
         // Read the register to clear the interrupt, but since it's empty,
         // this causes the FIFO to become misaligned, so send RXFLUSH to
         // reinitialize its pointers.
         // Do this inside no interrupts to avoid a potential race condition
         // between reading RCFIFO and flushing the FIFO.
-        port_->D;
-        port_->CFIFO = UART_CFIFO_RXFLUSH;
+        port.regs().D;
+        port.regs().CFIFO = UART_CFIFO_RXFLUSH;
         __enable_irq();
         receiver_->receiveIdle(eventTime);
       } else {
         __enable_irq();
         bool idle = ((status & UART_S1_IDLE) != 0);
         uint32_t timestamp = eventTime - kCharTime*avail;
-        if (avail < port_->RWFIFO) {  // Receive Watermark
+        if (avail < port.regs().RWFIFO) {  // Receive Watermark
           timestamp -= kCharTime;
         }
+        // Read the whole FIFO so that it can be processed as one batch.
         // Read all but the last available, then read S1 and the final value
         // So says the chip docs,
         // Section 47.3.5 UART Status Register 1 (UART_S1)
         // In the NOTE part.
+        uint8_t data[8];  // The largest RX FIFO is 8 bytes
+        if (avail > sizeof(data)) {
+          avail = sizeof(data);
+        }
 #if defined(__MK20DX128__) || defined(__MK20DX256__)
-        bool errFlag = false;
+        int errIndex = -1;
 #endif  // __MK20DX128__ || __MK20DX256__
-        while (--avail > 0) {
+        for (int i = 0; i < avail; i++) {
+          if (i == avail - 1) {
+            port.regs().S1;
+          }
 #if defined(__MK20DX128__) || defined(__MK20DX256__)
           // Check that the 9th bit is high; used as the first stop bit
-          if (!errFlag && (port_->C3 & UART_C3_R8) == 0) {
-            errFlag = true;
-            receiver_->receiveBadBreak();
+          if (errIndex < 0 && (port.regs().C3 & UART_C3_R8) == 0) {
+            errIndex = i;
           }
 #endif  // __MK20DX128__ || __MK20DX256__
-          receiver_->receiveByte(port_->D, timestamp += kCharTime);
+          data[i] = port.regs().D;
         }
-        port_->S1;
 #if defined(__MK20DX128__) || defined(__MK20DX256__)
-        if (!errFlag && (port_->C3 & UART_C3_R8) == 0) {
+        if (errIndex >= 0) {
+          // Receive the bytes before the bad one, then the rest after
+          // the bad BREAK
+          receiver_->receiveBytes(data, errIndex,
+                                  timestamp + kCharTime*errIndex);
           receiver_->receiveBadBreak();
+          receiver_->receiveBytes(&data[errIndex], avail - errIndex,
+                                  timestamp + kCharTime*avail);
+        } else {
+          receiver_->receiveBytes(data, avail, timestamp + kCharTime*avail);
         }
+#else
+        receiver_->receiveBytes(data, avail, timestamp + kCharTime*avail);
 #endif  // __MK20DX128__ || __MK20DX256__
-        receiver_->receiveByte(port_->D, timestamp + kCharTime);
         if (idle) {  // Also capture any IDLE event
           receiver_->receiveIdle(eventTime);
           // The flag has been cleared by reading the data register
@@ -226,81 +302,68 @@ void UARTReceiveHandler::irqHandler() const {
     if ((status & UART_S1_RDRF) != 0) {
 #if defined(__MK20DX128__) || defined(__MK20DX256__)
       // Check that the 9th bit is high; used as the first stop bit
-      if ((port_->C3 & UART_C3_R8) == 0) {
+      if ((port.regs().C3 & UART_C3_R8) == 0) {
         receiver_->receiveBadBreak();
       }
 #endif  // __MK20DX128__ || __MK20DX256__
-      receiver_->receiveByte(port_->D, eventTime);
+      receiver_->receiveByte(port.regs().D, eventTime);
     } else if ((status & UART_S1_IDLE) != 0) {
       receiver_->receiveIdle(eventTime);
-      port_->D;  // Clear the flag
+      port.regs().D;  // Clear the flag
     }
   }
 #else  // No FIFO
   // If the receive buffer is full
   if ((status & UART_S1_RDRF) != 0) {
-    receiver_->receiveByte(port_->D, eventTime);
+    receiver_->receiveByte(port.regs().D, eventTime);
   } else if ((status & UART_S1_IDLE) != 0) {
     receiver_->receiveIdle(eventTime);
 
     // Clear the flag
-    if (serialIndex_ == 0) {
-      port_->S1 |= UART_S1_IDLE;
+    if (port.index() == 0) {
+      port.regs().S1 |= UART_S1_IDLE;
     } else {
-      port_->D;
+      port.regs().D;
     }
   }
 #endif  // KINETISK
 }
 
-void UARTReceiveHandler::txData(const uint8_t *b, int len) const {
-  if (len <= 0) {
-    return;
-  }
-
-  while (len > 0) {
-    while ((port_->S1 & UART_S1_TDRE) == 0) {
-      // Wait until we can transmit
-    }
-    port_->D = *(b++);
-    len--;
-
-#if defined(KINETISK)
-    // Send the FIFO
-    if (txFIFOSize_ > 1) {
-      while (len > 0 && port_->TCFIFO < txFIFOSize_) {  // Transmit Count
-        port_->S1;
-        port_->D = *(b++);
-        len--;
-      }
-    }
-#endif // KINETISK
-  }
-
-  while ((port_->S1 & UART_S1_TC) == 0) {
-    // Wait until transmission complete
-  }
+// The ISRs each call the handler for their own port
+#if defined(HAS_KINETISK_UART0) || defined(HAS_KINETISL_UART0)
+template void UARTReceiveHandler::irqHandler(UARTPort<0> port) const;
+#endif  // HAS_KINETISK_UART0 || HAS_KINETISL_UART0
+#if defined(HAS_KINETISK_UART1) || defined(HAS_KINETISL_UART1)
+template void UARTReceiveHandler::irqHandler(UARTPort<1> port) const;
+#endif  // HAS_KINETISK_UART1 || HAS_KINETISL_UART1
+#if defined(HAS_KINETISK_UART2) || defined(HAS_KINETISL_UART2)
+template void UARTReceiveHandler::irqHandler(UARTPort<2> port) const;
+#endif  // HAS_KINETISK_UART2 || HAS_KINETISL_UART2
+#if defined(HAS_KINETISK_UART3)
+template void UARTReceiveHandler::irqHandler(UARTPort<3> port) const;
+#endif  // HAS_KINETISK_UART3
+#if defined(HAS_KINETISK_UART4)
+template void UARTReceiveHandler::irqHandler(UARTPort<4> port) const;
+#endif  // HAS_KINETISK_UART4
+#if defined(HAS_KINETISK_UART5)
+template void UARTReceiveHandler::irqHandler(UARTPort<5> port) const;
+#endif  // HAS_KINETISK_UART5
+
+void UARTReceiveHandler::txStartBreak() const {
+  port_->C3 |= UART_C3_TXINV;
 }
 
-void UARTReceiveHandler::txBreak(uint32_t breakTime, uint32_t mabTime) const {
-#if defined(KINETISK)
-  if (txFIFOSize_ > 1) {
-    while (port_->TCFIFO > 0) {  // Transmit Count
-      // Wait for the FIFO to drain
-    }
-  }
-#endif  // KINETISK
+void UARTReceiveHandler::txStartMAB() const {
+  port_->C3 &= ~UART_C3_TXINV;
+}
 
-  while ((port_->S1 & UART_S1_TC) == 0) {
-    // Wait until we can transmit
-  }
+void UARTReceiveHandler::txStartData() const {
+  port_->C2 = (port_->C2 | UART_C2_TIE) & ~UART_C2_TCIE;
+}
 
-  if (breakTime > 0) {
-    port_->C3 |= UART_C3_TXINV;
-    delayMicroseconds(breakTime);
-    port_->C3 &= ~UART_C3_TXINV;
-  }
-  delayMicroseconds(mabTime);
+void UARTReceiveHandler::txStop() const {
+  port_->C2 &= ~(UART_C2_TIE | UART_C2_TCIE);
+  port_->C3 &= ~UART_C3_TXINV;
 }
 
 }  // namespace teensydmx
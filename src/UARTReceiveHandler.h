@@ -13,6 +13,7 @@
 #include <kinetis.h>
 
 #include "ReceiveHandler.h"
+#include "UARTPort.h"
 #include "TeensyDMX.h"
 
 namespace qindesign {
@@ -20,6 +21,8 @@ namespace teensydmx {
 
 class UARTReceiveHandler final : public ReceiveHandler {
  public:
+  static constexpr Kind kKind = Kind::kUART;
+
   UARTReceiveHandler(int serialIndex,
                      Receiver *receiver,
                      KINETISK_UART_t *port,
@@ -28,12 +31,13 @@ class UARTReceiveHandler final : public ReceiveHandler {
                      IRQ_NUMBER_t errorIRQ,
 #endif  // KINETISK
                      void (*irqHandler)())
-      : ReceiveHandler(serialIndex, receiver),
+      : ReceiveHandler(serialIndex, receiver, kKind),
         port_(port),
 #if defined(KINETISK)
         fifoSizesSet_(false),
         rxFIFOSize_(1),
         txFIFOSize_(1),
+        rxWatermark_(1),
 #endif  // KINETISK
         irq_(irq),
 #if defined(KINETISK)
@@ -47,18 +51,42 @@ class UARTReceiveHandler final : public ReceiveHandler {
   void end() const override;
   void setTXEnabled(bool flag) const override;
   void setILT(bool flag) const override;
+  void setRXWatermarkHigh(bool flag) const override;
   void setIRQState(bool flag) const override;
   int priority() const override;
   void irqHandler() const override;
-  void txData(const uint8_t *b, int len) const override;
-  void txBreak(uint32_t breakTime, uint32_t mabTime) const override;
+  void txStartBreak() const override;
+  void txStartMAB() const override;
+  void txStartData() const override;
+  void txStop() const override;
+
+  // Handles interrupts for the given port; see UARTPort.h. Each port's ISR
+  // calls this with its own `UARTPort`, and `irqHandler()` calls it with the
+  // values found at run time.
+  template <typename Port>
+  void irqHandler(Port port) const;
 
  private:
+  // Returns this handler's port, with the values found at run time.
+  DynamicUARTPort dynamicPort() const {
+#if defined(KINETISK)
+    return {port_, serialIndex_, rxFIFOSize_, txFIFOSize_};
+#else
+    return {port_, serialIndex_, 1, 1};
+#endif  // KINETISK
+  }
+
+  // Handles the TX interrupts for sending a response, given the status
+  // register value.
+  template <typename Port>
+  void txIRQHandler(Port port, uint8_t status) const;
+
   KINETISK_UART_t *port_;
 #if defined(KINETISK)
   bool fifoSizesSet_;
   uint8_t rxFIFOSize_;
   uint8_t txFIFOSize_;
+  uint8_t rxWatermark_;  // The watermark set when the UART was started
 #endif  // KINETISK
   IRQ_NUMBER_t irq_;
 #if defined(KINETISK)
@@ -8,6 +8,8 @@
 
 #include <core_pins.h>
 
+#include "SenderGroup.h"
+
 namespace qindesign {
 namespace teensydmx {
 
@@ -15,6 +17,7 @@ namespace teensydmx {
 #define UART_C2_TX_ACTIVE     ((UART_C2_TX_ENABLE) | (UART_C2_TIE))
 #define UART_C2_TX_COMPLETING ((UART_C2_TX_ENABLE) | (UART_C2_TCIE))
 #define UART_C2_TX_INACTIVE   (UART_C2_TX_ENABLE)
+#define UART_C2_TX_DMA        ((UART_C2_TX_COMPLETING) | (UART_C2_TIE))
 
 extern const uint32_t kSlotsBaud;
 extern const uint32_t kSlotsFormat;
@@ -22,17 +25,17 @@ extern const uint32_t kSlotsFormat;
 void UARTSendHandler::start() {
   // Set the serial parameters for the two modes
   if (breakSerialParamsChanged_) {
-    sender_->uart_.begin(sender_->breakBaud_, sender_->breakFormat_);
+    sender_->uart_->begin(sender_->breakBaud_, sender_->breakFormat_);
     breakSerialParams_.getFrom(serialIndex_, port_,
                                (sender_->breakFormat_ & 0x80) != 0);
     breakSerialParamsChanged_ = false;
   }
   if (!slotsSerialParamsSet_) {
-    sender_->uart_.begin(kSlotsBaud, kSlotsFormat);
+    sender_->uart_->begin(kSlotsBaud, kSlotsFormat);
     slotsSerialParams_.getFrom(serialIndex_, port_, (kSlotsFormat & 0x80) != 0);
     slotsSerialParamsSet_ = true;
   } else {
-    sender_->uart_.begin(kSlotsBaud, kSlotsFormat);
+    sender_->uart_->begin(kSlotsBaud, kSlotsFormat);
   }
 
 #if defined(KINETISK)
@@ -49,27 +52,121 @@ void UARTSendHandler::start() {
 
     fifoSizeSet_ = true;
   }
+  txWatermark_ = port_->TWFIFO;
+
+  // Allocate or release the DMA channel
+  if (sender_->dmaEnabled_) {
+    if (dma_ == nullptr) {
+      dma_ = std::make_unique<DMAChannel>();
+      if (dma_->channel >= DMA_NUM_CHANNELS) {
+        // No channels are available, so use interrupts
+        dma_ = nullptr;
+      } else {
+        dma_->destination(port_->D);
+        dma_->triggerAtHardwareEvent(dmaSource_);
+        dma_->disableOnCompletion();
+      }
+    }
+  } else {
+    dma_ = nullptr;
+  }
+  port_->C5 &= ~UART_C5_TDMAS;
 #endif  // KINETISK
 
   attachInterruptVector(irq_, irqHandler_);
 }
 
 void UARTSendHandler::end() const {
-  sender_->uart_.end();
+#if defined(KINETISK)
+  if (dma_ != nullptr) {
+    port_->C5 &= ~UART_C5_TDMAS;
+    dma_->disable();
+  }
+#endif  // KINETISK
+  sender_->uart_->end();
 }
 
 void UARTSendHandler::setActive() const {
-  port_->C2 = UART_C2_TX_ACTIVE;
+  setActive(dynamicPort());
+}
+
+template <typename Port>
+void UARTSendHandler::setActive(Port port) const {
+#if defined(KINETISK)
+  // A queued idle character follows the slot in the shifter, so TDRE must
+  // wait until the FIFO is empty
+  if (port.txFIFOSize() > 1) {
+    port.regs().TWFIFO = sender_->useInterSlotIdleChars() ? 0 : txWatermark_;
+  }
+#endif  // KINETISK
+  port.regs().C2 = UART_C2_TX_ACTIVE;
 }
 
 void UARTSendHandler::setInactive() const {
-  port_->C2 = UART_C2_TX_INACTIVE;
+  setInactive(dynamicPort());
+}
+
+template <typename Port>
+void UARTSendHandler::setInactive(Port port) const {
+  port.regs().C2 = UART_C2_TX_INACTIVE;
 }
 
 void UARTSendHandler::setCompleting() const {
-  port_->C2 = UART_C2_TX_COMPLETING;
+  setCompleting(dynamicPort());
 }
 
+template <typename Port>
+void UARTSendHandler::setCompleting(Port port) const {
+  port.regs().C2 = UART_C2_TX_COMPLETING;
+}
+
+template <typename Port>
+void UARTSendHandler::sendSlot(Port port) const {
+  int index = sender_->inactiveBufIndex_;
+  if (index >= sender_->inactivePacketSize_) {
+    setCompleting(port);
+    return;
+  }
+
+  bool idle = sender_->useInterSlotIdleChars();
+  if (idle && index > 0) {
+    // Turning the transmitter off and back on queues an idle character after
+    // the slot being shifted out
+    uint8_t c2 = port.regs().C2;
+    port.regs().C2 = c2 & ~UART_C2_TE;
+    port.regs().C2 = c2;
+  }
+  port.regs().D = sender_->inactiveBuf_[index++];
+  sender_->inactiveBufIndex_ = index;
+  if (index >= sender_->inactivePacketSize_) {
+    setCompleting(port);
+  } else if (!idle && sender_->interSlotTime_ != 0) {
+    sender_->state_ = Sender::XmitStates::kInterSlot;
+    setCompleting(port);
+  }
+}
+
+#if defined(KINETISK)
+template <typename Port>
+bool UARTSendHandler::startDMA(Port port) const {
+  int index = sender_->inactiveBufIndex_;
+  int len = sender_->inactivePacketSize_ - index;
+  if (len <= 0) {
+    return false;
+  }
+
+  dma_->sourceBuffer(&sender_->inactiveBuf_[index], len);
+  dma_->clearComplete();
+  sender_->inactiveBufIndex_ = sender_->inactivePacketSize_;
+
+  // TDRE now generates DMA requests; the only interrupt is TC at the end
+  dma_->enable();
+  port.regs().C5 |= UART_C5_TDMAS;
+  port.regs().C2 = UART_C2_TX_DMA;
+  return true;
+}
+#endif  // KINETISK
+
 void UARTSendHandler::setIRQState(bool flag) const {
   if (flag) {
     NVIC_ENABLE_IRQ(irq_);
@@ -83,8 +180,11 @@ int UARTSendHandler::priority() const {
 }
 
 void UARTSendHandler::breakTimerCallback() const {
+  TEENSYDMX_PROFILE(kBreakTimer);
+
   if (sender_->state_ == Sender::XmitStates::kBreak) {
-    port_->C3 &= ~UART_C3_TXINV;
+    startMAB();
+    sender_->mabStarted(micros());
     sender_->state_ = Sender::XmitStates::kMAB;
     if (sender_->intervalTimer_.restart(sender_->adjustedMABTime_)) {
       return;
@@ -96,109 +196,164 @@ void UARTSendHandler::breakTimerCallback() const {
     // We shouldn't delay as an alternative because that might
     // mean we delay too long, however the MAB is most likely to
     // be too short in this case
+    sender_->stats_.mabTimerFailures++;
   }
   sender_->intervalTimer_.end();
+  sender_->slotsStarted(micros());
   sender_->state_ = Sender::XmitStates::kData;
   setActive();
 }
 
 void UARTSendHandler::breakTimerPreCallback() const {
   // Invert the line as close as possible to the timer start
-  port_->C3 |= UART_C3_TXINV;
+  startBreak();
   setInactive();
-  sender_->breakStartTime_ = micros();
+  sender_->breakStarted(micros(), true);
+}
+
+void UARTSendHandler::startBreak() const {
+  port_->C3 |= UART_C3_TXINV;
+}
+
+void UARTSendHandler::startMAB() const {
+  port_->C3 &= ~UART_C3_TXINV;
+}
+
+void UARTSendHandler::sendSerialBreak() const {
+  breakSerialParams_.apply(serialIndex_, port_);
+  port_->D = 0;
+  setCompleting();
+  sender_->breakStarted(micros(), false);
+}
+
+uint32_t UARTSendHandler::actualBaud(uint32_t baud) const {
+  if (baud == 0) {
+    return 0;
+  }
+
+  // These match the divisor calculations in the core's `serialN_begin()`
+  // functions: the divisor is `clock/baud`, rounded
+#if defined(KINETISK)
+  // The divisor has five fractional bits and UART0 and UART1 use the
+  // core clock
+  uint32_t clock = ((serialIndex_ < 2) ? F_CPU : F_BUS) * 2;
+  uint32_t div = (clock + (baud >> 1)) / baud;
+  if (div < 32) {
+    div = 32;
+  }
+#elif defined(KINETISL)
+  // The divisor is for 16x oversampling and UART0 uses the PLL clock
+  uint32_t clock = ((serialIndex_ == 0) ? F_PLL : F_BUS) / 16;
+  uint32_t div = (clock + (baud >> 1)) / baud;
+  if (div < 1) {
+    div = 1;
+  }
+#endif  // Which chip?
+  return clock / div;
 }
 
 void UARTSendHandler::interSlotTimerCallback() const {
+  TEENSYDMX_PROFILE(kInterSlotTimer);
+
   sender_->intervalTimer_.end();
   sender_->state_ = Sender::XmitStates::kData;
   setActive();
 }
 
 void UARTSendHandler::rateTimerCallback() const {
+  TEENSYDMX_PROFILE(kRateTimer);
+
   sender_->intervalTimer_.end();
   setActive();
 }
 
 void UARTSendHandler::irqHandler() const {
-  uint8_t status = port_->S1;
-  uint8_t control = port_->C2;
+  irqHandler(dynamicPort());
+}
+
+template <typename Port>
+void UARTSendHandler::irqHandler(Port port) const {
+  TEENSYDMX_PROFILE(kSendIRQ);
+
+  uint8_t status = port.regs().S1;
+  uint8_t control = port.regs().C2;
+
+#if defined(KINETISK)
+  // While DMA is active, TDRE generates DMA requests and not interrupts
+  bool dmaActive = (port.regs().C5 & UART_C5_TDMAS) != 0;
+#else
+  constexpr bool dmaActive = false;
+#endif  // KINETISK
 
   // If the transmit buffer is empty
-  if ((control & UART_C2_TIE) != 0 && (status & UART_S1_TDRE) != 0) {
+  if (!dmaActive &&
+      (control & UART_C2_TIE) != 0 && (status & UART_S1_TDRE) != 0) {
     switch (sender_->state_) {
       case Sender::XmitStates::kBreak:
 #ifndef TEENSYDMX_USE_PERIODICTIMER
         if (sender_->breakUseTimer_ &&
             sender_->intervalTimer_.begin(
-                [this]() { breakTimerCallback(); },
+                callback<&UARTSendHandler::breakTimerCallback>(),
                 sender_->adjustedBreakTime_)) {
           breakTimerPreCallback();
 #else
         if (sender_->breakUseTimer_ &&
             sender_->intervalTimer_.begin(
-                [this]() { breakTimerCallback(); },
+                callback<&UARTSendHandler::breakTimerCallback>(),
                 sender_->breakTime_,
-                [this]() { breakTimerPreCallback(); })) {
+                callback<&UARTSendHandler::breakTimerPreCallback>())) {
 #endif  // !TEENSYDMX_USE_PERIODICTIMER
         } else {
           // Not using a timer or starting it failed;
           // revert to the original way
-          breakSerialParams_.apply(serialIndex_, port_);
-          port_->D = 0;
-          setCompleting();
-          sender_->breakStartTime_ = micros();
+          if (sender_->breakUseTimer_) {
+            sender_->stats_.breakTimerFailures++;
+          }
+          sendSerialBreak();
         }
         break;
 
       case Sender::XmitStates::kMAB:  // Shouldn't be needed
         sender_->state_ = Sender::XmitStates::kData;
-        setActive();
+        setActive(port);
         break;
 
       case Sender::XmitStates::kData:
 #if defined(KINETISK)
-        if (fifoSize_ > 1 && sender_->interSlotTime_ == 0) {
+        if (dma_ != nullptr && sender_->interSlotTime_ == 0 && startDMA(port)) {
+          sender_->frameDMA_ = true;
+          break;
+        }
+        if (port.txFIFOSize() > 1 && sender_->interSlotTime_ == 0) {
+          // Nothing else changes these while the ISR runs, so keep them in
+          // registers instead of reloading them for each slot
+          const volatile uint8_t *buf = sender_->inactiveBuf_;
+          int index = sender_->inactiveBufIndex_;
+          const int size = sender_->inactivePacketSize_;
           do {
-            if (sender_->inactiveBufIndex_ >= sender_->inactivePacketSize_) {
-              setCompleting();
+            if (index >= size) {
+              setCompleting(port);
               break;
             }
-            port_->S1;
-            port_->D = sender_->inactiveBuf_[sender_->inactiveBufIndex_++];
-          } while (port_->TCFIFO < fifoSize_);  // Transmit Count
+            port.regs().S1;
+            port.regs().D = buf[index++];
+          } while (port.regs().TCFIFO < port.txFIFOSize());  // Transmit Count
+          sender_->inactiveBufIndex_ = index;
         } else {  // No FIFO or don't use the FIFO
-          if (sender_->inactiveBufIndex_ < sender_->inactivePacketSize_) {
-            port_->D = sender_->inactiveBuf_[sender_->inactiveBufIndex_++];
-            if (sender_->inactiveBufIndex_ >= sender_->inactivePacketSize_) {
-              setCompleting();
-            } else if (sender_->interSlotTime_ != 0) {
-              sender_->state_ = Sender::XmitStates::kInterSlot;
-              setCompleting();
-            }
-          } else {
-            setCompleting();
-          }
+          sendSlot(port);
         }
 #else  // No FIFO
-        if (sender_->inactiveBufIndex_ < sender_->inactivePacketSize_) {
-          port_->D = sender_->inactiveBuf_[sender_->inactiveBufIndex_++];
-          if (sender_->inactiveBufIndex_ >= sender_->inactivePacketSize_) {
-            setCompleting();
-          } else if (sender_->interSlotTime_ != 0) {
-            sender_->state_ = Sender::XmitStates::kInterSlot;
-            setCompleting();
-          }
-        } else {
-          setCompleting();
-        }
+        sendSlot(port);
 #endif  // KINETISK
         break;
 
       case Sender::XmitStates::kIdle: {
         // Pause management
         if (sender_->paused_) {
-          setInactive();
+          setInactive(port);
+          if (sender_->group_ != nullptr) {
+            sender_->group_->senderIdle();
+          }
           return;
         }
         if (sender_->resumeCounter_ > 0) {
@@ -210,12 +365,20 @@ void UARTSendHandler::irqHandler() const {
         sender_->transmitting_ = true;
         sender_->state_ = Sender::XmitStates::kBreak;
 
+        // A group starts the BREAK when all its senders are ready
+        if (sender_->group_ != nullptr) {
+          setInactive(port);
+          sender_->groupWaiting_ = true;
+          sender_->group_->senderIdle();
+          return;
+        }
+
         // Delay so that we can achieve the specified refresh rate
         // including the MBB
         uint32_t timeSinceBreak = micros() - sender_->breakStartTime_;
         if (sender_->breakToBreakTime_ == UINT32_MAX) {
           // Infinite BREAK to BREAK time
-          setInactive();
+          setInactive(port);
           return;
         }
         uint32_t delay = sender_->adjustedMBBTime_;
@@ -223,15 +386,16 @@ void UARTSendHandler::irqHandler() const {
           delay = sender_->breakToBreakTime_ - timeSinceBreak;
         }
         if (delay > 0) {
-          setInactive();
+          setInactive(port);
           if (sender_->intervalTimer_.begin(
-                  [this]() { rateTimerCallback(); },
+                  callback<&UARTSendHandler::rateTimerCallback>(),
                   delay)) {
             return;
           }
+          sender_->stats_.rateTimerFailures++;
         }
         // Starting the timer failed or no delay is necessary
-        setActive();
+        setActive(port);
         break;
       }
 
@@ -244,26 +408,43 @@ void UARTSendHandler::irqHandler() const {
   if ((control & UART_C2_TCIE) != 0 && (status & UART_S1_TC) != 0) {
     switch (sender_->state_) {
       case Sender::XmitStates::kBreak:
+        sender_->slotsStarted(micros());
         sender_->state_ = Sender::XmitStates::kData;
-        slotsSerialParams_.apply(serialIndex_, port_);
+        slotsSerialParams_.apply(port.index(), &port.regs());
         break;
 
       case Sender::XmitStates::kMAB:  // Shouldn't be needed
         sender_->state_ = Sender::XmitStates::kData;
-        slotsSerialParams_.apply(serialIndex_, port_);
+        slotsSerialParams_.apply(port.index(), &port.regs());
         break;
 
       case Sender::XmitStates::kData:
-        sender_->completePacket();
+#if defined(KINETISK)
+        if (dmaActive) {
+          // TC may have been stale when the transfer started, so wait until
+          // the DMA is done and the last slot has actually been sent
+          if (!dma_->complete() || (port.regs().S1 & UART_S1_TC) == 0) {
+            return;
+          }
+          port.regs().C5 &= ~UART_C5_TDMAS;
+          dma_->clearComplete();
+        }
+#endif  // KINETISK
+        if (!sender_->completePacket()) {
+          // Wait for a repeater to receive more slots
+          setInactive(port);
+          return;
+        }
         break;
 
       case Sender::XmitStates::kInterSlot: {
-        setInactive();
+        setInactive(port);
         if (sender_->intervalTimer_.begin(
-                [this]() { interSlotTimerCallback(); },
+                callback<&UARTSendHandler::interSlotTimerCallback>(),
                 sender_->adjustedInterSlotTime_)) {
           return;
         }
+        sender_->stats_.interSlotTimerFailures++;
         sender_->state_ = Sender::XmitStates::kData;
         break;
       }
@@ -274,14 +455,35 @@ void UARTSendHandler::irqHandler() const {
       default:
         break;
     }
-    setActive();
+    setActive(port);
   }
 }
 
+// The ISRs each call the handler for their own port
+#if defined(HAS_KINETISK_UART0) || defined(HAS_KINETISL_UART0)
+template void UARTSendHandler::irqHandler(UARTPort<0> port) const;
+#endif  // HAS_KINETISK_UART0 || HAS_KINETISL_UART0
+#if defined(HAS_KINETISK_UART1) || defined(HAS_KINETISL_UART1)
+template void UARTSendHandler::irqHandler(UARTPort<1> port) const;
+#endif  // HAS_KINETISK_UART1 || HAS_KINETISL_UART1
+#if defined(HAS_KINETISK_UART2) || defined(HAS_KINETISL_UART2)
+template void UARTSendHandler::irqHandler(UARTPort<2> port) const;
+#endif  // HAS_KINETISK_UART2 || HAS_KINETISL_UART2
+#if defined(HAS_KINETISK_UART3)
+template void UARTSendHandler::irqHandler(UARTPort<3> port) const;
+#endif  // HAS_KINETISK_UART3
+#if defined(HAS_KINETISK_UART4)
+template void UARTSendHandler::irqHandler(UARTPort<4> port) const;
+#endif  // HAS_KINETISK_UART4
+#if defined(HAS_KINETISK_UART5)
+template void UARTSendHandler::irqHandler(UARTPort<5> port) const;
+#endif  // HAS_KINETISK_UART5
+
 #undef UART_C2_TX_ENABLE
 #undef UART_C2_TX_ACTIVE
 #undef UART_C2_TX_COMPLETING
 #undef UART_C2_TX_INACTIVE
+#undef UART_C2_TX_DMA
 
 }  // namespace teensydmx
 }  // namespace qindesign
@@ -9,30 +9,44 @@
 
 // C++ includes
 #include <cstdint>
+#include <memory>
 
 #include <kinetis.h>
+#if defined(KINETISK)
+#include <DMAChannel.h>
+#endif  // KINETISK
 
 #include "SendHandler.h"
 #include "TeensyDMX.h"
+#include "UARTPort.h"
+#include "util/Delegate.h"
 
 namespace qindesign {
 namespace teensydmx {
 
 class UARTSendHandler final : public SendHandler {
  public:
+  static constexpr Kind kKind = Kind::kUART;
+
   UARTSendHandler(int serialIndex,
                   Sender *sender,
                   KINETISK_UART_t *port,
                   IRQ_NUMBER_t irq,
-                  void (*irqHandler)())
-      : SendHandler(serialIndex, sender),
+                  void (*irqHandler)(),
+                  uint8_t dmaSource)
+      : SendHandler(serialIndex, sender, kKind),
         port_(port),
 #if defined(KINETISK)
         fifoSizeSet_(false),
         fifoSize_(1),
+        txWatermark_(0),
 #endif  // KINETISK
         irq_(irq),
         irqHandler_(irqHandler),
+#if defined(KINETISK)
+        dmaSource_(dmaSource),
+        dma_{nullptr},
+#endif  // KINETISK
         slotsSerialParamsSet_(false) {}
 
   ~UARTSendHandler() override = default;
@@ -43,6 +57,16 @@ class UARTSendHandler final : public SendHandler {
   void setIRQState(bool flag) const override;
   int priority() const override;
   void irqHandler() const override;
+  void startBreak() const override;
+  void startMAB() const override;
+  void sendSerialBreak() const override;
+  uint32_t actualBaud(uint32_t baud) const override;
+
+  // Handles interrupts for the given port; see UARTPort.h. Each port's ISR
+  // calls this with its own `UARTPort`, and `irqHandler()` calls it with the
+  // values found at run time.
+  template <typename Port>
+  void irqHandler(Port port) const;
 
  private:
   // Stored UART parameters for quickly setting the baud rate between BREAK
@@ -90,10 +114,46 @@ class UARTSendHandler final : public SendHandler {
     }
   };
 
+  // Returns this handler's port, with the values found at run time.
+  DynamicUARTPort dynamicPort() const {
+#if defined(KINETISK)
+    return {port_, serialIndex_, fifoSize_, fifoSize_};
+#else
+    return {port_, serialIndex_, 1, 1};
+#endif  // KINETISK
+  }
+
   // Set CTRL states
+  template <typename Port>
+  void setActive(Port port) const;
+  template <typename Port>
+  void setInactive(Port port) const;
   void setInactive() const;
+  template <typename Port>
+  void setCompleting(Port port) const;
   void setCompleting() const;
 
+  // Sends the next slot, one per TDRE, for when the FIFO isn't used. If the
+  // sender wants idle characters between the slots then one is queued ahead
+  // of each slot after the start code. Otherwise, a non-zero inter-slot time
+  // moves to the "inter-slot" state.
+  template <typename Port>
+  void sendSlot(Port port) const;
+
+#if defined(KINETISK)
+  // Starts sending the rest of the packet using DMA and puts the UART into
+  // "COMPLETING" mode, keeping TDRE DMA requests enabled. This returns whether
+  // the transfer was started.
+  template <typename Port>
+  bool startDMA(Port port) const;
+#endif  // KINETISK
+
+  // Returns a timer callback that calls the given member function.
+  template <void (UARTSendHandler::*Method)() const>
+  util::Delegate callback() const {
+    return util::Delegate::fromMethod<UARTSendHandler, Method>(this);
+  }
+
   // Timer handling
   void breakTimerCallback() const;      // When the timer triggers
   void breakTimerPreCallback() const;   // Just before the timer starts
@@ -104,10 +164,17 @@ class UARTSendHandler final : public SendHandler {
 #if defined(KINETISK)
   bool fifoSizeSet_;
   uint8_t fifoSize_;
+  uint8_t txWatermark_;  // The core's TWFIFO, restored when not sending idles
 #endif  // KINETISK
   IRQ_NUMBER_t irq_;
   void (*irqHandler_)();
 
+#if defined(KINETISK)
+  // DMA, allocated in start() if the sender wants it
+  uint8_t dmaSource_;
+  std::unique_ptr<DMAChannel> dma_;
+#endif  // KINETISK
+
   bool slotsSerialParamsSet_;
   SerialParams breakSerialParams_;
   SerialParams slotsSerialParams_;
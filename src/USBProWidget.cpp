@@ -0,0 +1,432 @@
+// This file is part of the TeensyDMX library.
+// (c) 2022 Shawn Silverman
+
+#include "USBProWidget.h"
+
+// C++ includes
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+#include <core_pins.h>
+
+namespace qindesign {
+namespace teensydmx {
+
+// Message framing
+constexpr uint8_t kStartByte = 0x7E;
+constexpr uint8_t kEndByte   = 0xE7;
+
+// An unfinished message is dropped after this many milliseconds
+constexpr uint32_t kReadTimeout = 500;
+
+// How many bytes to discard at a time
+constexpr int kDiscardSize = 64;
+
+// BREAK and MAB times are in units of 10.67us
+constexpr uint32_t kParamTimeUnit = 1067;  // In hundredths of a microsecond
+
+USBProWidget::USBProWidget(Stream &stream)
+    : stream_(stream),
+      ports_{},
+      firmwareVersion_(0x0144),
+      serialNumber_(0),
+      manufacturerID_(0),
+      manufacturerName_(nullptr),
+      deviceID_(0),
+      deviceName_(nullptr),
+      receiveOnChange_(false),
+      state_(ParseStates::kStart),
+      lastReadTime_(0),
+      label_(0),
+      remaining_(0),
+      port_(-1),
+      dst_(nullptr),
+      dstSize_(0),
+      dstIndex_(0),
+      output_(nullptr) {}
+
+USBProWidget::~USBProWidget() {
+  abortOutput();
+  for (int i = 0; i < kMaxPorts; i++) {
+    if (ports_[i].rx != nullptr) {
+      ports_[i].rx->unclaimFrames(this);
+    }
+  }
+}
+
+bool USBProWidget::setPort(int port, Sender *tx, Receiver *rx) {
+  if (port < 0 || kMaxPorts <= port) {
+    return false;
+  }
+  Port &p = ports_[port];
+  if (rx != nullptr && rx != p.rx) {
+    for (int i = 0; i < kMaxPorts; i++) {
+      if (ports_[i].rx == rx) {
+        return false;
+      }
+    }
+    if (!rx->claimFrames(this)) {
+      return false;
+    }
+  }
+  if (p.rx != nullptr && p.rx != rx) {
+    p.rx->unclaimFrames(this);
+  }
+  if (output_ != nullptr && output_ == p.tx && p.tx != tx) {
+    abortOutput();
+  }
+  p = Port{};
+  p.tx = tx;
+  p.rx = rx;
+  return true;
+}
+
+// ---------------------------------------------------------------------------
+//  Input
+// ---------------------------------------------------------------------------
+
+void USBProWidget::poll() {
+  int avail;
+  while ((avail = stream_.available()) > 0) {
+    lastReadTime_ = millis();
+    if (state_ != ParseStates::kData) {
+      int b = stream_.read();
+      if (b < 0) {
+        break;
+      }
+      parseByte(b);
+      continue;
+    }
+
+    // Read as much of the data as possible at once, straight into
+    // its destination
+    int n = std::min(avail, remaining_);
+    if (dst_ != nullptr && dstIndex_ < dstSize_) {
+      n = std::min(n, dstSize_ - dstIndex_);
+      // Nothing else uses the destination while the message is being read
+      n = stream_.readBytes(const_cast<uint8_t *>(&dst_[dstIndex_]), n);
+      dstIndex_ += n;
+    } else {
+      uint8_t discard[kDiscardSize];
+      n = stream_.readBytes(discard, std::min(n, kDiscardSize));
+    }
+    if (n <= 0) {
+      break;
+    }
+    remaining_ -= n;
+    if (remaining_ <= 0) {
+      state_ = ParseStates::kEnd;
+    }
+  }
+
+  if (state_ != ParseStates::kStart &&
+      millis() - lastReadTime_ >= kReadTimeout) {
+    abortOutput();
+    state_ = ParseStates::kStart;
+  }
+
+  sendReceived();
+}
+
+void USBProWidget::parseByte(uint8_t b) {
+  switch (state_) {
+    case ParseStates::kStart:
+      if (b == kStartByte) {
+        state_ = ParseStates::kLabel;
+      }
+      break;
+
+    case ParseStates::kLabel:
+      label_ = b;
+      state_ = ParseStates::kLenLSB;
+      break;
+
+    case ParseStates::kLenLSB:
+      remaining_ = b;
+      state_ = ParseStates::kLenMSB;
+      break;
+
+    case ParseStates::kLenMSB:
+      remaining_ |= int{b} << 8;
+      port_ = -1;
+      if (label_ == static_cast<uint8_t>(Labels::kSendDMXPort) &&
+          remaining_ > 0) {
+        state_ = ParseStates::kPort;
+        break;
+      }
+      if (label_ == static_cast<uint8_t>(Labels::kSendDMX)) {
+        port_ = 0;
+      }
+      startData();
+      break;
+
+    case ParseStates::kPort:
+      port_ = b;
+      remaining_--;
+      startData();
+      break;
+
+    case ParseStates::kEnd:
+      if (b == kEndByte) {
+        if (output_ != nullptr) {
+          // The whole packet arrived, so send it
+          output_->commitWrittenFrame(dstIndex_);
+          output_ = nullptr;
+        } else {
+          handleMessage();
+        }
+      } else {
+        abortOutput();
+      }
+      state_ = ParseStates::kStart;
+      break;
+
+    default:
+      state_ = ParseStates::kStart;
+      break;
+  }
+}
+
+void USBProWidget::startData() {
+  dstIndex_ = 0;
+  dst_ = msg_;
+  dstSize_ = kMaxMessageSize;
+  output_ = nullptr;
+
+  if (port_ >= 0) {
+    Sender *tx = (port_ < kMaxPorts) ? ports_[port_].tx : nullptr;
+    if (tx == nullptr || remaining_ <= 0 || kMaxDMXPacketSize < remaining_) {
+      dst_ = nullptr;  // Discard the data
+    } else {
+      // All of the packet is replaced, so the staging buffer doesn't need to
+      // start with the latest data
+      dst_ = tx->beginFrameForOverwrite();
+      dstSize_ = kMaxDMXPacketSize;
+      output_ = tx;
+    }
+  }
+
+  state_ = (remaining_ > 0) ? ParseStates::kData : ParseStates::kEnd;
+}
+
+void USBProWidget::abortOutput() {
+  if (output_ != nullptr) {
+    output_->abortFrame();
+    output_ = nullptr;
+  }
+}
+
+// ---------------------------------------------------------------------------
+//  Message handling
+// ---------------------------------------------------------------------------
+
+void USBProWidget::handleMessage() {
+  const int len = dstIndex_;
+
+  switch (static_cast<Labels>(label_)) {
+    case Labels::kGetParams: {
+      // Report the first sender's parameters
+      Sender *tx = nullptr;
+      for (int i = 0; i < kMaxPorts && tx == nullptr; i++) {
+        tx = ports_[i].tx;
+      }
+      uint8_t data[5]{static_cast<uint8_t>(firmwareVersion_),
+                      static_cast<uint8_t>(firmwareVersion_ >> 8),
+                      9, 1, 40};
+      if (tx != nullptr) {
+        // Ceiling calculations for the BREAK and MAB times
+        uint32_t t = (tx->breakTime()*100 + kParamTimeUnit - 1)/kParamTimeUnit;
+        data[2] = std::min(std::max(t, uint32_t{1}), uint32_t{127});
+        t = (tx->mabTime()*100 + kParamTimeUnit - 1)/kParamTimeUnit;
+        data[3] = std::min(std::max(t, uint32_t{1}), uint32_t{127});
+        float rate = tx->refreshRate();
+        if (rate > 40.0f) {
+          data[4] = 0;  // As fast as possible
+        } else {
+          data[4] = std::max(static_cast<uint8_t>(rate), uint8_t{1});
+        }
+      }
+      sendMessage(Labels::kGetParams, data, sizeof(data));
+      break;
+    }
+
+    case Labels::kSetParams: {
+      // Ignore the user configuration
+      if (len < 5 ||
+          (msg_[2] < 9 || 127 < msg_[2]) ||
+          (msg_[3] < 1 || 127 < msg_[3]) ||
+          (msg_[4] > 40)) {
+        break;
+      }
+      for (int i = 0; i < kMaxPorts; i++) {
+        Sender *tx = ports_[i].tx;
+        if (tx == nullptr) {
+          continue;
+        }
+        tx->setBreakTime((msg_[2] * kParamTimeUnit) / 100);  // Floor
+        tx->setMABTime((msg_[3] * kParamTimeUnit) / 100);  // Floor
+        if (msg_[4] == 0) {
+          tx->setRefreshRate(std::numeric_limits<float>::infinity());
+        } else {
+          tx->setRefreshRate(msg_[4]);
+        }
+      }
+      break;
+    }
+
+    case Labels::kReceiveDMXOnChange:
+      if (len != 1 || msg_[0] > 1) {
+        break;
+      }
+      receiveOnChange_ = (msg_[0] != 0);
+
+      // Everything is considered to have changed, by the spec, so the next
+      // packet is sent in full
+      std::fill_n(&ports_[0].changes[0], Receiver::kChangeWords, ~uint32_t{0});
+      ports_[0].view = Receiver::FrameView{};
+      break;
+
+    case Labels::kGetSerial: {
+      if (len != 0) {
+        break;
+      }
+      uint8_t data[4]{static_cast<uint8_t>(serialNumber_),
+                      static_cast<uint8_t>(serialNumber_ >> 8),
+                      static_cast<uint8_t>(serialNumber_ >> 16),
+                      static_cast<uint8_t>(serialNumber_ >> 24)};
+      sendMessage(Labels::kGetSerial, data, sizeof(data));
+      break;
+    }
+
+    case Labels::kDeviceManufacturer:
+      if (len == 0 && manufacturerName_ != nullptr) {
+        sendName(Labels::kDeviceManufacturer, manufacturerID_,
+                 manufacturerName_);
+      }
+      break;
+
+    case Labels::kDeviceName:
+      if (len == 0 && deviceName_ != nullptr) {
+        sendName(Labels::kDeviceName, deviceID_, deviceName_);
+      }
+      break;
+
+    default:
+      break;
+  }
+}
+
+// ---------------------------------------------------------------------------
+//  Output
+// ---------------------------------------------------------------------------
+
+void USBProWidget::sendReceived() {
+  uint32_t changes[Receiver::kChangeWords];
+  for (int i = 0; i < kMaxPorts; i++) {
+    Port &p = ports_[i];
+    if (p.rx == nullptr) {
+      continue;
+    }
+    // Read the changes first so that any packet that completes in between is
+    // reported with the next one instead of being missed
+    if (p.rx->readChangesFor(this, changes)) {
+      for (int w = 0; w < Receiver::kChangeWords; w++) {
+        p.changes[w] |= changes[w];
+      }
+    }
+    if (!p.rx->acquireFrameFor(this, p.view)) {
+      p.rx->releaseFrameFor(this);
+      continue;
+    }
+    if (p.view.size > 0) {
+      if (i != 0) {
+        sendPacket(Labels::kReceivedDMXPort, i, p.view.data, p.view.size);
+      } else if (!receiveOnChange_ || p.view.data[0] != 0) {
+        sendPacket(Labels::kReceivedDMX, -1, p.view.data, p.view.size);
+      } else {
+        sendChanges(p.view.data, p.view.size, p.changes);
+        std::fill_n(&p.changes[0], Receiver::kChangeWords, uint32_t{0});
+      }
+    }
+    p.rx->releaseFrameFor(this);
+  }
+}
+
+void USBProWidget::sendPacket(Labels label, int port,
+                              const uint8_t *data, int size) {
+  int len = size + 1 + ((port >= 0) ? 1 : 0);
+  uint8_t header[6]{kStartByte, static_cast<uint8_t>(label),
+                    static_cast<uint8_t>(len),
+                    static_cast<uint8_t>(len >> 8)};
+  int headerLen = 4;
+  if (port >= 0) {
+    header[headerLen++] = port;
+  }
+  header[headerLen++] = 0;  // No queue overflow nor overrun
+  stream_.write(header, headerLen);
+  stream_.write(data, size);
+  stream_.write(kEndByte);
+}
+
+void USBProWidget::sendChanges(const uint8_t *data, int size,
+                               const uint32_t *changes) {
+  // Each message covers 40 channels, starting at a multiple of 8
+  uint8_t msg[4 + 6 + 40 + 1];
+  int c = 0;
+  while (c < size) {
+    // Find the next changed channel
+    int w = c/32;
+    uint32_t bits = changes[w] & (~uint32_t{0} << (c%32));
+    while (bits == 0 && ++w < Receiver::kChangeWords) {
+      bits = changes[w];
+    }
+    if (bits == 0) {
+      break;
+    }
+    c = 32*w + __builtin_ctz(bits);
+    if (c >= size) {
+      break;
+    }
+
+    int start = c & ~7;
+    msg[0] = kStartByte;
+    msg[1] = static_cast<uint8_t>(Labels::kReceivedDMXChange);
+    msg[4] = start/8;
+    std::memset(&msg[5], 0, 5);
+    int n = 10;
+    int end = std::min(start + 40, size);
+    for (int ch = start; ch < end; ch++) {
+      if ((changes[ch/32] & (uint32_t{1} << (ch%32))) != 0) {
+        int j = ch - start;
+        msg[5 + j/8] |= 1 << (j%8);
+        msg[n++] = data[ch];
+      }
+    }
+    msg[2] = n - 4;
+    msg[3] = 0;
+    msg[n++] = kEndByte;
+    stream_.write(msg, n);
+    c = start + 40;
+  }
+}
+
+void USBProWidget::sendMessage(Labels label, const uint8_t *data, int len) {
+  uint8_t header[4]{kStartByte, static_cast<uint8_t>(label),
+                    static_cast<uint8_t>(len),
+                    static_cast<uint8_t>(len >> 8)};
+  stream_.write(header, sizeof(header));
+  stream_.write(data, len);
+  stream_.write(kEndByte);
+  stream_.flush();
+}
+
+void USBProWidget::sendName(Labels label, uint16_t id, const char *name) {
+  uint8_t data[2 + 32]{static_cast<uint8_t>(id), static_cast<uint8_t>(id >> 8)};
+  int nameLen = std::min(std::strlen(name), size_t{32});
+  std::copy_n(name, nameLen, &data[2]);
+  sendMessage(label, data, 2 + nameLen);
+}
+
+}  // namespace teensydmx
+}  // namespace qindesign
@@ -0,0 +1,205 @@
+// This file is part of the TeensyDMX library.
+// (c) 2022 Shawn Silverman
+
+// USBProWidget.h defines an engine for the Enttec DMX USB Pro widget protocol
+// that drives senders and receivers.
+
+#ifndef TEENSYDMX_USBPROWIDGET_H_
+#define TEENSYDMX_USBPROWIDGET_H_
+
+// C++ includes
+#include <cstdint>
+
+#include <Stream.h>
+
+#include "TeensyDMX.h"
+
+namespace qindesign {
+namespace teensydmx {
+
+// Speaks the DMX USB Pro widget protocol over a stream, usually `Serial`, for
+// one or more DMX ports. Each port can have a sender, a receiver, or both.
+//
+// Port 0 uses the standard labels. The other ports are addressed with two
+// extended labels whose data starts with the port number:
+// `Labels::kSendDMXPort` carries the same payload as `Labels::kSendDMX`, and
+// `Labels::kReceivedDMXPort` carries the same payload as
+// `Labels::kReceivedDMX`.
+//
+// The input is parsed a block of bytes at a time. The payload of a "Send DMX"
+// message is read straight into the port sender's staging buffer, and the
+// packet is committed as a frame only once the message's end byte has arrived,
+// so an incomplete or corrupted message never reaches the output. Don't open
+// frames on these senders elsewhere.
+//
+// Received packets are read in place with the receiver's frame view and written
+// to the stream without copying. Each receiver is used only by this engine
+// until it's removed from its port or the engine is destroyed, because a
+// receiver has only one frame view and one reader of its changes. All the
+// ports' new packets are written in each call to `poll()`. In "receive on
+// change" mode, port 0 sends change messages built from the receiver's
+// change tracking.
+//
+// Unlike a real widget, a port doesn't switch between sending and receiving;
+// the senders and receivers stay in whatever state the program sets.
+class USBProWidget final {
+ public:
+  // The maximum number of ports.
+  static constexpr int kMaxPorts = 4;
+
+  // Message labels.
+  enum class Labels : uint8_t {
+    kGetParams          = 3,
+    kSetParams          = 4,
+    kReceivedDMX        = 5,
+    kSendDMX            = 6,
+    kReceiveDMXOnChange = 8,
+    kReceivedDMXChange  = 9,
+    kGetSerial          = 10,
+
+    // https://wiki.openlighting.org/index.php/USB_Protocol_Extensions
+    kDeviceManufacturer = 77,
+    kDeviceName         = 78,
+
+    // Extended labels for addressing any port
+    kSendDMXPort        = 200,
+    kReceivedDMXPort    = 201,
+  };
+
+  // Creates a new engine that talks over the given stream.
+  explicit USBProWidget(Stream &stream);
+
+  // Destructs the engine, abandons any sender frame opened by an incomplete
+  // message, and gives the receivers' frame views and change tracking back to
+  // the application. The change tracking is disabled.
+  ~USBProWidget();
+
+  // The engine refers to the stream and ports, so it can't be copied or moved
+  USBProWidget(const USBProWidget &) = delete;
+  USBProWidget &operator=(const USBProWidget &) = delete;
+
+  // Sets the sender and receiver for a port. Either may be NULL. This enables
+  // the receiver's change tracking and gives the engine the only use of its
+  // frame view and changes; a receiver that's replaced gets them back. This
+  // returns `false` if the port is outside the range 0 to `kMaxPorts`-1, if
+  // the receiver is already used by another port, or if it's used by something
+  // else: a `Merger`, another engine, or the application, if it's holding a
+  // frame view or has enabled change tracking. Otherwise, this returns `true`
+  // and the port is set.
+  bool setPort(int port, Sender *tx, Receiver *rx);
+
+  // Sets the firmware version reported by "Get Widget Parameters".
+  void setFirmwareVersion(uint16_t version) {
+    firmwareVersion_ = version;
+  }
+
+  // Sets the serial number reported by "Get Widget Serial Number".
+  void setSerialNumber(uint32_t serialNumber) {
+    serialNumber_ = serialNumber;
+  }
+
+  // Sets the ESTA manufacturer ID and name. The name is truncated to 32
+  // characters and it must stay valid. A NULL name means the request
+  // isn't answered.
+  void setManufacturer(uint16_t id, const char *name) {
+    manufacturerID_ = id;
+    manufacturerName_ = name;
+  }
+
+  // Sets the device ID and name. The name is truncated to 32 characters and it
+  // must stay valid. A NULL name means the request isn't answered.
+  void setDevice(uint16_t id, const char *name) {
+    deviceID_ = id;
+    deviceName_ = name;
+  }
+
+  // Returns whether port 0 only sends changes. See
+  // `Labels::kReceiveDMXOnChange`.
+  bool isReceiveOnChange() const {
+    return receiveOnChange_;
+  }
+
+  // Processes all the available input and sends any newly received packets.
+  // Call this from the main loop.
+  void poll();
+
+ private:
+  // Where we are in parsing a message.
+  enum class ParseStates {
+    kStart,
+    kLabel,
+    kLenLSB,
+    kLenMSB,
+    kPort,
+    kData,
+    kEnd,
+  };
+
+  // Per-port state.
+  struct Port {
+    Sender *tx = nullptr;
+    Receiver *rx = nullptr;
+    Receiver::FrameView view;
+    uint32_t changes[Receiver::kChangeWords]{0};  // Changes not yet sent
+  };
+
+  // The largest message data kept for the labels the engine handles itself.
+  static constexpr int kMaxMessageSize = 600;
+
+  // Handles one byte outside the message data.
+  void parseByte(uint8_t b);
+
+  // Chooses where the message data goes, once the label, length, and any port
+  // are known.
+  void startData();
+
+  // Handles a complete message whose data wasn't sent to a sender.
+  void handleMessage();
+
+  // Abandons any sender frame opened by the current message.
+  void abortOutput();
+
+  // Sends the new packets from all the receivers.
+  void sendReceived();
+
+  // Sends a packet with the given label, port prefix, and data.
+  void sendPacket(Labels label, int port, const uint8_t *data, int size);
+
+  // Sends the changed channels of a packet as change messages.
+  void sendChanges(const uint8_t *data, int size, const uint32_t *changes);
+
+  // Sends a message having the given label and data.
+  void sendMessage(Labels label, const uint8_t *data, int len);
+
+  // Sends a name reply having the given ID.
+  void sendName(Labels label, uint16_t id, const char *name);
+
+  Stream &stream_;
+  Port ports_[kMaxPorts];
+
+  uint16_t firmwareVersion_;
+  uint32_t serialNumber_;
+  uint16_t manufacturerID_;
+  const char *manufacturerName_;
+  uint16_t deviceID_;
+  const char *deviceName_;
+  bool receiveOnChange_;
+
+  // Parsing
+  ParseStates state_;
+  uint32_t lastReadTime_;
+  uint8_t label_;
+  int remaining_;          // Data bytes still to come
+  int port_;               // Port for the message, or -1 if none
+  volatile uint8_t *dst_;  // Where the data goes, or NULL to discard it
+  int dstSize_;            // Capacity of the destination
+  int dstIndex_;           // Bytes stored in the destination
+  Sender *output_;         // The sender whose frame is being written, if any
+
+  uint8_t msg_[kMaxMessageSize];
+};
+
+}  // namespace teensydmx
+}  // namespace qindesign
+
+#endif  // TEENSYDMX_USBPROWIDGET_H_
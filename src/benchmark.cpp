@@ -0,0 +1,234 @@
+// Loopback benchmark program, for measuring what a board can achieve.
+//
+// This sends packets from a Sender on one serial port to a Receiver on another
+// serial port on the same board and sweeps through these settings:
+// 1. Packet size,
+// 2. Refresh rate,
+// 3. BREAK and MAB generation: serial parameters, or a timer with two sets of
+//    BREAK and MAB times, and
+// 4. Inter-slot MARK time.
+//
+// For each combination, this prints the achieved frames per second, the
+// jitter, or max - min, of the received BREAK plus MAB time, and the CPU
+// headroom, which is the fraction of the main loop's speed that remains. The
+// separate BREAK and MAB jitters are also printed if the RX line is being
+// monitored; see `kRXWatchPin`.
+//
+// Connect the sender's TX pin to the receiver's RX pin. For example, with the
+// default ports, connect pin 1 (Serial1 TX) to pin 9 (Serial2 RX) on a
+// Teensy LC or 3.x, or to pin 7 (Serial2 RX) on a Teensy 4.x.
+//
+// (c) 2022 Shawn Silverman
+
+// Define LOOPBACK_BENCHMARK_PROGRAM to use this program.
+#ifdef LOOPBACK_BENCHMARK_PROGRAM
+
+// C++ includes
+#include <cstdint>
+#include <limits>
+
+#include <Arduino.h>
+#include "TeensyDMX.h"
+
+namespace teensydmx = ::qindesign::teensydmx;
+
+// ---------------------------------------------------------------------------
+//  Configuration
+// ---------------------------------------------------------------------------
+
+// The serial ports to use.
+HardwareSerial &txUART = Serial1;
+HardwareSerial &rxUART = Serial2;
+
+// A pin also connected to the RX line, for measuring separate BREAK and MAB
+// times, or -1 to not monitor the line.
+constexpr int kRXWatchPin = -1;
+
+// How long to measure each combination, in milliseconds.
+constexpr uint32_t kRunTime = 1000;
+
+// How long to let the receiver settle after changing settings,
+// in milliseconds.
+constexpr uint32_t kSettleTime = 100;
+
+constexpr int kPacketSizes[]{25, 129, 513};
+constexpr float kRefreshRates[]{std::numeric_limits<float>::infinity(), 44};
+constexpr uint32_t kInterSlotTimes[]{0, 4};
+
+// BREAK and MAB generation.
+struct BreakConfig {
+  const char *name;
+  bool useTimer;
+  uint32_t breakTime;  // Only used with a timer
+  uint32_t mabTime;    // Only used with a timer
+};
+constexpr BreakConfig kBreakConfigs[]{
+    {"serial", false, 0, 0},
+    {"timer", true, 180, 20},
+    {"timer", true, teensydmx::kMinTXBreakTime, teensydmx::kMinTXMABTime},
+};
+
+// ---------------------------------------------------------------------------
+//  Main program
+// ---------------------------------------------------------------------------
+
+teensydmx::Sender dmxTx{txUART};
+teensydmx::Receiver dmxRx{rxUART};
+
+// The receiver's packet history size. This only needs to hold what arrives
+// between two main loop iterations.
+constexpr int kHistorySize = 64;
+
+// The number of packet stats to read at a time.
+constexpr int kReadSize = 8;
+
+// The number of main loop iterations in one run with nothing running.
+uint32_t baselineIterations = 0;
+
+// Tracks the minimum and maximum of a time value.
+struct Range {
+  uint32_t min = UINT32_MAX;
+  uint32_t max = 0;
+
+  void add(uint32_t t) {
+    if (t < min) {
+      min = t;
+    }
+    if (t > max) {
+      max = t;
+    }
+  }
+
+  uint32_t jitter() const {
+    return (min <= max) ? max - min : 0;
+  }
+};
+
+// Received timings.
+struct Timings {
+  Range breakPlusMABTime;
+  Range breakTime;
+  Range mabTime;
+};
+
+// Drains the receiver's packet history and adds the timings.
+void drainHistory(Timings &t) {
+  teensydmx::Receiver::PacketStats stats[kReadSize];
+  int n = dmxRx.readPacketHistory(stats, kReadSize);
+  for (int i = 0; i < n; i++) {
+    t.breakPlusMABTime.add(stats[i].breakPlusMABTime);
+    if (kRXWatchPin >= 0) {
+      t.breakTime.add(stats[i].breakTime);
+      t.mabTime.add(stats[i].mabTime);
+    }
+  }
+}
+
+// Spins for one run time while collecting timings, and returns the number of
+// loop iterations.
+uint32_t spin(Timings &t) {
+  uint32_t count = 0;
+  uint32_t start = millis();
+  while (millis() - start < kRunTime) {
+    drainHistory(t);
+    count++;
+  }
+  return count;
+}
+
+// Runs one combination and prints the results.
+void run(int size, float rate, const BreakConfig &bc, uint32_t interSlot) {
+  dmxTx.setPacketSize(size);
+  dmxTx.setRefreshRate(rate);
+  dmxTx.setBreakUseTimerNotSerial(bc.useTimer);
+  if (bc.useTimer) {
+    dmxTx.setBreakTime(bc.breakTime);
+    dmxTx.setMABTime(bc.mabTime);
+  }
+  dmxTx.setInterSlotTime(interSlot);
+  dmxTx.begin();
+  delay(kSettleTime);
+
+  // Discard anything received while settling
+  Timings t;
+  for (int i = 0; i < kHistorySize; i += kReadSize) {
+    drainHistory(t);
+  }
+  t = Timings{};
+
+  uint32_t rxStart = dmxRx.packetCount();
+  uint32_t txStart = dmxTx.packetCount();
+  uint32_t iterations = spin(t);
+  uint32_t rxCount = dmxRx.packetCount() - rxStart;
+  uint32_t txCount = dmxTx.packetCount() - txStart;
+  dmxTx.end();
+
+  float seconds = kRunTime / 1000.0f;
+  bool isMaxRate = (rate == std::numeric_limits<float>::infinity());
+  Serial.printf("%4d  %4.1f  %-6s  %3lu/%-2lu  %3lu  %6.1f  %6.1f  %7lu",
+                size, isMaxRate ? 0.0f : rate,
+                bc.name, dmxTx.breakTime(), dmxTx.mabTime(), interSlot,
+                txCount / seconds, rxCount / seconds,
+                t.breakPlusMABTime.jitter());
+  if (kRXWatchPin >= 0) {
+    Serial.printf("  %5lu/%-5lu",
+                  t.breakTime.jitter(), t.mabTime.jitter());
+  }
+  Serial.printf("  %7.1f%%\r\n", 100.0f * iterations / baselineIterations);
+}
+
+// Main program setup.
+void setup() {
+  // Initialize the serial port
+  Serial.begin(115200);
+  while (!Serial && millis() < 4000) {
+    // Wait for initialization to complete or a time limit
+  }
+  Serial.println("Starting loopback benchmark.");
+
+  if (!dmxRx.setPacketHistorySize(kHistorySize)) {
+    Serial.println("Error: not enough memory for the packet history");
+    return;
+  }
+  if (kRXWatchPin >= 0) {
+    dmxRx.setRXWatchPin(kRXWatchPin);
+  }
+  dmxRx.begin();
+
+  // Measure the loop speed before anything is being sent
+  Timings t;
+  baselineIterations = spin(t);
+  if (baselineIterations == 0) {
+    baselineIterations = 1;
+  }
+
+  for (int i = 1; i < teensydmx::kMaxDMXPacketSize; i++) {
+    dmxTx.set(i, i);
+  }
+
+  Serial.println("Rate 0 means as fast as possible; times are in us.");
+  Serial.print("Size  Rate  Mode    B/MAB   ISM  TX FPS  RX FPS  B+M jit");
+  if (kRXWatchPin >= 0) {
+    Serial.print("  B/MAB jit");
+  }
+  Serial.println("  Headroom");
+
+  for (int size : kPacketSizes) {
+    for (float rate : kRefreshRates) {
+      for (const BreakConfig &bc : kBreakConfigs) {
+        for (uint32_t interSlot : kInterSlotTimes) {
+          run(size, rate, bc, interSlot);
+        }
+      }
+    }
+  }
+
+  dmxRx.end();
+  Serial.println("Done.");
+}
+
+// Main program loop.
+void loop() {
+}
+
+#endif  // LOOPBACK_BENCHMARK_PROGRAM
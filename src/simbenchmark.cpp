@@ -0,0 +1,178 @@
+// Simulated receive benchmark program, for catching performance regressions
+// in the receiver's framing logic.
+//
+// This feeds synthetic DMX streams to a receiver with a ReceiverSimulator, so
+// no wiring is needed and the UART isn't used. Each scenario is run for a
+// number of frames and reports the throughput in bytes per second and the
+// average time per frame. Compare the numbers before and after a change.
+//
+// This builds for a Teensy and for the host. The host build, the "native"
+// PlatformIO environment, uses the stand-ins in extras/host and has its own
+// `main()`.
+//
+// (c) 2022 Shawn Silverman
+
+// Define SIMULATOR_BENCHMARK_PROGRAM to use this program.
+#ifdef SIMULATOR_BENCHMARK_PROGRAM
+
+// C++ includes
+#include <cstdint>
+
+#include <Arduino.h>
+
+#include "ReceiverSimulator.h"
+#include "TeensyDMX.h"
+
+namespace teensydmx = ::qindesign::teensydmx;
+
+// The number of frames to run for each scenario.
+constexpr int kFrameCount = 2000;
+
+// The start code that the responder responds to.
+constexpr uint8_t kResponderStartCode = 0x91;
+
+// The simulator. Serial1 isn't used for anything else here.
+teensydmx::ReceiverSimulator sim{Serial1};
+
+// Packet data.
+uint8_t packet[600]{0};
+
+// Responds with a short packet after the first 8 bytes.
+class PingResponder : public teensydmx::Responder {
+ public:
+  static constexpr int kLen = 8;
+
+  int outputBufferSize() const override {
+    return kLen;
+  }
+
+  int processByte(const uint8_t *buf, int len, uint8_t *outBuf) override {
+    if (len < kLen) {
+      return 0;
+    }
+    for (int i = 0; i < kLen; i++) {
+      outBuf[i] = buf[i];
+    }
+    return kLen;
+  }
+};
+
+PingResponder pingResponder;
+
+// Adds one frame and returns the number of data bytes fed to the receiver.
+using ScenarioFunc = int (*)();
+
+// Full 513-slot frames.
+int fullFrame() {
+  packet[0] = 0;
+  sim.addPacket(packet, 513);
+  return 513;
+}
+
+// Packets shorter than the minimum packet time.
+int shortPacket() {
+  packet[0] = 0;
+  sim.addPacket(packet, 10);
+  return 10;
+}
+
+// BREAKs that are too short, followed by some slots.
+int badBreak() {
+  packet[0] = 0;
+  sim.addBreak(40, 8);
+  sim.addSlots(packet, 24);
+  sim.addIdle();
+  return 24;
+}
+
+// Packets longer than 513 slots.
+int longPacket() {
+  packet[0] = 0;
+  sim.addPacket(packet, 600);
+  return 600;
+}
+
+// Packets that the responder responds to.
+int responderPacket() {
+  packet[0] = kResponderStartCode;
+  sim.addPacket(packet, 24);
+  packet[0] = 0;
+  return 24;
+}
+
+// Full frames having a 4us inter-slot MARK time, delivered one
+// slot at a time.
+int interSlotFrame() {
+  packet[0] = 0;
+  sim.addBreak();
+  sim.addSlots(packet, 513, 4);
+  sim.addIdle();
+  return 513;
+}
+
+// Runs one scenario and prints the results.
+void run(const char *name, ScenarioFunc f) {
+  teensydmx::Receiver &rx = sim.receiver();
+  sim.begin();
+
+  uint64_t bytes = 0;
+  uint32_t start = micros();
+  for (int i = 0; i < kFrameCount; i++) {
+    bytes += f();
+  }
+  uint32_t elapsed = micros() - start;
+
+  teensydmx::Receiver::ErrorStats errors = rx.errorStats();
+  uint32_t packets = rx.packetCount();
+  uint32_t responses = sim.responseCount();
+  sim.end();
+
+  if (elapsed == 0) {
+    elapsed = 1;
+  }
+  Serial.printf("%-16s %10.0f B/s %8.2f us/frame"
+                " packets=%lu short=%lu long=%lu framing=%lu"
+                " responses=%lu\r\n",
+                name,
+                static_cast<double>(bytes) * 1000000.0 / elapsed,
+                static_cast<float>(elapsed) / kFrameCount,
+                static_cast<unsigned long>(packets),
+                static_cast<unsigned long>(errors.shortPacketCount),
+                static_cast<unsigned long>(errors.longPacketCount),
+                static_cast<unsigned long>(errors.framingErrorCount),
+                static_cast<unsigned long>(responses));
+}
+
+void setup() {
+  // Serial initialization, for printing things
+  Serial.begin(115200);
+  while (!Serial && millis() < 4000) {
+    // Wait for initialization to complete or a time limit
+  }
+  Serial.println("Starting simulator benchmark.");
+
+  for (int i = 1; i < static_cast<int>(sizeof(packet)); i++) {
+    packet[i] = i;
+  }
+  sim.receiver().setResponder(kResponderStartCode, &pingResponder);
+
+  run("Full frames", &fullFrame);
+  run("Short packets", &shortPacket);
+  run("Bad BREAKs", &badBreak);
+  run("Long packets", &longPacket);
+  run("Responder", &responderPacket);
+  run("Inter-slot MARK", &interSlotFrame);
+  Serial.println("Done.");
+}
+
+void loop() {
+}
+
+#ifdef TEENSYDMX_HOST_BUILD
+int main() {
+  setup();
+  return 0;
+}
+#endif  // TEENSYDMX_HOST_BUILD
+
+#endif  // SIMULATOR_BENCHMARK_PROGRAM
@@ -0,0 +1,326 @@
+// Simulated check program, for checking what gets sent and received for
+// specific sequences of API calls.
+//
+// Each sequence drives a sender with a SenderSimulator, and a receiver with a
+// ReceiverSimulator where needed, so no wiring is needed and the UARTs aren't
+// used. The program prints whether each sequence passed.
+//
+// This builds for a Teensy and for the host. The host build, the
+// "native_check" PlatformIO environment, uses the stand-ins in extras/host and
+// has its own `main()`, which returns a non-zero value if any sequence failed.
+//
+// (c) 2022 Shawn Silverman
+
+// Define SIMULATOR_CHECK_PROGRAM to use this program.
+#ifdef SIMULATOR_CHECK_PROGRAM
+
+// C++ includes
+#include <algorithm>
+#include <cstdint>
+
+#include <Arduino.h>
+
+#include "Merger.h"
+#include "ReceiverSimulator.h"
+#include "Repeater.h"
+#include "SenderSimulator.h"
+#include "TeensyDMX.h"
+#include "USBProWidget.h"
+
+namespace teensydmx = ::qindesign::teensydmx;
+
+// A sequence returns whether it passed.
+using SequenceFunc = bool (*)();
+
+// The number of sequences that failed.
+int failures = 0;
+
+// Sent packet data.
+uint8_t packet[513]{0};
+
+// Sends a packet and returns whether it starts with the given data.
+bool sendAndCompare(teensydmx::SenderSimulator &sim,
+                    const uint8_t *data, int len) {
+  int size = sim.sendPacket(packet, sizeof(packet));
+  if (size < len) {
+    return false;
+  }
+  for (int i = 0; i < len; i++) {
+    if (packet[i] != data[i]) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// The frame that's played back.
+const uint8_t kPlaybackData[4]{0, 99, 99, 99};
+
+// Sends regular data, starts playing back a frame, and returns whether the
+// frame is being sent.
+bool startPlayback(teensydmx::SenderSimulator &sim,
+                   teensydmx::Sender::PlaybackFrame *ring) {
+  teensydmx::Sender &tx = sim.sender();
+  tx.set(1, 10);
+  sim.sendPacket(packet, sizeof(packet));  // The change is sent after this one
+  const uint8_t regular[]{0, 10, 0, 0};
+  if (!sendAndCompare(sim, regular, 4)) {
+    return false;
+  }
+
+  if (!tx.startPlayback(ring, 1) ||
+      !tx.queueFrame({kPlaybackData, 4, 1000, 0})) {
+    return false;
+  }
+  sim.sendPacket(packet, sizeof(packet));  // Playback starts after this one
+  return sendAndCompare(sim, kPlaybackData, 4);
+}
+
+// Changes made during playback don't pick up the frame data.
+bool setDuringPlayback() {
+  teensydmx::SenderSimulator sim{Serial1};
+  teensydmx::Sender &tx = sim.sender();
+  teensydmx::Sender::PlaybackFrame ring[1];
+  sim.begin();
+  if (!startPlayback(sim, ring)) {
+    return false;
+  }
+
+  tx.set(2, 20);
+  if (!sendAndCompare(sim, kPlaybackData, 4)) {
+    return false;
+  }
+
+  // The saved regular data is sent first, and then the change
+  tx.stopPlayback();
+  sim.sendPacket(packet, sizeof(packet));
+  const uint8_t expected[]{0, 10, 20, 0};
+  return sendAndCompare(sim, expected, 4);
+}
+
+// A frame opened during playback starts from the regular data.
+bool frameDuringPlayback() {
+  teensydmx::SenderSimulator sim{Serial1};
+  teensydmx::Sender &tx = sim.sender();
+  teensydmx::Sender::PlaybackFrame ring[1];
+  sim.begin();
+  if (!startPlayback(sim, ring)) {
+    return false;
+  }
+
+  tx.beginFrame();
+  tx.set(3, 30);
+  tx.commitFrame();
+  if (!sendAndCompare(sim, kPlaybackData, 4)) {
+    return false;
+  }
+
+  tx.stopPlayback();
+  sim.sendPacket(packet, sizeof(packet));
+  const uint8_t expected[]{0, 10, 0, 30};
+  return sendAndCompare(sim, expected, 4);
+}
+
+// Changes made while repeating don't pick up the repeated data.
+bool setWhileRepeating() {
+  teensydmx::SenderSimulator txSim{Serial1};
+  teensydmx::ReceiverSimulator rxSim{Serial2};
+  teensydmx::Sender &tx = txSim.sender();
+  teensydmx::Repeater repeater{rxSim.receiver(), tx};
+  txSim.begin();
+  rxSim.begin();
+
+  tx.set(1, 10);
+  txSim.sendPacket(packet, sizeof(packet));  // The change comes next
+  const uint8_t regular[]{0, 10, 0, 0};
+  if (!sendAndCompare(txSim, regular, 4)) {
+    return false;
+  }
+
+  if (!repeater.begin()) {
+    return false;
+  }
+  // A full packet, because shorter ones are too short in time
+  uint8_t repeated[513];
+  repeated[0] = 0;
+  std::fill_n(&repeated[1], 512, 77);
+  rxSim.addPacket(repeated, 513);
+  if (!sendAndCompare(txSim, repeated, 513)) {
+    return false;
+  }
+  tx.set(2, 20);
+
+  // Stopping the repeater stops the sender; the restored regular data is sent
+  // first, and then the change
+  repeater.end();
+  txSim.begin();
+  txSim.sendPacket(packet, sizeof(packet));
+  const uint8_t expected[]{0, 10, 20, 0};
+  return sendAndCompare(txSim, expected, 4);
+}
+
+// Returns whether the application can acquire the receiver's frame view.
+bool canAcquire(teensydmx::Receiver &rx) {
+  teensydmx::Receiver::FrameView view;
+  rx.acquireFrame(view);
+  rx.releaseFrame();
+  return view.data != nullptr;
+}
+
+// A merger only takes receivers that nothing else uses, and then the
+// application can't use their frame views until the merger is gone.
+bool mergerClaimsSources() {
+  teensydmx::SenderSimulator txSim{Serial1};
+  teensydmx::ReceiverSimulator rxSim{Serial2};
+  teensydmx::Receiver &rx = rxSim.receiver();
+  teensydmx::Receiver::FrameView view;
+  rxSim.begin();
+  rxSim.addPacket(packet, sizeof(packet));
+
+  {
+    teensydmx::Merger merger{txSim.sender()};
+    rx.acquireFrame(view);
+    if (merger.add(rx)) {
+      return false;
+    }
+    rx.releaseFrame();
+    if (!merger.add(rx)) {
+      return false;
+    }
+
+    teensydmx::Merger other{txSim.sender()};
+    if (other.add(rx) || canAcquire(rx)) {
+      return false;
+    }
+  }
+
+  return canAcquire(rx);
+}
+
+// A stream that reads from a buffer and discards what's written.
+class BufferStream : public Stream {
+ public:
+  BufferStream(const uint8_t *buf, int len) : buf_(buf), len_(len), index_(0) {}
+
+  int available() override {
+    return len_ - index_;
+  }
+
+  int read() override {
+    return (index_ < len_) ? buf_[index_++] : -1;
+  }
+
+  int peek() override {
+    return (index_ < len_) ? buf_[index_] : -1;
+  }
+
+  size_t write(uint8_t b) override {
+    return 1;
+  }
+
+  using Stream::write;
+
+ private:
+  const uint8_t *buf_;
+  int len_;
+  int index_;
+};
+
+// A widget's "Send DMX" message replaces the whole packet.
+bool widgetSendsDMX() {
+  teensydmx::SenderSimulator sim{Serial1};
+  teensydmx::Sender &tx = sim.sender();
+  sim.begin();
+  tx.set(5, 55);
+  sim.sendPacket(packet, sizeof(packet));
+
+  const uint8_t msg[]{0x7E, 6, 5, 0, 0, 1, 2, 3, 4, 0xE7};
+  BufferStream stream{msg, sizeof(msg)};
+  teensydmx::USBProWidget widget{stream};
+  widget.setPort(0, &tx, nullptr);
+  widget.poll();
+
+  // The old data is sent first
+  sim.sendPacket(packet, sizeof(packet));
+  const uint8_t expected[]{0, 1, 2, 3, 4};
+  return sendAndCompare(sim, expected, 5) && tx.packetSize() == 5;
+}
+
+// A widget and a merger can't share a receiver.
+bool widgetClaimsReceivers() {
+  teensydmx::SenderSimulator txSim{Serial1};
+  teensydmx::ReceiverSimulator rxSim{Serial2};
+  teensydmx::Receiver &rx = rxSim.receiver();
+  rxSim.begin();
+  rxSim.addPacket(packet, sizeof(packet));
+  BufferStream stream{nullptr, 0};
+
+  {
+    teensydmx::Merger merger{txSim.sender()};
+    teensydmx::USBProWidget widget{stream};
+    if (!merger.add(rx) || widget.setPort(0, nullptr, &rx)) {
+      return false;
+    }
+  }
+
+  teensydmx::USBProWidget widget{stream};
+  teensydmx::Merger merger{txSim.sender()};
+  if (!widget.setPort(0, nullptr, &rx) || merger.add(rx) ||
+      widget.setPort(1, nullptr, &rx) || canAcquire(rx)) {
+    return false;
+  }
+  widget.setPort(0, nullptr, nullptr);
+  return canAcquire(rx);
+}
+
+// Choosing the BREAK serial parameters from times switches off timer mode,
+// and the chosen times aren't shorter than the requested ones.
+bool breakParamsFromTimes() {
+  teensydmx::SenderSimulator sim{Serial1};
+  teensydmx::Sender &tx = sim.sender();
+  tx.setBreakUseTimerNotSerial(true);
+  if (!tx.setBreakSerialParamsFromTimes(176, 12)) {
+    return false;
+  }
+  return !tx.isBreakUseTimerNotSerial() &&
+         tx.breakTime() >= 176 && tx.mabTime() >= 12;
+}
+
+// Runs one sequence and prints the result.
+void run(const char *name, SequenceFunc f) {
+  bool passed = f();
+  if (!passed) {
+    failures++;
+  }
+  Serial.printf("%-32s %s\r\n", name, passed ? "PASS" : "FAIL");
+}
+
+void setup() {
+  // Serial initialization, for printing things
+  Serial.begin(115200);
+  while (!Serial && millis() < 4000) {
+    // Wait for initialization to complete or a time limit
+  }
+  Serial.println("Starting simulator checks.");
+
+  run("set() during playback", &setDuringPlayback);
+  run("beginFrame() during playback", &frameDuringPlayback);
+  run("set() while repeating", &setWhileRepeating);
+  run("Merger claims its sources", &mergerClaimsSources);
+  run("Widget sends DMX", &widgetSendsDMX);
+  run("Widget claims its receivers", &widgetClaimsReceivers);
+  run("BREAK parameters from times", &breakParamsFromTimes);
+  Serial.printf("Done: %d failed.\r\n", failures);
+}
+
+void loop() {
+}
+
+#ifdef TEENSYDMX_HOST_BUILD
+int main() {
+  setup();
+  return (failures == 0) ? 0 : 1;
+}
+#endif  // TEENSYDMX_HOST_BUILD
+
+#endif  // SIMULATOR_CHECK_PROGRAM
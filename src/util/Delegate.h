@@ -0,0 +1,123 @@
+// Delegate.h defines a small, non-allocating callback type that refers to a
+// member function of an object, or to a plain function.
+// This file is part of the TeensyDMX library.
+// (c) 2022 Shawn Silverman
+
+#ifndef TEENSYDMX_UTIL_DELEGATE_H_
+#define TEENSYDMX_UTIL_DELEGATE_H_
+
+// C++ includes
+#include <cstddef>
+
+namespace qindesign {
+namespace teensydmx {
+namespace util {
+
+// A callback that's an object pointer plus a function that knows how to call
+// one specific member function on it. Unlike `std::function`, this has a fixed
+// size, never allocates, and copying or comparing it is cheap, so it's safe to
+// create and assign inside an ISR.
+//
+// The function is chosen at compile time. For example:
+// ```
+//     Delegate d = Delegate::fromMethod<MyClass, &MyClass::callback>(this);
+// ```
+//
+// Two delegates are equal if they call the same function on the same object.
+class Delegate final {
+ public:
+  // Creates an empty delegate. Calling it does nothing.
+  constexpr Delegate()
+      : obj_(nullptr),
+        stub_(nullptr) {}
+
+  // Creates an empty delegate. This allows `nullptr` to be used for an
+  // empty callback.
+  constexpr Delegate(std::nullptr_t)
+      : Delegate() {}
+
+  ~Delegate() = default;
+
+  // Support common use of this object
+  Delegate(const Delegate &) = default;
+  Delegate(Delegate &&) = default;
+  Delegate &operator=(const Delegate &) = default;
+  Delegate &operator=(Delegate &&) = default;
+
+  // Creates a delegate that calls the given non-const member function on the
+  // given object.
+  template <typename T, void (T::*Method)()>
+  static constexpr Delegate fromMethod(T *obj) {
+    return Delegate{obj, &methodStub<T, Method>};
+  }
+
+  // Creates a delegate that calls the given const member function on the
+  // given object.
+  template <typename T, void (T::*Method)() const>
+  static constexpr Delegate fromMethod(const T *obj) {
+    return Delegate{const_cast<T *>(obj), &constMethodStub<T, Method>};
+  }
+
+  // Creates a delegate that calls the given plain function.
+  template <void (*Func)()>
+  static constexpr Delegate fromFunction() {
+    return Delegate{nullptr, &functionStub<Func>};
+  }
+
+  // Calls the function, if set.
+  void operator()() const {
+    if (stub_ != nullptr) {
+      stub_(obj_);
+    }
+  }
+
+  // Returns whether this delegate has a function.
+  explicit constexpr operator bool() const {
+    return stub_ != nullptr;
+  }
+
+  constexpr bool operator==(const Delegate &other) const {
+    return (obj_ == other.obj_) && (stub_ == other.stub_);
+  }
+
+  constexpr bool operator!=(const Delegate &other) const {
+    return !(*this == other);
+  }
+
+  constexpr bool operator==(std::nullptr_t) const {
+    return stub_ == nullptr;
+  }
+
+  constexpr bool operator!=(std::nullptr_t) const {
+    return stub_ != nullptr;
+  }
+
+ private:
+  constexpr Delegate(void *obj, void (*stub)(void *))
+      : obj_(obj),
+        stub_(stub) {}
+
+  template <typename T, void (T::*Method)()>
+  static void methodStub(void *obj) {
+    (static_cast<T *>(obj)->*Method)();
+  }
+
+  template <typename T, void (T::*Method)() const>
+  static void constMethodStub(void *obj) {
+    (static_cast<const T *>(obj)->*Method)();
+  }
+
+  template <void (*Func)()>
+  static void functionStub(void *) {
+    Func();
+  }
+
+  void *obj_;
+  void (*stub_)(void *obj);
+};
+
+}  // namespace util
+}  // namespace teensydmx
+}  // namespace qindesign
+
+#endif  // TEENSYDMX_UTIL_DELEGATE_H_
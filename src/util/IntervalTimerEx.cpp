@@ -10,19 +10,19 @@ namespace qindesign {
 namespace teensydmx {
 namespace util {
 
-std::function<void()> IntervalTimerEx::callbacks_[kNumChannels]{nullptr};
+Delegate IntervalTimerEx::callbacks_[kNumChannels]{};
 
 #ifdef KINETISL
 void (*IntervalTimerEx::relays_[2])(void){
-    []() { if (callbacks_[0] != nullptr) { callbacks_[0](); } },
-    []() { if (callbacks_[1] != nullptr) { callbacks_[1](); } },
+    []() { callbacks_[0](); },
+    []() { callbacks_[1](); },
 };
 #else
 void (*IntervalTimerEx::relays_[4])(void){
-    []() { if (callbacks_[0] != nullptr) { callbacks_[0](); } },
-    []() { if (callbacks_[1] != nullptr) { callbacks_[1](); } },
-    []() { if (callbacks_[2] != nullptr) { callbacks_[2](); } },
-    []() { if (callbacks_[3] != nullptr) { callbacks_[3](); } },
+    []() { callbacks_[0](); },
+    []() { callbacks_[1](); },
+    []() { callbacks_[2](); },
+    []() { callbacks_[3](); },
 };
 #endif  // KINETISL
 
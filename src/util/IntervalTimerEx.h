@@ -11,12 +11,11 @@
 #ifndef TEENSYDMX_UTIL_INTERVALTIMEREX_H_
 #define TEENSYDMX_UTIL_INTERVALTIMEREX_H_
 
-// C++ includes
-#include <functional>
-
 #include <IntervalTimer.h>
 #include <util/atomic.h>
 
+#include "Delegate.h"
+
 namespace qindesign {
 namespace teensydmx {
 namespace util {
@@ -27,6 +26,8 @@ static constexpr int kNumChannels = 4;
 static constexpr int kNumChannels = 2;
 #elif defined(__IMXRT1062__) || defined(__IMXRT1052__)
 static constexpr int kNumChannels = 4;
+#elif defined(TEENSYDMX_HOST_BUILD)
+static constexpr int kNumChannels = 4;  // The stand-in timers never start
 #endif  // Processor check
 
 // Wraps IntervalTimer so that we can use function callbacks.
@@ -41,9 +42,10 @@ class IntervalTimerEx final {
 
   // Attempts to start or restart a timer. This returns whether the timer was
   // successfully started or restarted. This version of the function replaces
-  // the callback if the timer was already started.
+  // the callback if the timer was already started. If the callback is the same
+  // as the current one then only the period is reprogrammed.
   template <typename period_t>
-  bool begin(const std::function<void()> &callback, period_t period) {
+  bool begin(const Delegate &callback, period_t period) {
     // Find a free slot, if not already started
     if (!started_) {
       for (int i = 0; i < kNumChannels; i++) {
@@ -62,6 +64,9 @@ class IntervalTimerEx final {
         }
       }
     } else {
+      if (callbacks_[cbIndex_] == callback) {
+        return restart(period);
+      }
       ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
         if (intervalTimer_.begin(relays_[cbIndex_], period)) {
           callbacks_[cbIndex_] = callback;
@@ -96,7 +101,7 @@ class IntervalTimerEx final {
   void end();
 
  private:
-  static std::function<void()> callbacks_[kNumChannels];
+  static Delegate callbacks_[kNumChannels];
   static void (*relays_[kNumChannels])(void);
 
   // Use composition rather than inheritance to avoid the whole destructor mess
@@ -21,16 +21,6 @@ namespace qindesign {
 namespace teensydmx {
 namespace util {
 
-// Note: When we use a std::function (Null Pattern) instead of
-//       nullptr, replacing the function during end(), when called in
-//       the lambda seems to also replace the local 'this' pointer to
-//       the containing code, if the end() call isn't the last call in
-//       the lambda. Perhaps the 'operator=' operation does something
-//       funky? Is this expected or is it a compiler issue?
-//       Changing the API to use 'const std::function' doesn't seem
-//       to help.
-// static const std::function<void()> nullFunc = []() {};
-
 #if defined(KINETISK)
 static void my_pit0_isr();
 static void my_pit1_isr();
@@ -43,7 +33,7 @@ static void (*myISRs[kNumChannels])(){
     my_pit2_isr,
     my_pit3_isr,
 };
-static std::function<void()> funcs[kNumChannels]{
+static Delegate funcs[kNumChannels]{
     nullptr,
     nullptr,
     nullptr,
@@ -53,7 +43,7 @@ static std::function<void()> funcs[kNumChannels]{
 static void my_pit_isr();
 static constexpr int kNumChannels = 2;
 static uint32_t runningFlags = 0;
-static std::function<void()> funcs[kNumChannels]{
+static Delegate funcs[kNumChannels]{
     nullptr,
     nullptr,
 };
@@ -62,7 +52,7 @@ static uint8_t priorities[kNumChannels]{255, 255};
 static void pit_isr();
 static constexpr int kNumChannels = 4;
 static uint32_t runningFlags = 0;
-static std::function<void()> funcs[kNumChannels] __attribute((aligned(32))){
+static Delegate funcs[kNumChannels] __attribute((aligned(32))){
     nullptr,
     nullptr,
     nullptr,
@@ -94,8 +84,8 @@ static bool checkMicros(float micros) {
   return (0.0f <= micros) && (micros <= kMaxPeriod);
 }
 
-bool PeriodicTimer::begin(std::function<void()> func, uint32_t micros,
-                          std::function<void()> startFunc) {
+bool PeriodicTimer::begin(const Delegate &func, uint32_t micros,
+                          const Delegate &startFunc) {
   if (!checkMicros(micros)) {
     return false;
   }
@@ -103,8 +93,8 @@ bool PeriodicTimer::begin(std::function<void()> func, uint32_t micros,
   return beginCycles(func, cycles, startFunc);
 }
 
-bool PeriodicTimer::begin(std::function<void()> func, float micros,
-                          std::function<void()> startFunc) {
+bool PeriodicTimer::begin(const Delegate &func, float micros,
+                          const Delegate &startFunc) {
   if (!checkMicros(micros)) {
     return false;
   }
@@ -171,8 +161,8 @@ bool PeriodicTimer::restartCycles(uint32_t cycles) {
   return true;
 }
 
-bool PeriodicTimer::beginCycles(std::function<void()> func, uint32_t cycles,
-                                std::function<void()> startFunc) {
+bool PeriodicTimer::beginCycles(const Delegate &func, uint32_t cycles,
+                                const Delegate &startFunc) {
   // Lock lock{};
 
   if (cycles < kMinCycles) {
@@ -180,7 +170,8 @@ bool PeriodicTimer::beginCycles(std::function<void()> func, uint32_t cycles,
   }
 
   // Capture the timer
-  if (channel_ != nullptr) {
+  bool captured = (channel_ != nullptr);
+  if (captured) {
     channel_->TCTRL = 0;            // Disable the timer so it can be restarted
     channel_->TFLG = PIT_TFLG_TIF;  // Clear the interrupt
   } else {
@@ -225,11 +216,16 @@ bool PeriodicTimer::beginCycles(std::function<void()> func, uint32_t cycles,
   int index = channel_ - IMXRT_PIT_CHANNELS;
   runningFlags |= (uint32_t{1} << index);
 #endif  // Processor check
-  funcs[index] = func;
+  if (funcs[index] != func) {
+    funcs[index] = func;
+  }
   channel_->LDVAL = cycles;
   channel_->TCTRL = PIT_TCTRL_TIE | PIT_TCTRL_TEN;
-  if (startFunc != nullptr) {
-    startFunc();
+  startFunc();
+
+  // The interrupt is already set up if the timer was already captured
+  if (captured) {
+    return true;
   }
 #if defined(KINETISK)
   attachInterruptVector(static_cast<IRQ_NUMBER_t>(IRQ_PIT_CH0 + index),
@@ -327,71 +323,51 @@ void PeriodicTimer::setPriority(uint8_t n) {
 #if defined(KINETISK)
 static void my_pit0_isr() {
   PIT_TFLG0 = 1;
-  if (funcs[0] != nullptr) {
-    funcs[0]();
-  }
+  funcs[0]();
 }
 
 static void my_pit1_isr() {
   PIT_TFLG1 = 1;
-  if (funcs[1] != nullptr) {
-    funcs[1]();
-  }
+  funcs[1]();
 }
 
 static void my_pit2_isr() {
   PIT_TFLG2 = 1;
-  if (funcs[2] != nullptr) {
-    funcs[2]();
-  }
+  funcs[2]();
 }
 
 static void my_pit3_isr() {
   PIT_TFLG3 = 1;
-  if (funcs[3] != nullptr) {
-    funcs[3]();
-  }
+  funcs[3]();
 }
 #elif defined(KINETISL)
 static void my_pit_isr() {
   if (PIT_TFLG0 != 0) {
     PIT_TFLG0 = 1;
-    if (funcs[0] != nullptr) {
-      funcs[0]();
-    }
+    funcs[0]();
   }
   if (PIT_TFLG1 != 0) {
     PIT_TFLG1 = 1;
-    if (funcs[1] != nullptr) {
-      funcs[1]();
-    }
+    funcs[1]();
   }
 }
 #elif defined(__IMXRT1062__) || defined(__IMXRT1052__)
 static void pit_isr() {
   if (PIT_TFLG0 != 0) {
     PIT_TFLG0 = 1;
-    if (funcs[0] != nullptr) {
-      funcs[0]();
-    }
+    funcs[0]();
   }
   if (PIT_TFLG1 != 0) {
     PIT_TFLG1 = 1;
-    if (funcs[1] != nullptr) {
-      funcs[1]();
-    }
+    funcs[1]();
   }
   if (PIT_TFLG2 != 0) {
     PIT_TFLG2 = 1;
-    if (funcs[2] != nullptr) {
-      funcs[2]();
-    }
+    funcs[2]();
   }
   if (PIT_TFLG3 != 0) {
     PIT_TFLG3 = 1;
-    if (funcs[3] != nullptr) {
-      funcs[3]();
-    }
+    funcs[3]();
   }
 }
 #endif  // Processor check
@@ -12,7 +12,6 @@
 
 // C++ includes
 #include <cstdint>
-#include <functional>
 
 #if defined(__MK20DX128__) || defined(__MK20DX256__) || \
     defined(__MKL26Z64__) || defined(__MK64FX512__) || defined(__MK66FX1M0__)
@@ -21,6 +20,8 @@
 #include <imxrt.h>
 #endif  // Processor check
 
+#include "Delegate.h"
+
 namespace qindesign {
 namespace teensydmx {
 namespace util {
@@ -52,13 +53,17 @@ class PeriodicTimer final {
   // enabled. This helps to make timing more accurate by moving
   // statements that need to be executed at the start of the interval
   // to just before the interval actually begins.
-  bool begin(std::function<void()> func, uint32_t micros,
-             std::function<void()> startFunc = nullptr);
+  //
+  // If the timer is already running then it's restarted with the new
+  // period and function. In this case, only the period is reprogrammed;
+  // the interrupt setup is left alone.
+  bool begin(const Delegate &func, uint32_t micros,
+             const Delegate &startFunc = nullptr);
 
   // See the `uint32_t` version of `begin`. This also returns false if
   // the period is negative.
-  bool begin(std::function<void()> func, float micros,
-             std::function<void()> startFunc = nullptr);
+  bool begin(const Delegate &func, float micros,
+             const Delegate &startFunc = nullptr);
 
   // Restarts the timer with the specified period in microseconds. The
   // timer is first stopped and then restarted with the new period.
@@ -114,8 +119,8 @@ class PeriodicTimer final {
 #endif  // Processor check
   volatile uint8_t priority_;
 
-  bool beginCycles(std::function<void()> func, uint32_t cycles,
-                   std::function<void()> startFunc);
+  bool beginCycles(const Delegate &func, uint32_t cycles,
+                   const Delegate &startFunc);
   bool updateCycles(uint32_t cycles);
   bool restartCycles(uint32_t cycles);
 };